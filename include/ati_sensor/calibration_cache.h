@@ -0,0 +1,81 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_CALIBRATION_CACHE_H
+#define ATI_SENSOR_CALIBRATION_CACHE_H
+
+#include <string>
+#include <stdint.h>
+
+namespace ati{
+
+// The settings the driver reads from the web server of a sensor
+struct CalibrationData {
+  uint32_t cpf;           // counts per force
+  uint32_t cpt;           // counts per torque
+  int rdt_rate;
+  int gauge_bias[6];
+};
+
+bool operator==(const CalibrationData& a, const CalibrationData& b);
+inline bool operator!=(const CalibrationData& a, const CalibrationData& b) {return !(a == b);}
+
+// Settings of sensors kept on disk between runs, one small text file per
+// web server address and calibration index, so that streaming can start
+// without waiting for the web server. Files are replaced atomically and
+// can be shared by several processes.
+class CalibrationCache{
+public:
+  // An empty directory means defaultDirectory()
+  explicit CalibrationCache(const std::string& directory = std::string());
+
+  // $ATI_SENSOR_CACHE_DIR, or $XDG_CACHE_HOME/ati_sensor,
+  // or $HOME/.cache/ati_sensor
+  static std::string defaultDirectory();
+
+  // False if there is no entry or it is not valid
+  bool load(const std::string& host, int calibration_index, CalibrationData& data) const;
+  // Creates the directory if needed
+  bool store(const std::string& host, int calibration_index, const CalibrationData& data) const;
+  bool remove(const std::string& host, int calibration_index) const;
+
+  std::string path(const std::string& host, int calibration_index) const;
+  const std::string& directory() const {return directory_;}
+
+private:
+  std::string directory_;
+};
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+
+#ifndef ATI_SENSOR_CLAIMED_RING_H
+#define ATI_SENSOR_CLAIMED_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+// Samples written between two publications of the head
+#define CLAIMED_RING_CHUNK 64
+
+namespace ati{
+
+// A ring that one thread overwrites and any number of readers copy from
+// without locking. head counts the slots ever written; claimed is moved
+// first, up to the end of the chunk being written, so that a reader which
+// copied a slot overwritten meanwhile sees it afterwards.
+// store(position, i) writes the i-th of the n values at position, the
+// slot being position % capacity.
+template<typename Store>
+void claimedRingWrite(std::atomic<uint64_t>& claimed, std::atomic<uint64_t>& head, size_t n, Store store)
+{
+  uint64_t position = head.load(std::memory_order_relaxed);
+  size_t i = 0;
+  while (i < n)
+  {
+    const size_t end = n - i < CLAIMED_RING_CHUNK ? n : i + CLAIMED_RING_CHUNK;
+    claimed.store(position + (end - i), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (; i < end; ++i, ++position)
+      store(position, i);
+    head.store(position, std::memory_order_release);
+  }
+}
+
+// Reader side, once the slots from first on are copied : how many of them,
+// from first, may have been overwritten meanwhile
+inline uint64_t claimedRingOverwritten(const std::atomic<uint64_t>& claimed, uint64_t first, uint64_t capacity)
+{
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t end = claimed.load(std::memory_order_relaxed);
+  return end - first > capacity ? end - capacity - first : 0;
+}
+
+}
+
+#endif
@@ -0,0 +1,89 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_FT_DECIMATOR_H
+#define ATI_SENSOR_FT_DECIMATOR_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace ati{
+
+struct Sample;
+
+// Integer rate reduction of a stream of samples, with a linear phase FIR
+// anti-aliasing low pass (Blackman windowed sinc) on the six axes.
+// Every input sample goes through the history, but the filter is only
+// evaluated for the samples kept, one in factor : the work per input
+// sample is that of one phase of the polyphase filter. Nothing allocates
+// once the factor is set. The history starts full of the first sample.
+class FTDecimator{
+public:
+  // Factor 1 passes samples through
+  FTDecimator();
+
+  // Keep one sample in factor. The filter has taps_per_phase * factor + 1
+  // taps and its transition band ends at the output Nyquist frequency from
+  // 11 taps per phase; fewer taps also attenuate the top of the output band,
+  // more taps widen the pass band, at the cost of delay.
+  bool setFactor(unsigned int factor, unsigned int taps_per_phase = 16);
+  unsigned int factor() const {return factor_;}
+  size_t taps() const {return coefficients_.size();}
+  // Delay of the output, in input samples
+  double delay() const {return taps() > 0 ? (taps() - 1) / 2.0 : 0;}
+
+  // Restart from the next sample, e.g. after a gap in the stream
+  void reset();
+
+  // Feed n samples, write the decimated ones to out (which may be in) and
+  // return their count. Sequence numbers and timestamp of an output are
+  // those of the last input it covers, see delay().
+  size_t process(const Sample* in, size_t n, Sample* out);
+
+  // Gain at frequency, as a fraction of the input rate
+  double magnitude(double frequency) const;
+
+private:
+  std::vector<double> coefficients_;
+  // Twice the taps, each sample is written at two places so that the last
+  // taps samples are always contiguous
+  std::vector<double> history_;
+  size_t position_;
+  unsigned int factor_;
+  unsigned int phase_;
+  bool primed_;
+};
+
+}
+
+#endif
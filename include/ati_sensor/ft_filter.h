@@ -0,0 +1,114 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_FT_FILTER_H
+#define ATI_SENSOR_FT_FILTER_H
+
+#include <stddef.h>
+#include <vector>
+
+namespace ati{
+
+struct Sample;
+
+// Cascade of biquad sections applied to the six axes of a stream of samples.
+// Stages are given by their frequencies in Hz and turned into sections for
+// a sampling rate (bilinear transform, prewarped at the stage frequency).
+// Butterworth low and high pass of order N take N/2 sections, plus a first
+// order one if N is odd. State is kept per section for the six axes side by
+// side, so each sample is updated with a few vector operations. Nothing
+// allocates once the stages are added.
+// The state starts at the steady state of the first sample, so a sensor
+// under load does not ring from zero.
+class FTFilter{
+public:
+  enum stage_t
+  {
+    LOW_PASS,
+    HIGH_PASS,
+    NOTCH
+  };
+
+  FTFilter();
+
+  // Butterworth filters, order 1 to 8
+  bool addLowPass(double cutoff, unsigned int order = 2);
+  bool addHighPass(double cutoff, unsigned int order = 2);
+  // Removes frequency, q is the frequency over the -3 dB bandwidth
+  bool addNotch(double frequency, double q = 10.0);
+  void clear();
+  bool empty() const {return stages_.empty();}
+  size_t sections() const {return sections_.size();}
+
+  // Design the sections for this sampling rate (Hz) and reset the state.
+  // Stages at or above the Nyquist frequency pass through, in which case
+  // false is returned. Until then, samples pass through unchanged.
+  bool setSampleRate(double rate);
+  double sampleRate() const {return rate_;}
+
+  // Restart from the next sample, e.g. after a gap in the stream
+  void reset() {primed_ = false;}
+
+  // Filter the ft[] of the samples in place, in order
+  void process(Sample* samples, size_t n);
+  void process(double ft[6]);
+
+  // Gain at frequency (Hz) for the current sampling rate
+  double magnitude(double frequency) const;
+
+private:
+  struct Stage {
+    stage_t type;
+    double frequency;
+    double param;     // order, or q
+  };
+  // Transposed direct form II, coefficients normalized by a0
+  struct Section {
+    double b0, b1, b2, a1, a2;
+    double z1[6];
+    double z2[6];
+  };
+
+  bool addStage(stage_t type, double frequency, double param, size_t sections);
+  void prime(const double x[6]);
+
+  std::vector<Stage> stages_;
+  std::vector<Section> sections_;
+  double rate_;
+  bool designed_;
+  bool primed_;
+};
+
+}
+
+#endif
@@ -0,0 +1,173 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_FT_LOG_H
+#define ATI_SENSOR_FT_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "ati_sensor/ft_recorder.h"
+
+// Compressed log layout, header fields in host byte order :
+//   LogFileHeader
+//   chunks : LogChunkHeader followed by payload_size bytes
+//   LogIndexEntry[chunk_count]
+//   LogTrailer
+// A chunk holds up to chunk_records consecutive records of one sensor.
+// Each record is a flags byte then zigzag varints : the rdt_sequence step
+// beyond +1, the change of the ft_sequence step, the change of the
+// timestamp step, status and cpf/cpt only when they change, and always the
+// six count deltas. State restarts with every chunk, so chunks decode
+// independently.
+#define LOG_MAGIC "ATIFTLOG"
+#define LOG_INDEX_MAGIC "ATIFTIDX"
+#define LOG_CHUNK_MAGIC 0x4b434654   // "TFCK"
+#define LOG_VERSION 1
+
+namespace ati{
+
+struct LogFileHeader {
+  char magic[8];                // LOG_MAGIC, not null-terminated
+  uint32_t version;
+  uint32_t byte_order;          // 0x01020304 as written by the recording host
+  uint32_t header_size;         // offset of the first chunk
+  uint32_t chunk_records;       // maximum records per chunk
+  uint64_t start_time;          // nanoseconds since the epoch
+  uint32_t sensor_count;
+  uint32_t reserved;
+  RecordSensorInfo sensors[RECORD_MAX_SENSORS];
+};
+
+struct LogChunkHeader {
+  uint32_t magic;               // LOG_CHUNK_MAGIC
+  uint16_t sensor;
+  uint16_t reserved;
+  uint32_t record_count;
+  uint32_t payload_size;
+  uint64_t first_timestamp;
+  uint64_t last_timestamp;
+};
+
+struct LogIndexEntry {
+  uint64_t offset;              // of the LogChunkHeader
+  uint64_t first_timestamp;
+  uint64_t last_timestamp;
+  uint32_t record_count;
+  uint16_t sensor;
+  uint16_t reserved;
+};
+
+struct LogTrailer {
+  uint64_t index_offset;
+  uint64_t chunk_count;
+  char magic[8];                // LOG_INDEX_MAGIC
+};
+
+// Encodes RecordEntry streams into a compressed log. Not thread safe : meant
+// to be fed by one thread, e.g. the FTRecorder writer.
+class FTLogWriter{
+public:
+  FTLogWriter();
+  ~FTLogWriter();
+
+  bool open(const std::string& path, uint32_t chunk_records = 4096);
+  // Flush pending chunks, write the index and the final header
+  bool close();
+  bool isOpen() const {return fd_ >= 0;}
+
+  // Describe a sensor of the sensor table, before or while appending.
+  // Written to the file right away.
+  bool setSensor(uint16_t sensor, const RecordSensorInfo& info);
+  bool append(const RecordEntry& entry);
+
+  uint64_t recordCount() const {return records_;}
+  uint64_t bytesWritten() const {return offset_;}
+
+private:
+  FTLogWriter(const FTLogWriter&);
+  FTLogWriter& operator=(const FTLogWriter&);
+
+  struct ChunkEncoder;
+  bool flush(ChunkEncoder& chunk);
+
+  int fd_;
+  uint64_t offset_;
+  uint64_t records_;
+  uint32_t chunk_records_;
+  LogFileHeader header_;
+  ChunkEncoder* chunks_[RECORD_MAX_SENSORS];
+  std::vector<LogIndexEntry> index_;
+};
+
+// Reads a compressed log through a read-only mapping. Chunks are decoded
+// independently, decodeChunk() may be called from several threads at once.
+class FTLogReader{
+public:
+  FTLogReader();
+  ~FTLogReader();
+
+  // Uses the index, or scans the chunks if the log was not closed properly
+  bool open(const std::string& path);
+  void close();
+  bool isOpen() const {return map_ != NULL;}
+
+  const LogFileHeader& header() const {return *reinterpret_cast<const LogFileHeader*>(map_);}
+  size_t chunkCount() const {return index_.size();}
+  const LogIndexEntry& chunk(size_t i) const {return index_[i];}
+  uint64_t recordCount() const {return records_;}
+
+  // Decode chunk i into out, which must hold chunk(i).record_count entries
+  bool decodeChunk(size_t i, RecordEntry* out) const;
+  // First chunk of the sensor ending at or after timestamp, chunkCount() if none
+  size_t findChunk(uint16_t sensor, uint64_t timestamp) const;
+
+private:
+  FTLogReader(const FTLogReader&);
+  FTLogReader& operator=(const FTLogReader&);
+
+  // Whether a whole chunk with a valid header lies at offset, before end
+  bool validChunk(uint64_t offset, uint64_t end) const;
+  bool scanChunks();
+
+  unsigned char* map_;
+  size_t map_size_;
+  uint64_t records_;
+  std::vector<LogIndexEntry> index_;
+};
+
+}
+
+#endif
@@ -0,0 +1,179 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_FT_RECORDER_H
+#define ATI_SENSOR_FT_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <atomic>
+#include <pthread.h>
+
+#include "ati_sensor/spsc_ring.h"
+
+// Recording file layout, host byte order :
+//   RecordFileHeader, padded to RECORD_HEADER_SIZE bytes
+//   RecordEntry[record_count]
+#define RECORD_MAGIC "ATIFTREC"
+#define RECORD_VERSION 1
+#define RECORD_HEADER_SIZE 4096
+#define RECORD_MAX_SENSORS 32
+
+namespace ati{
+
+class FTSensor;
+class FTRecorder;
+class FTLogWriter;
+
+// One RDT record as received, with what is needed to convert it
+struct RecordEntry {
+  uint64_t timestamp;       // arrival time, nanoseconds since the epoch
+  uint32_t rdt_sequence;
+  uint32_t ft_sequence;
+  uint32_t status;
+  int32_t counts[6];        // Fx, Fy, Fz, Tx, Ty, Tz in raw counts
+  uint32_t cpf;             // counts per force/torque in use when received
+  uint32_t cpt;
+  uint16_t sensor;          // index in RecordFileHeader::sensors
+  uint16_t reserved;
+};
+
+struct RecordSensorInfo {
+  char ip[40];
+  uint16_t port;
+  uint16_t http_port;
+  uint32_t reserved;
+  uint32_t rdt_rate;
+  uint32_t command;         // RDT command used for streaming
+  uint64_t attached_time;   // nanoseconds since the epoch
+};
+
+struct RecordFileHeader {
+  char magic[8];                // RECORD_MAGIC, not null-terminated
+  uint32_t version;
+  uint32_t byte_order;          // 0x01020304 as written by the recording host
+  uint32_t header_size;         // offset of the first record
+  uint32_t record_size;         // sizeof(RecordEntry)
+  uint64_t start_time;          // nanoseconds since the epoch
+  uint64_t record_count;        // updated while recording
+  uint32_t sensor_count;
+  uint32_t reserved;
+  char layout[256];             // human readable description of RecordEntry
+  RecordSensorInfo sensors[RECORD_MAX_SENSORS];
+};
+
+// Receive path side of a recording : a ring the sensor pushes to.
+// Only the recorder creates these.
+class RecorderChannel{
+public:
+  // Called by the receiving thread of the sensor, never blocks.
+  // Records that do not fit in the ring are counted and dropped.
+  void record(const unsigned char* records, size_t n, uint64_t timestamp, uint32_t cpf, uint32_t cpt);
+  FTRecorder* recorder() const {return recorder_;}
+
+private:
+  friend class FTRecorder;
+  RecorderChannel(FTRecorder* recorder, uint16_t sensor, size_t ring_size);
+
+  FTRecorder* recorder_;
+  uint16_t sensor_;
+  RecordSensorInfo info_;
+  SpscRing<RecordEntry> ring_;
+  std::atomic<uint64_t> dropped_;
+};
+
+// Appends the raw records received by one or more sensors to a memory
+// mapped file. The receive path only pushes to a ring; a writer thread
+// copies into the mapping and grows the file by preallocated chunks, so
+// page faults and disk I/O never stall reception.
+class FTRecorder{
+public:
+  FTRecorder();
+  ~FTRecorder();
+
+  // Create (truncate) the file and start the writer thread.
+  // ring_size is per sensor, chunk_size is how much the file grows at once.
+  bool open(const std::string& path, size_t ring_size = 65536, size_t chunk_size = 64 << 20);
+  // Same, writing a compressed log (see ft_log.h) instead of raw records.
+  // Encoding happens in the writer thread.
+  bool openCompressed(const std::string& path, size_t ring_size = 65536, uint32_t chunk_records = 4096);
+  // Detach all sensors, flush, trim the file to its content and close it.
+  // Fails while an attached sensor is receiving.
+  bool close();
+  bool isOpen() const {return fd_ >= 0 || log_ != NULL;}
+
+  // Record everything the sensor receives from now on. The sensor must be
+  // initialized, and must not be receiving (receive thread or group)
+  // while it is attached or detached.
+  bool attach(FTSensor* sensor);
+  void detach(FTSensor* sensor);
+
+  uint64_t recordsWritten() const {return written_.load(std::memory_order_relaxed);}
+  // Records lost because the writer did not keep up
+  uint64_t recordsDropped() const;
+
+private:
+  FTRecorder(const FTRecorder&);
+  FTRecorder& operator=(const FTRecorder&);
+
+  static void* writerEntry(void* arg);
+  void writerLoop();
+  size_t drainChannels();
+  bool grow();
+  bool startWriter();
+  RecordFileHeader* header() {return reinterpret_cast<RecordFileHeader*>(map_);}
+
+  int fd_;
+  FTLogWriter* log_;
+  unsigned char* map_;
+  size_t map_size_;
+  size_t chunk_size_;
+  size_t ring_size_;
+  size_t offset_;
+  bool grow_failed_;
+  uint32_t sensors_described_;
+  // Only the writer thread touches the mapping, header included : attach()
+  // publishes channels through channel_count_ and the writer copies their
+  // sensor info
+  RecorderChannel* channels_[RECORD_MAX_SENSORS];
+  FTSensor* sensors_[RECORD_MAX_SENSORS];
+  std::atomic<uint32_t> channel_count_;
+  pthread_t writer_;
+  std::atomic<bool> stop_writer_;
+  std::atomic<uint64_t> written_;
+};
+
+}
+
+#endif
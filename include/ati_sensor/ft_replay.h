@@ -0,0 +1,111 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_FT_REPLAY_H
+#define ATI_SENSOR_FT_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <time.h>
+
+#include "ati_sensor/ft_recorder.h"
+
+namespace ati{
+
+struct Sample;
+
+// Reads back the records of one sensor from an FTRecorder file, through a
+// read-only mapping. Samples keep their recorded sequence numbers and
+// timestamps; they are handed out at the recorded pace scaled by a speed
+// factor, or as fast as possible.
+class RecordReplay{
+public:
+  RecordReplay();
+  ~RecordReplay();
+
+  // sensor is the index in the file's sensor table
+  bool open(const std::string& path, unsigned int sensor = 0);
+  void close();
+  bool isOpen() const {return map_ != NULL;}
+  const RecordFileHeader& header() const {return *reinterpret_cast<const RecordFileHeader*>(map_);}
+  const RecordSensorInfo& sensorInfo() const {return header().sensors[sensor_];}
+
+  // 1.0 replays at the recorded pace, 10.0 ten times faster,
+  // 0 as fast as possible. Takes effect from the next read.
+  void setSpeed(double speed);
+  double speed() const {return speed_;}
+
+  // Waits until the next record is due, then returns it and every
+  // following one already due, up to max. Returns 0 at the end of the file.
+  size_t read(Sample* samples, size_t max);
+  bool finished() const {return next_ >= count_;}
+  // Next record of the sensor without consuming it, NULL at the end
+  const RecordEntry* peek();
+  // Back to the first record, restarting the clock
+  void rewind();
+
+  // Records of every sensor in the file, and index of the next one
+  uint64_t recordCount() const {return count_;}
+  // Every record of the file, all sensors, recordCount() of them
+  const RecordEntry* records() const {return records_;}
+  uint64_t position() const {return next_;}
+
+private:
+  RecordReplay(const RecordReplay&);
+  RecordReplay& operator=(const RecordReplay&);
+
+  // Skip the records of other sensors
+  bool seekSensor();
+
+  unsigned char* map_;
+  size_t map_size_;
+  const RecordEntry* records_;
+  uint64_t count_;
+  uint64_t next_;
+  uint16_t sensor_;
+  double speed_;
+  // Recorded time of the first replayed record, and when it was replayed
+  bool clock_started_;
+  uint64_t first_timestamp_;
+  struct timespec start_;
+  // Reciprocal of the last counts per force/torque
+  uint32_t cpf_;
+  uint32_t cpt_;
+  double force_scale_;
+  double torque_scale_;
+};
+
+}
+
+#endif
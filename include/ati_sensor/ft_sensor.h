@@ -31,6 +31,9 @@
 // The fact that you are presently reading this means that you have had
 // knowledge of the CeCILL-C license and that you accept its terms.
 
+#ifndef ATI_SENSOR_FT_SENSOR_H
+#define ATI_SENSOR_FT_SENSOR_H
+
 // standard and socket related libraries
 #include <stdio.h>
 #include <stdlib.h>
@@ -47,11 +50,42 @@
 #include <sstream>
 #include <map>
 #include <vector>
+#include <atomic>
+#include <functional>
+#include <pthread.h>
+
+#include "ati_sensor/spsc_ring.h"
+#include "ati_sensor/latest_slot.h"
+#include "ati_sensor/realtime.h"
+#include "ati_sensor/rdt_receiver.h"
+#include "ati_sensor/sequence_tracker.h"
+#include "ati_sensor/calibration_cache.h"
+#include "ati_sensor/netft_settings.h"
+#include "ati_sensor/http_client.h"
+#include "ati_sensor/ft_filter.h"
+#include "ati_sensor/ft_decimator.h"
+#include "ati_sensor/host_bias.h"
+#include "ati_sensor/wrench_transform.h"
 
-#define MAX_XML_SIZE 35535
 #define RDT_RECORD_SIZE 36
+// In buffered mode the Net F/T packs up to this many records per datagram
+#define RDT_MAX_RECORDS 40
+#define RDT_MAX_DATAGRAM_SIZE (RDT_RECORD_SIZE * RDT_MAX_RECORDS)
+// How often the receive thread checks for a stop request (microseconds)
+#define RECEIVE_THREAD_POLL_US 100000
+// Pause of the receive thread after a socket error (microseconds)
+#define RECEIVE_THREAD_ERROR_BACKOFF_US 1000
+// Maximum number of datagrams pulled by the receive thread in one syscall
+#define RECEIVE_BATCH_SIZE 64
+// Records of a recording looked at to tell a continuous stream from polling
+#define REPLAY_CONTINUITY_RECORDS 4096
 
 namespace ati{
+class SensorGroup;
+class FTRecorder;
+class RecorderChannel;
+class RecordReplay;
+class ShmPublisher;
 static const std::string default_ip = "192.168.100.103";
 static const int current_calibration=-1;
 // Structure for the sensor response
@@ -69,6 +103,15 @@ typedef struct response_struct {
 	uint32_t cpf;
 } response_s;
 
+// A decoded record, converted to SI units, with its reception time
+struct Sample {
+  uint64_t timestamp;     // arrival time, nanoseconds since the epoch (CLOCK_REALTIME)
+  uint32_t rdt_sequence;
+  uint32_t ft_sequence;
+  uint32_t status;
+  double ft[6];           // Fx, Fy, Fz in N and Tx, Ty, Tz in Nm
+};
+
 typedef struct command_struct{
   static const uint16_t command_header = 0x1234;
   uint16_t command;
@@ -82,7 +125,19 @@ typedef struct command_struct{
   static const int DEFAULT_PORT = 49152;
 } command_s;
 
+// Settings changed together by FTSensor::configure(), in one round trip
+// to the web server. Fields left to their default are not changed.
+struct SettingsUpdate {
+  SettingsUpdate() : rdt_rate(0), rdt_buffer_size(0), calibration_index(ati::current_calibration) {}
+  std::map<unsigned int, int> gauge_bias;   // gauge index (0-5) to bias
+  int rdt_rate;                             // 1-7000 Hz, 0 : unchanged
+  int rdt_buffer_size;                      // records per datagram in buffered mode, 0 : unchanged
+  int calibration_index;                    // current_calibration : unchanged
+};
+
 class FTSensor{
+  friend class SensorGroup;
+  friend class FTRecorder;
 public:
   // Constructor
   FTSensor();
@@ -96,59 +151,206 @@ public:
     GAUGE_PARSE_ERROR,
     RDTRATE_PARSE_ERROR
   };
+
+  // Where the counts per force and torque in use come from
+  enum calibration_source_t
+  {
+    CALIBRATION_DEFAULT,  // nothing could be read, 1000000 counts per unit
+    CALIBRATION_CACHE,    // the cache, not confirmed by the sensor yet
+    CALIBRATION_SENSOR    // the web server of the sensor
+  };
+
+  // How getMeasurements() consumes the ring when the receive thread runs
+  enum stream_read_t
+  {
+    READ_NEWEST,  // skip to the most recent sample, older ones are discarded
+    READ_NEXT,    // return samples one by one, in reception order
+    READ_CALLBACK // nothing is queued, the sample callback gets every sample
+  };
   
   // Initialization, reading parameters from XML files, etc..
   bool init(std::string ip, int calibration_index = ati::current_calibration,
             uint16_t cmd = ati::command_s::REALTIME, int sample_count = -1);
+  // Read a sensor recorded by FTRecorder instead of the socket. speed 1.0 is
+  // the recorded pace, 0 as fast as possible.
+  bool initReplay(const std::string& path, unsigned int sensor = 0, double speed = 1.0);
+  // NULL unless replaying; to change the speed, rewind, check for the end
+  RecordReplay* getReplay(){return replay_;}
   
   // GET functions
   // Read parameters
-  const double getCountsperForce(){return resp_.cpf;};
-  const double getCountsperTorque(){return resp_.cpt;};
+  const double getCountsperForce(){return static_cast<double>(counts_per_unit_.load() >> 32);};
+  const double getCountsperTorque(){return static_cast<double>(counts_per_unit_.load() & 0xffffffff);};
   // Read sensor values
   template<typename T>
   void getMeasurements(T measurements[6])
   {
     doComm();
-    
-    measurements[0]=static_cast<T>( resp_.Fx ) / static_cast<T>(resp_.cpf);
-    measurements[1]=static_cast<T>( resp_.Fy ) / static_cast<T>(resp_.cpf);
-    measurements[2]=static_cast<T>( resp_.Fz ) / static_cast<T>(resp_.cpf);
-  
-    measurements[3]=static_cast<T>( resp_.Tx ) / static_cast<T>(resp_.cpt);
-    measurements[4]=static_cast<T>( resp_.Ty ) / static_cast<T>(resp_.cpt);
-    measurements[5]=static_cast<T>( resp_.Tz ) / static_cast<T>(resp_.cpt);
+
+    measurements[0]=static_cast<T>( sample_.ft[0] );
+    measurements[1]=static_cast<T>( sample_.ft[1] );
+    measurements[2]=static_cast<T>( sample_.ft[2] );
+
+    measurements[3]=static_cast<T>( sample_.ft[3] );
+    measurements[4]=static_cast<T>( sample_.ft[4] );
+    measurements[5]=static_cast<T>( sample_.ft[5] );
   }
   template<typename T>
   void getMeasurements(T measurements[6],uint32_t& rdt_sequence)
   {
     getMeasurements<T>(measurements);
-    rdt_sequence = resp_.rdt_sequence;
+    rdt_sequence = sample_.rdt_sequence;
   }
   template<typename T>
   void getMeasurements(T measurements[6],uint32_t& rdt_sequence,uint32_t& ft_sequence)
   {
     getMeasurements<T>(measurements,rdt_sequence);
-    ft_sequence = resp_.ft_sequence;
+    ft_sequence = sample_.ft_sequence;
+  }
+  template<typename T>
+  void getMeasurements(T measurements[6],uint32_t& rdt_sequence,uint32_t& ft_sequence,uint64_t& timestamp)
+  {
+    getMeasurements<T>(measurements,rdt_sequence,ft_sequence);
+    timestamp = sample_.timestamp;
+  }
+  // The sample behind the last getMeasurements() call, with its timestamp
+  const Sample& getLastSample(){return sample_;}
+  // Newest sample received, lock-free and in bounded time. False if none yet
+  // or the receiver kept lapping the reader; age_ns is on CLOCK_REALTIME.
+  bool getLatestSample(Sample& sample){return latest_.load(sample);}
+  bool getLatestSample(Sample& sample, uint64_t& age_ns);
+  // True if timestamps are taken by the kernel when the datagram arrives,
+  // false if they fall back to the time the driver read it
+  bool hasKernelTimestamps(){return kernel_timestamps_;}
+  // Samples received since the last call, up to max : drains the ring with
+  // the receive thread, else the current datagram, receiving one if needed.
+  size_t readBatch(Sample* samples, size_t max);
+  // Same as readBatch() but into plain arrays. rdt_sequence and
+  // ft_sequence may be NULL. Returns the number of samples written.
+  template<typename T>
+  size_t getMeasurementsBatch(T measurements[][6], uint32_t rdt_sequence[], uint32_t ft_sequence[], size_t max)
+  {
+    Sample samples[RDT_MAX_RECORDS];
+    size_t count = 0;
+    while (count < max)
+    {
+      const size_t chunk = (max - count < RDT_MAX_RECORDS) ? max - count : RDT_MAX_RECORDS;
+      const size_t n = readBatch(samples, chunk);
+      for (size_t i = 0; i < n; ++i, ++count)
+      {
+        for (int j = 0; j < 6; ++j)
+          measurements[count][j] = static_cast<T>( samples[i].ft[j] );
+        if (rdt_sequence)
+          rdt_sequence[count] = samples[i].rdt_sequence;
+        if (ft_sequence)
+          ft_sequence[count] = samples[i].ft_sequence;
+      }
+      if (n < chunk || !isReceiveThreadRunning())
+        break;
+    }
+    return count;
   }
   // Write the ip of the sensor
   const std::string getIP(){return this->ip;}
   const uint16_t getPort(){return this->port;}
+  const uint16_t getHTTPPort(){return this->http_port_;}
+  // Set the RDT (UDP) and web server (TCP) ports, call these before init()
+  void setPort(uint16_t port);
+  void setHTTPPort(uint16_t port);
   std::string message_header(){std::stringstream ss;
                                ss << "[ft_sensor " <<  this->ip << ":" <<  this->port << "] ";
                                return ss.str();}
   const int getRDTRate(){return this->rdt_rate_;}
-  // Set the zero of the sensor	
+  // Set the zero of the sensor, applied by the sensor some time after the
+  // command is received. See tare() for a bias on the host.
   void setBias();
   void setTimeout(float sec);
   bool isInitialized();
   bool getCalibrationData();
   settings_error_t getSettings();
+  // Everything read from netftapi2.xml by the last getSettings() : serial
+  // numbers, calibration, units...
+  NetFTSettings getDeviceSettings();
   bool setRDTOutputRate(unsigned int rate);
   std::vector<int> getGaugeBias();
   bool setGaugeBias(unsigned int gauge_idx, int gauge_bias);
   bool setGaugeBias(std::map<unsigned int, int> &gauge_map);
   bool setGaugeBias(std::vector<int> &gauge_vect);
+  // Apply several settings at once, pipelined when the web server allows it
+  bool configure(const SettingsUpdate& update);
+  // Start from the settings cached on disk (see CalibrationCache) and check
+  // them in the background. Call before init().
+  void setCalibrationCache(bool enable, const std::string& directory = std::string());
+  calibration_source_t getCalibrationSource(){return static_cast<calibration_source_t>(calibration_source_.load());}
+  // Wait for the background refresh started by init(), if any. Returns true
+  // if the values in use come from the sensor.
+  bool waitCalibrationRefresh();
+  // Streaming mode : a background thread drains the socket continuously
+  // into a lock-free ring, getMeasurements() then never touches the socket.
+  // Must be called after init().
+  bool startReceiveThread(stream_read_t policy = READ_NEWEST, size_t ring_size = 1024);
+  void stopReceiveThread();
+  // Real-time setup of the receive thread (see realtime.h), applied by
+  // startReceiveThread(), which fails if any of it can't be
+  bool setRealtimeConfig(const RealtimeConfig& config);
+  const RealtimeConfig& getRealtimeConfig(){return realtime_;}
+  // True while the ring is fed, by our own thread or by a SensorGroup
+  bool isReceiveThreadRunning();
+  // Samples lost because the consumer did not keep up with the ring
+  uint64_t getDroppedSamples();
+  // Wake the receive thread every period_us to drain the socket at once,
+  // rather than on every datagram (0)
+  void setReceiveBatchPeriod(unsigned int period_us);
+  // Losses, reordering and duplicates seen in the rdt_sequence of the
+  // records received so far. Duplicates are never handed out.
+  SequenceStats getSequenceStats(){return sequence_.stats();}
+  void resetSequenceStats(){sequence_.resetStats();}
+  // Also drop records arriving after a more recent one (default false)
+  void setDropStalePackets(bool drop);
+  // Called by the receiving thread with the filtered samples of each
+  // datagram, before they are queued. Keep it short.
+  typedef std::function<void(const Sample* samples, size_t n)> sample_callback_t;
+  bool setSampleCallback(const sample_callback_t& callback);
+  // Publish the filtered samples in shared memory for ShmReader (see
+  // shm_stream.h), untared
+  bool startSharing(const std::string& name, size_t capacity = 65536);
+  void stopSharing();
+  bool isSharing(){return shm_ != NULL;}
+  // Filter continuous streams at the RDT rate; polled samples pass through.
+  // False if the rate is unknown or too low for some stages.
+  bool setFilter(const FTFilter& filter);
+  void clearFilter(){setFilter(FTFilter());}
+  const FTFilter& getFilter(){return filter_;}
+  // Keep one sample in factor of continuous streams after the filter,
+  // anti-aliased (see FTDecimator). 1 turns it off.
+  bool setDecimation(unsigned int factor, unsigned int taps_per_phase = 16);
+  unsigned int getDecimation(){return decimator_.factor();}
+  // Rate of the samples handed out, in Hz, or 0 when polling
+  double getOutputRate(){return streamsContinuously() ? static_cast<double>(rdt_rate_) / decimator_.factor() : 0;}
+  // Tare profile on the host with the mean of the last n samples, see
+  // HostBias::tare(). The Tared reads subtract the offset of a profile.
+  bool tare(unsigned int profile = 0, size_t n = 100, double reject = 0);
+  void clearTare(unsigned int profile = 0){host_bias_.clear(profile);}
+  bool getTare(unsigned int profile, double offset[6]){return host_bias_.offset(profile, offset);}
+  template<typename T>
+  void getTaredMeasurements(T measurements[6], unsigned int profile)
+  {
+    getMeasurements<T>(measurements);
+    host_bias_.apply(profile, measurements);
+  }
+  size_t readTaredBatch(Sample* samples, size_t max, unsigned int profile)
+  {
+    const size_t n = readBatch(samples, max);
+    host_bias_.apply(profile, samples, n);
+    return n;
+  }
+  // Frames attached to the sensor (see WrenchTransform), set up before
+  // reading by the thread that reads
+  size_t addFrame(const std::string& name, const WrenchTransform& transform){return frames_.add(name, transform);}
+  const WrenchFrames& getFrames(){return frames_;}
+  // readBatch(), tared with profile unless negative, into frames[k] for
+  // each frame k. Returns the samples written to each.
+  size_t readBatchInFrames(Sample* const frames[], size_t max, int profile = -1);
 
 protected:
   // Socket info
@@ -169,30 +371,118 @@ protected:
   bool sendCommand();
   bool sendCommand(uint16_t cmd);
   bool getResponse();
+  // Whether consecutive samples are one RDT period apart
+  bool streamsContinuously(){return replay_ ? replay_continuous_ : cmd_.sample_count == 0;}
   bool sendTCPrequest(std::string &request_cmd);
+  std::string httpHost();
+  bool setReceiveTimeout(const struct timeval& tv);
+  // Read the settings from the web server into data, without applying them
+  settings_error_t fetchSettings(CalibrationData& data);
+  settings_error_t getSettings(CalibrationData& data);
+  void applySettings(const CalibrationData& data);
+  // Use the cache or the web server, called by init()
+  void loadCalibration();
+  static void* calibrationRefreshEntry(void* arg);
+  void calibrationRefresh();
+  // cpf and cpt are swapped together, the receive thread may be converting
+  void setCountsPerUnit(uint32_t cpf, uint32_t cpt){counts_per_unit_ = (static_cast<uint64_t>(cpf) << 32) | cpt;}
+  void getCountsPerUnit(uint32_t& cpf, uint32_t& cpt){const uint64_t c = counts_per_unit_.load();
+                                                       cpf = static_cast<uint32_t>(c >> 32);
+                                                       cpt = static_cast<uint32_t>(c);}
   void doComm();
+  static void* receiveThreadEntry(void* arg);
+  void receiveLoop();
+  // Switch to a continuous stream feeding a new ring, and back
+  bool beginStreaming(stream_read_t policy, size_t ring_size);
+  void endStreaming();
+  // Receive, decode and push to the ring whatever the socket holds.
+  // Returns the number of datagrams, 0 on timeout, -1 on error.
+  int drainSocket(bool wait);
+  // Called by the receiving thread when drainSocket() fails. Errors other
+  // than timeouts are reported once a second; returns true for those.
+  bool receiveFailed(int error);
+  // Through filter_, designed for the current RDT rate, recorded for
+  // taring, then through decimator_. Returns the number of samples left at the start of samples.
+  size_t filterSamples(Sample* samples, size_t n);
   std::string ip;
   uint16_t port;
+  uint16_t http_port_;
   int calibration_index;
-  int rdt_rate_;
+  std::atomic<int> rdt_rate_;
   int *setbias_;
   int socketHandle_;
-  int socketHTTPHandle_;  
+  // Web server of the sensor
+  HttpClient http_;
   struct sockaddr_in addr_; 
   socklen_t addr_len_;
   struct hostent *hePtr_;
 
   // Communication protocol
   response_s resp_;
+  // Counts per force in the high half, per torque in the low half
+  std::atomic<uint64_t> counts_per_unit_;
+  // Last sample handed out by getMeasurements()
+  Sample sample_;
+  // Newest sample received, for getLatestSample()
+  LatestSlot<Sample> latest_;
+  RealtimeConfig realtime_;
   command_s cmd_;
   unsigned char request_[8];    
-  unsigned char response_[RDT_RECORD_SIZE];
+  unsigned char response_[RDT_MAX_DATAGRAM_SIZE];
+  // Records of the last datagram not handed out yet
+  Sample records_[RDT_MAX_RECORDS];
+  size_t records_count_;
+  size_t records_pos_;
+  // Records still expected from the last start command
+  uint32_t requested_remaining_;
+  SequenceTracker sequence_;
+  sample_callback_t sample_callback_;
+  FTFilter filter_;
+  FTDecimator decimator_;
+  HostBias host_bias_;
+  WrenchFrames frames_;
   bool initialized_;
   bool timeout_set_;
+  bool kernel_timestamps_;
   struct timeval timeval_;
   int response_ret_;
-  char xml_c_[MAX_XML_SIZE];
-  std::string xml_s_;
+  NetFTSettings device_settings_;
+  // Serializes the web server requests, and the settings they update
+  pthread_mutex_t http_mutex_;
+
+  // Calibration cache
+  bool use_calibration_cache_;
+  std::string calibration_cache_dir_;
+  CalibrationData cached_calibration_;
+  std::atomic<int> calibration_source_;
+  pthread_t calibration_thread_;
+  bool calibration_thread_running_;
+
+  // Streaming mode
+  pthread_t receive_thread_;
+  std::atomic<bool> receive_thread_running_;
+  std::atomic<bool> stop_receive_thread_;
+  std::atomic<uint64_t> dropped_samples_;
+  stream_read_t stream_read_;
+  uint32_t stream_sample_count_;
+  unsigned int receive_batch_period_us_;
+  time_t receive_error_report_;
+  unsigned long receive_errors_;
+  SpscRing<Sample> *ring_;
+  RDTReceiver *receiver_;
+  // Group whose thread feeds the ring, if any
+  SensorGroup *group_;
+  // Where received records are also recorded, if any
+  RecorderChannel *recorder_;
+  // Recording served instead of the socket, if any
+  RecordReplay *replay_;
+  // The recording streamed continuously rather than request by request
+  bool replay_continuous_;
+  // Told once that polled samples bypass the filter and decimation
+  bool polling_warned_;
+  ShmPublisher *shm_;
 
 };
 }
+
+#endif
@@ -0,0 +1,115 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_HOST_BIAS_H
+#define ATI_SENSOR_HOST_BIAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+
+#include "ati_sensor/spsc_ring.h"
+
+namespace ati{
+
+struct Sample;
+
+// Taring on the host, without any command to the sensor.
+// One thread records the samples as they are decoded into a history;
+// tare() averages the most recent ones into an offset profile, which the
+// readers subtract from what they hand out. Each controller can use its own
+// profile, taring one does not change the others.
+// The history and the profiles are versioned : readers retry instead of
+// locking, the recording thread never waits.
+class HostBias{
+public:
+  static const unsigned int MAX_PROFILES = 8;
+
+  // Up to history / 2 samples can be averaged
+  explicit HostBias(size_t history = 2048);
+
+  // Recording thread side
+  void record(const Sample* samples, size_t n);
+  // Forget the history, e.g. when the stream is replaced
+  void restart();
+
+  // Store the mean of the last n recorded samples in profile. With reject
+  // > 0, samples further than reject standard deviations from the mean on
+  // some axis are left out, and the mean is taken again over the others.
+  // Returns false if fewer than n samples were recorded.
+  bool tare(unsigned int profile, size_t n, double reject = 0);
+  // A profile is tared or cleared by one thread at a time
+  void clear(unsigned int profile);
+  // Offset of profile, zero until tared. Returns false for an invalid profile.
+  bool offset(unsigned int profile, double offset[6]) const;
+  size_t maxSamples() const {return capacity_ / 2;}
+  uint64_t recorded() const {return head_.load(std::memory_order_acquire);}
+
+  // Subtract the offset of profile
+  void apply(unsigned int profile, Sample* samples, size_t n) const;
+  template<typename T>
+  void apply(unsigned int profile, T measurements[6]) const
+  {
+    double o[6];
+    if (!offset(profile, o))
+      return;
+    for (int j = 0; j < 6; ++j)
+      measurements[j] -= static_cast<T>(o[j]);
+  }
+
+private:
+  HostBias(const HostBias&);
+  HostBias& operator=(const HostBias&);
+
+  struct Profile {
+    Profile() : version(0) {for (int j = 0; j < 6; ++j) offset[j] = 0;}
+    // Odd while the offset is being written
+    std::atomic<uint32_t> version;
+    double offset[6];
+  };
+  void store(unsigned int profile, const double offset[6]);
+
+  size_t capacity_;
+  // Positions in the history, see claimed_ring.h, on a line of their own
+  char capacity_pad_[CACHE_LINE_SIZE - sizeof(size_t)];
+  std::atomic<uint64_t> claimed_;
+  std::atomic<uint64_t> head_;
+  char head_pad_[CACHE_LINE_SIZE - 2 * sizeof(std::atomic<uint64_t>)];
+  std::vector<double> history_;
+  Profile profiles_[MAX_PROFILES];
+};
+
+}
+
+#endif
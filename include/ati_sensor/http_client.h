@@ -0,0 +1,111 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_HTTP_CLIENT_H
+#define ATI_SENSOR_HTTP_CLIENT_H
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+// Largest response kept, netftapi2.xml is a few kilobytes
+#define HTTP_MAX_RESPONSE_SIZE 65536
+
+namespace ati{
+
+// Minimal HTTP/1.1 client for the web server of the Net F/T : GET requests
+// only, responses delimited by Content-Length or by the end of the
+// connection. The connection is kept open when the server allows it and
+// reopened transparently when it does not, which the Net F/T firmware
+// does after every response. Uses RTnet sockets in Xenomai builds.
+class HttpClient{
+public:
+  HttpClient();
+  ~HttpClient();
+
+  // Closes the connection if the server changes
+  void setServer(const std::string& host, uint16_t port);
+  void setTimeout(const struct timeval& tv);
+  // Ask the server to keep the connection open (default true)
+  void setKeepAlive(bool keep_alive);
+
+  // Returns the HTTP status code, or -1 if no valid response was received.
+  // The body stays valid until the next request.
+  int get(const std::string& target);
+  // Send every request in one write (HTTP pipelining), then read the
+  // responses in order. Requests left unanswered when the server closes
+  // the connection are sent again on a new one. status receives one code
+  // per target, -1 for failures. Returns the number of responses received.
+  size_t get(const std::vector<std::string>& targets, std::vector<int>& status);
+
+  const char* body() const {return &buffer_[body_offset_];}
+  size_t bodyLength() const {return body_length_;}
+
+  void close();
+  bool isConnected() const {return socket_ >= 0;}
+  // Connections opened so far
+  uint64_t connections() const {return connections_;}
+
+private:
+  HttpClient(const HttpClient&);
+  HttpClient& operator=(const HttpClient&);
+
+  bool connect();
+  bool sendAll(const std::string& data);
+  // Read one response from the connection. Returns its status, -1 on error,
+  // 0 if the connection was closed before the first byte.
+  int readResponse();
+  // Bytes already received beyond the current response are kept for the
+  // next one
+  void discardResponse();
+
+  std::string host_;
+  uint16_t port_;
+  struct timeval timeout_;
+  bool keep_alive_;
+  int socket_;
+  // Whether the server will close the connection after the current response
+  bool server_closes_;
+  std::vector<char> buffer_;
+  size_t buffer_used_;
+  size_t response_length_;
+  size_t body_offset_;
+  size_t body_length_;
+  uint64_t connections_;
+};
+
+}
+
+#endif
@@ -0,0 +1,113 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_LATEST_SLOT_H
+#define ATI_SENSOR_LATEST_SLOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "ati_sensor/spsc_ring.h"
+
+namespace ati{
+
+// Newest value written by one thread, for any number of readers.
+// The writer rotates over a few versioned copies, so a reader copying one
+// is only disturbed if the writer laps all of them meanwhile; it then
+// retries on the copy just written, a bounded number of times. Neither
+// side locks, allocates or makes system calls, the writer never waits.
+template<typename T, unsigned int COPIES = 4>
+class LatestSlot{
+public:
+  static const unsigned int MAX_ATTEMPTS = COPIES;
+
+  LatestSlot() : written_(0)
+  {
+    for (unsigned int i = 0; i < COPIES; ++i)
+      copies_[i].version.store(0, std::memory_order_relaxed);
+  }
+
+  // Writer side
+  void store(const T& value)
+  {
+    const uint64_t written = written_.load(std::memory_order_relaxed);
+    Copy& c = copies_[written % COPIES];
+    const uint32_t version = c.version.load(std::memory_order_relaxed);
+    c.version.store(version + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    c.value = value;
+    c.version.store(version + 2, std::memory_order_release);
+    written_.store(written + 1, std::memory_order_release);
+  }
+
+  // Reader side. False if nothing was written yet, or if the writer lapped
+  // every copy on each of the MAX_ATTEMPTS attempts (a reader preempted
+  // for that long has stale data anyway)
+  bool load(T& value) const
+  {
+    for (unsigned int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt)
+    {
+      const uint64_t written = written_.load(std::memory_order_acquire);
+      if (written == 0)
+        return false;
+      const Copy& c = copies_[(written - 1) % COPIES];
+      const uint32_t version = c.version.load(std::memory_order_acquire);
+      if (version & 1)
+        continue;
+      value = c.value;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (c.version.load(std::memory_order_relaxed) == version)
+        return true;
+    }
+    return false;
+  }
+
+  // Values ever written
+  uint64_t written() const {return written_.load(std::memory_order_acquire);}
+
+private:
+  struct Copy {
+    // Odd while the value is being written
+    std::atomic<uint32_t> version;
+    T value;
+  };
+  // Readers poll written_, keep it off the lines being written
+  std::atomic<uint64_t> written_;
+  char written_pad_[CACHE_LINE_SIZE - sizeof(std::atomic<uint64_t>)];
+  Copy copies_[COPIES];
+};
+
+}
+
+#endif
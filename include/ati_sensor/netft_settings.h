@@ -0,0 +1,92 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_NETFT_SETTINGS_H
+#define ATI_SENSOR_NETFT_SETTINGS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace ati{
+
+// The fields of netftapi2.xml the driver uses
+struct NetFTSettings {
+  // Bits of found
+  enum field_t
+  {
+    CPF                 = 1 << 0,   // cfgcpf
+    CPT                 = 1 << 1,   // cfgcpt
+    GAUGE_BIAS          = 1 << 2,   // setbias
+    RDT_RATE            = 1 << 3,   // comrdtrate
+    RDT_BUFFER_SIZE     = 1 << 4,   // comrdtbsiz
+    CALIBRATION_INDEX   = 1 << 5,   // cfgcalsel
+    FORCE_UNITS         = 1 << 6,   // scfgfu
+    TORQUE_UNITS        = 1 << 7,   // scfgtu
+    SERIAL              = 1 << 8,   // setserial
+    FIRMWARE            = 1 << 9,   // setfwver
+    CALIBRATION_SERIAL  = 1 << 10,  // calsn
+    CALIBRATION_PART    = 1 << 11,  // calpartnum
+    CALIBRATION_DATE    = 1 << 12   // calcaldt
+  };
+
+  NetFTSettings();
+  void clear();
+  bool has(uint32_t fields) const {return (found & fields) == fields;}
+
+  uint32_t found;
+  uint32_t cpf;
+  uint32_t cpt;
+  int gauge_bias[6];
+  int rdt_rate;
+  int rdt_buffer_size;
+  int calibration_index;
+  // Truncated to fit, always null-terminated
+  char force_units[16];
+  char torque_units[16];
+  char serial[32];
+  char firmware[32];
+  char calibration_serial[32];
+  char calibration_part[32];
+  char calibration_date[32];
+};
+
+// Scan a netftapi2.xml document, or a whole HTTP response holding one, in
+// a single pass and without allocating. The buffer does not have to be
+// null-terminated. Fields that are absent or cannot be parsed are left
+// untouched and their bit is not set; when a tag appears twice the last
+// one wins. Returns the number of fields found.
+unsigned int parseNetFTSettings(const char* xml, size_t length, NetFTSettings& settings);
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_RDT_RECEIVER_H
+#define ATI_SENSOR_RDT_RECEIVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct mmsghdr;
+struct iovec;
+
+namespace ati{
+
+// Ask the kernel to stamp every datagram received on this socket with its
+// arrival time (SO_TIMESTAMPNS). Returns false where this is not supported.
+bool enableReceiveTimestamps(int socket);
+
+// recv() a single datagram, also returning its kernel arrival time in
+// nanoseconds since the epoch (CLOCK_REALTIME), or 0 if it carries none.
+int receiveTimestamped(int socket, void* buffer, size_t size, int flags, uint64_t& timestamp);
+
+// Batched datagram receive engine.
+// Pulls as many queued datagrams as possible per syscall (recvmmsg on
+// Linux, a non-blocking recv loop otherwise) into preallocated buffers.
+// Nothing allocates after construction.
+class RDTReceiver{
+public:
+  RDTReceiver(size_t max_datagrams = 64, size_t datagram_size = 36);
+  ~RDTReceiver();
+
+  // Receive up to max_datagrams() datagrams from the socket.
+  // If wait is true, blocks for the first one (the socket timeout applies),
+  // then takes whatever is already queued without blocking.
+  // Returns the number of datagrams received, 0 on timeout, -1 on error.
+  int receive(int socket, bool wait = true);
+
+  // Access to the datagrams of the last receive() call
+  const unsigned char* data(size_t i) const {return &buffer_[i * datagram_size_];}
+  int length(size_t i) const {return lengths_[i];}
+  // Kernel arrival time in nanoseconds since the epoch, 0 if unavailable
+  uint64_t timestamp(size_t i) const {return timestamps_[i];}
+
+  size_t maxDatagrams() const {return max_datagrams_;}
+  size_t datagramSize() const {return datagram_size_;}
+
+  // Statistics since construction
+  uint64_t syscalls() const {return syscalls_;}
+  uint64_t datagrams() const {return datagrams_;}
+
+private:
+  RDTReceiver(const RDTReceiver&);
+  RDTReceiver& operator=(const RDTReceiver&);
+
+  size_t max_datagrams_;
+  size_t datagram_size_;
+  std::vector<unsigned char> buffer_;
+  std::vector<int> lengths_;
+  std::vector<uint64_t> timestamps_;
+  std::vector<unsigned char> control_;
+  struct mmsghdr *msgs_;
+  struct iovec *iov_;
+  uint64_t syscalls_;
+  uint64_t datagrams_;
+};
+
+}
+
+#endif
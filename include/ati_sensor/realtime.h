@@ -0,0 +1,78 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_REALTIME_H
+#define ATI_SENSOR_REALTIME_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+namespace ati{
+
+// Real-time setup of a receiving thread on PREEMPT_RT (or stock) Linux,
+// without Xenomai. The defaults leave everything as the system sets it.
+struct RealtimeConfig {
+  int priority;           // SCHED_FIFO priority (1-99), 0 keeps the normal scheduler
+  int cpu;                // core the thread is pinned to, -1 for any
+  bool lock_memory;       // mlockall() the process and keep the heap mapped, for good
+  size_t prefault_stack;  // stack bytes touched when the thread starts
+  int socket_buffer;      // SO_RCVBUF in bytes, 0 keeps the system default
+
+  RealtimeConfig()
+  : priority(0), cpu(-1), lock_memory(false), prefault_stack(0), socket_buffer(0) {}
+  // Priority 80 on cpu, memory locked, 256 kB of stack and 1 MB of socket buffer
+  static RealtimeConfig fifo(int priority = 80, int cpu = -1);
+};
+
+// Create a thread with the policy, priority and affinity of config set
+// before it runs. Returns the pthread_create() error : EPERM if the process
+// may not use SCHED_FIFO (see RLIMIT_RTPRIO), EINVAL for a bad priority or
+// cpu.
+int createRealtimeThread(pthread_t& thread, const RealtimeConfig& config, void* (*entry)(void*), void* arg);
+// Lock the pages of the process in memory, now and to come, and keep
+// freed heap memory mapped so that later allocations do not fault.
+// Returns false, errno set, if the pages could not be locked. Never undone,
+// even if the thread it was taken for then fails to start : it is process
+// wide and other real-time threads may rely on it.
+bool lockProcessMemory();
+// Touch bytes of the stack of the calling thread so that it does not fault
+// later. Stack pages, once mapped, stay mapped.
+void prefaultStack(size_t bytes);
+// Size the receive buffer of socket, beyond net.core.rmem_max when allowed
+// to (CAP_NET_ADMIN). Returns the size reported by the kernel, which on
+// Linux counts its bookkeeping and is twice what was granted, -1 on error.
+int setSocketReceiveBuffer(int socket, int bytes);
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_SENSOR_GROUP_H
+#define ATI_SENSOR_SENSOR_GROUP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include <atomic>
+#include <pthread.h>
+
+#include "ati_sensor/ft_sensor.h"
+
+namespace ati{
+
+// Receives the RDT streams of many sensors on a single thread.
+// Instead of one receive thread per sensor, each blocking on its own socket,
+// one epoll loop waits on all of them and drains whichever are readable.
+// Each sensor keeps its own ring : consumers use getMeasurements() and
+// readBatch() on the sensors exactly as with startReceiveThread().
+class SensorGroup{
+public:
+  SensorGroup();
+  ~SensorGroup();
+
+  // Sensors must be initialized, and are added before start().
+  // A sensor being destroyed removes itself from its group.
+  bool add(FTSensor* sensor);
+  // Stops the loop if needed and gives the sensor back in request/response mode
+  void remove(FTSensor* sensor);
+  size_t size() const {return sensors_.size();}
+
+  bool start(FTSensor::stream_read_t policy = FTSensor::READ_NEWEST, size_t ring_size = 1024);
+  void stop();
+  bool isRunning() const {return running_.load(std::memory_order_acquire);}
+
+  // Like FTSensor::setReceiveBatchPeriod(), for the whole group :
+  // sleep for the period, then drain every socket at once
+  void setBatchPeriod(unsigned int period_us);
+  // Like FTSensor::setRealtimeConfig(), for the thread of the group and the
+  // socket of every sensor
+  void setRealtimeConfig(const RealtimeConfig& config);
+
+  // Statistics since start()
+  uint64_t wakeups() const {return wakeups_.load(std::memory_order_relaxed);}
+  uint64_t datagrams() const {return datagrams_.load(std::memory_order_relaxed);}
+
+private:
+  SensorGroup(const SensorGroup&);
+  SensorGroup& operator=(const SensorGroup&);
+
+  static void* loopEntry(void* arg);
+  void loop();
+
+  std::vector<FTSensor*> sensors_;
+  FTSensor::stream_read_t policy_;
+  size_t ring_size_;
+  unsigned int batch_period_us_;
+  RealtimeConfig realtime_;
+  int epoll_fd_;
+  int wake_fd_;
+  pthread_t thread_;
+  std::atomic<bool> running_;
+  std::atomic<bool> stop_;
+  std::atomic<uint64_t> wakeups_;
+  std::atomic<uint64_t> datagrams_;
+};
+
+}
+
+#endif
@@ -0,0 +1,103 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_SEQUENCE_TRACKER_H
+#define ATI_SENSOR_SEQUENCE_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+namespace ati{
+
+// Cumulative counters, see SequenceTracker
+struct SequenceStats {
+  uint64_t received;        // records seen, including duplicates and stale ones
+  uint64_t lost;            // sequence numbers skipped and never received
+  uint64_t reordered;       // records arriving after a later one, within the last 64
+  uint64_t duplicates;      // records whose sequence number was already seen
+  uint64_t stale_dropped;   // out-of-order records dropped before the consumer,
+                            // always those older than the last 64
+  uint64_t resyncs;         // jumps too large to be loss, e.g. a device restart
+  double recent_loss_rate;  // fraction lost over the last completed window
+};
+
+// Tracks the rdt_sequence of the records of one sensor to detect losses,
+// reordering and duplicates. Late records within the last 64 sequence
+// numbers are told apart from duplicates with a bitmap, like IPsec replay
+// protection; a late record recovers the loss counted when it was skipped.
+// Older records can't be told from duplicates, they are dropped as stale.
+// Updated by one thread, counters can be read from any thread.
+class SequenceTracker{
+public:
+  // Recent loss rate is computed over windows of this many expected records
+  SequenceTracker(uint32_t loss_window = 1000);
+
+  // Forget the last sequence number, e.g. when the device restarts streaming
+  // from 1. Counters are kept.
+  void restart();
+  // Same, if rdt_sequence looks like the first record of a new request :
+  // 1, or further back than the duplicate bitmap. For recordings, where
+  // the start commands are not seen.
+  void restartIfRenumbered(uint32_t rdt_sequence);
+  // Account for a record. Returns false if it should not be handed to the
+  // consumer : a duplicate, a record older than the last 64, or an
+  // out-of-order record when dropStale is set.
+  bool update(uint32_t rdt_sequence);
+
+  void setDropStale(bool drop) {drop_stale_ = drop;}
+  bool dropStale() const {return drop_stale_;}
+
+  SequenceStats stats() const;
+  void resetStats();
+
+private:
+  bool started_;
+  bool drop_stale_;
+  uint32_t last_;
+  uint64_t window_;           // bit i set : last_ - i was received
+  uint32_t loss_window_;
+  uint32_t window_expected_;
+  uint32_t window_lost_;
+  std::atomic<uint64_t> received_;
+  std::atomic<uint64_t> lost_;
+  std::atomic<uint64_t> reordered_;
+  std::atomic<uint64_t> duplicates_;
+  std::atomic<uint64_t> stale_dropped_;
+  std::atomic<uint64_t> resyncs_;
+  std::atomic<double> recent_loss_rate_;
+};
+
+}
+
+#endif
@@ -0,0 +1,147 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_SHM_STREAM_H
+#define ATI_SENSOR_SHM_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <atomic>
+
+#include "ati_sensor/ft_sensor.h"
+
+// Shared memory layout, /dev/shm/ati_sensor.<name>, host byte order :
+//   ShmStreamHeader, padded to SHM_STREAM_HEADER_SIZE bytes
+//   Sample[capacity]
+#define SHM_STREAM_MAGIC "ATIFTSHM"
+#define SHM_STREAM_VERSION 1
+#define SHM_STREAM_HEADER_SIZE 4096
+
+namespace ati{
+
+// The atomics are shared between processes, they must not hide a lock
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "shared memory streams need lock-free 32 and 64 bit atomics");
+
+struct ShmStreamHeader {
+  char magic[8];                // SHM_STREAM_MAGIC, written last
+  uint32_t version;
+  uint32_t sample_size;         // sizeof(Sample)
+  uint64_t capacity;            // samples in the ring, a power of two
+  uint32_t rate;                // samples per second when the stream was shared
+  int32_t owner_pid;
+  std::atomic<uint32_t> closed; // set when the owner stops sharing
+  // Positions in the ring, see claimed_ring.h
+  alignas(64) std::atomic<uint64_t> claimed;
+  std::atomic<uint64_t> head;
+  // Copy of the newest sample, odd version while it is written
+  alignas(64) std::atomic<uint32_t> latest_version;
+  Sample latest;
+};
+
+// Owner side of a shared stream : one thread writes every sample it is
+// given into a ring and a latest slot in shared memory. Never blocks, and
+// does not know about the readers, a slow one loses the oldest samples.
+class ShmPublisher{
+public:
+  ShmPublisher();
+  ~ShmPublisher();
+
+  // Create the stream, replacing any previous one of that name. Readers
+  // attached to a replaced stream see it closed.
+  bool open(const std::string& name, size_t capacity = 65536, uint32_t rate = 0);
+  // Mark the stream closed and remove it; attached readers keep their mapping
+  void close();
+  bool isOpen() const {return header_ != NULL;}
+  const std::string& name() const {return name_;}
+
+  // Writing thread side
+  void publish(const Sample* samples, size_t n);
+
+private:
+  ShmPublisher(const ShmPublisher&);
+  ShmPublisher& operator=(const ShmPublisher&);
+
+  std::string name_;
+  ShmStreamHeader* header_;
+  Sample* ring_;
+  size_t map_size_;
+  uint64_t mask_;
+};
+
+// Reader side : maps a stream shared by another process (or this one).
+// Reading is plain loads from the mapping, no system call. Each reader has
+// its own position, any number of them can read concurrently.
+class ShmReader{
+public:
+  ShmReader();
+  ~ShmReader();
+
+  // Map the stream of name, reading from the newest sample on
+  bool attach(const std::string& name);
+  void detach();
+  bool isAttached() const {return header_ != NULL;}
+  // False once the owner stopped sharing, replaced the stream or died (this
+  // one makes a system call)
+  bool isLive() const;
+  uint32_t rate() const {return header_ ? header_->rate : 0;}
+
+  // The newest sample, false if none was written yet, once the stream is
+  // closed, or if it was being written on every attempt (the owner is
+  // preempted, or died, in the middle of a write : see isLive())
+  bool latest(Sample& sample) const;
+  // Samples written since the previous call, oldest first, up to max.
+  // Those overwritten before they could be read are skipped and counted.
+  size_t read(Sample* samples, size_t max);
+  // Position at the newest sample, dropping what was not read
+  void skipToLatest();
+  uint64_t lost() const {return lost_;}
+  // Samples written but not read yet
+  uint64_t pending() const;
+
+private:
+  ShmReader(const ShmReader&);
+  ShmReader& operator=(const ShmReader&);
+
+  const ShmStreamHeader* header_;
+  const Sample* ring_;
+  size_t map_size_;
+  uint64_t mask_;
+  uint64_t cursor_;
+  uint64_t lost_;
+};
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_SPSC_RING_H
+#define ATI_SENSOR_SPSC_RING_H
+
+#include <stddef.h>
+#include <vector>
+#include <atomic>
+
+// Members written by different threads are padded onto lines of their own
+// rather than aligned : new does not honor extended alignment in C++11
+#define CACHE_LINE_SIZE 64
+
+namespace ati{
+
+// Bounded single-producer/single-consumer lock-free ring.
+// One thread may push(), one (other) thread may pop(). Storage is
+// allocated once in the constructor, nothing allocates afterwards.
+template<typename T>
+class SpscRing{
+public:
+  // The capacity is rounded up to the next power of two
+  explicit SpscRing(size_t capacity = 1024)
+  : head_(0), tail_(0)
+  {
+    size_t size = 2;
+    while(size < capacity)
+      size <<= 1;
+    mask_ = size - 1;
+    buffer_.resize(size);
+  }
+
+  size_t capacity() const {return mask_ + 1;}
+
+  // Producer side. Returns false (and drops the element) if the ring is full
+  bool push(const T& value)
+  {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if(head - tail_.load(std::memory_order_acquire) > mask_)
+      return false;
+    buffer_[head & mask_] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Pops the oldest element
+  bool pop(T& value)
+  {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if(tail == head_.load(std::memory_order_acquire))
+      return false;
+    value = buffer_[tail & mask_];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Discards everything but the newest element
+  bool popLatest(T& value)
+  {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t head = head_.load(std::memory_order_acquire);
+    if(tail == head)
+      return false;
+    value = buffer_[(head - 1) & mask_];
+    tail_.store(head, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate when called concurrently with push()/pop()
+  size_t size() const
+  {
+    return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+  }
+  bool empty() const {return size() == 0;}
+
+  // Consumer side. Drops all pending elements
+  void clear()
+  {
+    tail_.store(head_.load(std::memory_order_acquire), std::memory_order_release);
+  }
+
+private:
+  // Keep producer and consumer indexes on separate cache lines
+  std::atomic<size_t> head_;
+  char head_pad_[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> tail_;
+  char tail_pad_[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  size_t mask_;
+  std::vector<T> buffer_;
+};
+
+}
+
+#endif
@@ -0,0 +1,102 @@
+// This file is a part of the orca framework.
+// Copyright 2017, ISIR / Universite Pierre et Marie Curie (UPMC)
+// Main contributor(s): Antoine Hoarau, hoarau@isir.upmc.fr
+// 
+// This software is a computer program whose purpose is to [describe
+// functionalities and technical features of your software].
+// 
+// This software is governed by the CeCILL-C license under French law and
+// abiding by the rules of distribution of free software.  You can  use, 
+// modify and/ or redistribute the software under the terms of the CeCILL-C
+// license as circulated by CEA, CNRS and INRIA at the following URL
+// "http://www.cecill.info". 
+// 
+// As a counterpart to the access to the source code and  rights to copy,
+// modify and redistribute granted by the license, users are provided only
+// with a limited warranty  and the software's author,  the holder of the
+// economic rights,  and the successive licensors  have only  limited
+// liability. 
+// 
+// In this respect, the user's attention is drawn to the risks associated
+// with loading,  using,  modifying and/or developing or reproducing the
+// software by the user in light of its specific status of free software,
+// that may mean  that it is complicated to manipulate,  and  that  also
+// therefore means  that it is reserved for developers  and  experienced
+// professionals having in-depth computer knowledge. Users are therefore
+// encouraged to load and test the software's suitability as regards their
+// requirements in conditions enabling the security of their systems and/or 
+// data to be ensured and,  more generally, to use and operate it in the 
+// same conditions as regards security. 
+// 
+// The fact that you are presently reading this means that you have had
+// knowledge of the CeCILL-C license and that you accept its terms.
+
+#ifndef ATI_SENSOR_WRENCH_TRANSFORM_H
+#define ATI_SENSOR_WRENCH_TRANSFORM_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace ati{
+
+struct Sample;
+
+// Change of frame of a wrench, from the sensor frame to a frame rigidly
+// attached to it (tool, end effector...), given the pose of the sensor in
+// that frame : rotation R of the sensor axes and position t of the sensor
+// origin. This is the adjoint of the pose acting on wrenches,
+//   f' = R f        tau' = R tau + t x (R f)
+// i.e. the 6x6 matrix [R 0; [t]x R  R], of which the zero block is skipped.
+class WrenchTransform{
+public:
+  // Identity
+  WrenchTransform();
+  // rotation is row major, translation in meters
+  WrenchTransform(const double rotation[9], const double translation[3]);
+  // Unit quaternion (x, y, z, w), as given by tf
+  static WrenchTransform fromQuaternion(double qx, double qy, double qz, double qw,
+                                        double tx, double ty, double tz);
+
+  // Sensor frame to the frame of other, through this one : other * this
+  WrenchTransform then(const WrenchTransform& other) const;
+  WrenchTransform inverse() const;
+
+  void apply(const double in[6], double out[6]) const;
+  // in and out may be the same; only ft[] is transformed, the rest is copied
+  void apply(const Sample* in, size_t n, Sample* out) const;
+
+  // Full 6x6 matrix, row major
+  void matrix(double m[36]) const;
+
+private:
+  friend class WrenchFrames;
+  double r_[9];       // R
+  double tr_[9];      // [t]x R
+  double t_[3];
+};
+
+// Named frames of one sensor, filled from one pass over the samples : each
+// sample is loaded once and written out in every frame.
+class WrenchFrames{
+public:
+  // Returns the index of the frame, replaced if the name exists
+  size_t add(const std::string& name, const WrenchTransform& transform);
+  void clear();
+  size_t size() const {return transforms_.size();}
+  const std::string& name(size_t frame) const {return names_[frame];}
+  // -1 if there is no such frame
+  int find(const std::string& name) const;
+  const WrenchTransform& transform(size_t frame) const {return transforms_[frame];}
+
+  // out[k] receives the n samples in frame k from out[k][at], for every frame
+  void apply(const Sample* in, size_t n, Sample* const out[], size_t at = 0) const;
+
+private:
+  std::vector<std::string> names_;
+  std::vector<WrenchTransform> transforms_;
+};
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "ati_sensor/calibration_cache.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sstream>
+
+using namespace ati;
+
+bool ati::operator==(const CalibrationData& a, const CalibrationData& b)
+{
+  if (a.cpf != b.cpf || a.cpt != b.cpt || a.rdt_rate != b.rdt_rate)
+    return false;
+  for (int i = 0; i < 6; ++i)
+    if (a.gauge_bias[i] != b.gauge_bias[i])
+      return false;
+  return true;
+}
+
+// mkdir -p
+static bool makeDirectories(const std::string& directory)
+{
+  for (size_t pos = 1; pos <= directory.size(); ++pos)
+  {
+    if (pos < directory.size() && directory[pos] != '/')
+      continue;
+    const std::string parent = directory.substr(0, pos);
+    if (mkdir(parent.c_str(), 0755) < 0 && errno != EEXIST)
+      return false;
+  }
+  return true;
+}
+
+CalibrationCache::CalibrationCache(const std::string& directory)
+: directory_(directory.empty() ? defaultDirectory() : directory)
+{
+}
+
+std::string CalibrationCache::defaultDirectory()
+{
+  const char* dir = getenv("ATI_SENSOR_CACHE_DIR");
+  if (dir && *dir)
+    return dir;
+  dir = getenv("XDG_CACHE_HOME");
+  if (dir && *dir)
+    return std::string(dir) + "/ati_sensor";
+  dir = getenv("HOME");
+  if (dir && *dir)
+    return std::string(dir) + "/.cache/ati_sensor";
+  return "/tmp/ati_sensor";
+}
+
+std::string CalibrationCache::path(const std::string& host, int calibration_index) const
+{
+  // host may be ip:port
+  std::string name = host;
+  for (size_t i = 0; i < name.size(); ++i)
+    if (name[i] == ':' || name[i] == '/')
+      name[i] = '_';
+  std::stringstream ss;
+  ss << directory_ << "/" << name;
+  if (calibration_index < 0)
+    ss << "_current.cal";
+  else
+    ss << "_cal" << calibration_index << ".cal";
+  return ss.str();
+}
+
+bool CalibrationCache::load(const std::string& host, int calibration_index, CalibrationData& data) const
+{
+  std::ifstream file(path(host, calibration_index).c_str());
+  if (!file)
+    return false;
+
+  // One "key value" per line, the gauge biases separated by semi-colons
+  CalibrationData read;
+  unsigned int found = 0;
+  std::string line;
+  while (std::getline(file, line))
+  {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::stringstream ss(line);
+    std::string key;
+    ss >> key;
+    if (key == "cpf" && (ss >> read.cpf))
+      found |= 1;
+    else if (key == "cpt" && (ss >> read.cpt))
+      found |= 2;
+    else if (key == "rdt_rate" && (ss >> read.rdt_rate))
+      found |= 4;
+    else if (key == "gauge_bias")
+    {
+      int i = 0;
+      char delim = ';';
+      while (i < 6 && delim == ';' && (ss >> read.gauge_bias[i]))
+      {
+        ++i;
+        if (!(ss >> delim))
+          break;
+      }
+      if (i == 6)
+        found |= 8;
+    }
+  }
+  if (found != 15 || read.cpf == 0 || read.cpt == 0)
+    return false;
+  data = read;
+  return true;
+}
+
+bool CalibrationCache::store(const std::string& host, int calibration_index, const CalibrationData& data) const
+{
+  if (!makeDirectories(directory_))
+    return false;
+  const std::string final_path = path(host, calibration_index);
+  // Readers see the old file or the new one, never a partial one
+  std::stringstream tmp;
+  tmp << final_path << "." << getpid() << ".tmp";
+  {
+    std::ofstream file(tmp.str().c_str());
+    if (!file)
+      return false;
+    file << "# ati_sensor settings of http://" << host << "\n"
+         << "cpf " << data.cpf << "\n"
+         << "cpt " << data.cpt << "\n"
+         << "rdt_rate " << data.rdt_rate << "\n"
+         << "gauge_bias ";
+    for (int i = 0; i < 6; ++i)
+      file << data.gauge_bias[i] << (i < 5 ? ";" : "\n");
+    file.flush();
+    if (!file)
+    {
+      unlink(tmp.str().c_str());
+      return false;
+    }
+  }
+  if (rename(tmp.str().c_str(), final_path.c_str()) < 0)
+  {
+    unlink(tmp.str().c_str());
+    return false;
+  }
+  return true;
+}
+
+bool CalibrationCache::remove(const std::string& host, int calibration_index) const
+{
+  return unlink(path(host, calibration_index).c_str()) == 0 || errno == ENOENT;
+}
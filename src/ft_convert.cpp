@@ -0,0 +1,142 @@
+#include "ati_sensor/ft_convert.h"
+#include "ati_sensor/ft_sensor.h"
+#include <arpa/inet.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define ATI_SENSOR_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace ati;
+
+// Sequence numbers and status are not worth vectorizing
+static inline void convertHeader(const unsigned char* record, uint64_t timestamp, Sample& sample)
+{
+  sample.timestamp = timestamp;
+  sample.rdt_sequence = ntohl(*reinterpret_cast<const uint32_t*>(&record[0]));
+  sample.ft_sequence = ntohl(*reinterpret_cast<const uint32_t*>(&record[4]));
+  sample.status = ntohl(*reinterpret_cast<const uint32_t*>(&record[8]));
+}
+
+void ati::convertRecordsScalar(const unsigned char* records, size_t n, uint64_t timestamp,
+                               double force_scale, double torque_scale, Sample* samples)
+{
+  for (size_t r = 0; r < n; ++r)
+  {
+    const unsigned char* record = records + r * RDT_RECORD_SIZE;
+    convertHeader(record, timestamp, samples[r]);
+    const uint32_t* counts = reinterpret_cast<const uint32_t*>(&record[12]);
+    for (int i = 0; i < 3; ++i)
+      samples[r].ft[i] = static_cast<int32_t>(ntohl(counts[i])) * force_scale;
+    for (int i = 3; i < 6; ++i)
+      samples[r].ft[i] = static_cast<int32_t>(ntohl(counts[i])) * torque_scale;
+  }
+}
+
+#ifdef ATI_SENSOR_X86_SIMD
+
+// SSE2 has no byte shuffle, swap with shifts and masks
+__attribute__((target("sse2")))
+static inline __m128i byteSwapSSE2(__m128i v)
+{
+  const __m128i mask = _mm_set1_epi32(0x00ff00ff);
+  // swap bytes in each 16 bits word, then the two words
+  v = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(v, 8), mask), _mm_andnot_si128(mask, _mm_slli_epi16(v, 8)));
+  v = _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+  return v;
+}
+
+__attribute__((target("sse2")))
+void ati::convertRecordsSSE2(const unsigned char* records, size_t n, uint64_t timestamp,
+                             double force_scale, double torque_scale, Sample* samples)
+{
+  const __m128d fs = _mm_set1_pd(force_scale);
+  const __m128d ft = _mm_set_pd(torque_scale, force_scale);
+  const __m128d ts = _mm_set1_pd(torque_scale);
+  for (size_t r = 0; r < n; ++r)
+  {
+    const unsigned char* record = records + r * RDT_RECORD_SIZE;
+    convertHeader(record, timestamp, samples[r]);
+    // counts 0-3 and 2-5, the second load ends exactly at the end of the record
+    const __m128i a = byteSwapSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(record + 12)));
+    const __m128i b = byteSwapSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(record + 20)));
+    double* out = samples[r].ft;
+    _mm_storeu_pd(out + 0, _mm_mul_pd(_mm_cvtepi32_pd(a), fs));
+    _mm_storeu_pd(out + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(a, a)), ft));
+    _mm_storeu_pd(out + 4, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(b, b)), ts));
+  }
+}
+
+__attribute__((target("avx2")))
+void ati::convertRecordsAVX2(const unsigned char* records, size_t n, uint64_t timestamp,
+                             double force_scale, double torque_scale, Sample* samples)
+{
+  const __m128i swap = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+  const __m256d scale_lo = _mm256_set_pd(torque_scale, force_scale, force_scale, force_scale);
+  const __m128d scale_hi = _mm_set1_pd(torque_scale);
+  for (size_t r = 0; r < n; ++r)
+  {
+    const unsigned char* record = records + r * RDT_RECORD_SIZE;
+    convertHeader(record, timestamp, samples[r]);
+    const __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(record + 12)), swap);
+    const __m128i b = _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(record + 28)), swap);
+    double* out = samples[r].ft;
+    _mm256_storeu_pd(out + 0, _mm256_mul_pd(_mm256_cvtepi32_pd(a), scale_lo));
+    _mm_storeu_pd(out + 4, _mm_mul_pd(_mm_cvtepi32_pd(b), scale_hi));
+  }
+}
+
+#else
+
+void ati::convertRecordsSSE2(const unsigned char* records, size_t n, uint64_t timestamp,
+                             double force_scale, double torque_scale, Sample* samples)
+{
+  convertRecordsScalar(records, n, timestamp, force_scale, torque_scale, samples);
+}
+
+void ati::convertRecordsAVX2(const unsigned char* records, size_t n, uint64_t timestamp,
+                             double force_scale, double torque_scale, Sample* samples)
+{
+  convertRecordsScalar(records, n, timestamp, force_scale, torque_scale, samples);
+}
+
+#endif
+
+typedef void (*convert_fn)(const unsigned char*, size_t, uint64_t, double, double, Sample*);
+
+struct ConvertDispatch
+{
+  convert_fn fn;
+  const char* name;
+  ConvertDispatch() : fn(&convertRecordsScalar), name("scalar")
+  {
+#ifdef ATI_SENSOR_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+      fn = &convertRecordsAVX2;
+      name = "avx2";
+    }
+    else if (__builtin_cpu_supports("sse2")) {
+      fn = &convertRecordsSSE2;
+      name = "sse2";
+    }
+#endif
+  }
+};
+
+static const ConvertDispatch& dispatch()
+{
+  static const ConvertDispatch d;
+  return d;
+}
+
+void ati::convertRecords(const unsigned char* records, size_t n, uint64_t timestamp,
+                         double force_scale, double torque_scale, Sample* samples)
+{
+  dispatch().fn(records, n, timestamp, force_scale, torque_scale, samples);
+}
+
+const char* ati::convertRecordsImplementation()
+{
+  return dispatch().name;
+}
@@ -0,0 +1,118 @@
+#include "ati_sensor/ft_decimator.h"
+#include "ati_sensor/ft_sensor.h"
+#include <math.h>
+#include <string.h>
+#include <complex>
+#include <algorithm>
+
+#define FT_DECIMATOR_MAX_FACTOR 1000
+#define FT_DECIMATOR_MAX_TAPS_PER_PHASE 64
+// Width of the transition band of the Blackman window, in cycles per input
+// sample times the number of taps
+#define FT_DECIMATOR_TRANSITION_WIDTH 5.5
+
+using namespace ati;
+
+FTDecimator::FTDecimator()
+: position_(0)
+, factor_(1)
+, phase_(0)
+, primed_(false)
+{
+}
+
+bool FTDecimator::setFactor(unsigned int factor, unsigned int taps_per_phase)
+{
+  if (factor < 1 || factor > FT_DECIMATOR_MAX_FACTOR || taps_per_phase < 1
+      || taps_per_phase > FT_DECIMATOR_MAX_TAPS_PER_PHASE)
+    return false;
+  factor_ = factor;
+  coefficients_.clear();
+  history_.clear();
+  reset();
+  if (factor == 1)
+    return true;
+
+  // The transition band ends at the output Nyquist frequency (in cycles per
+  // input sample), so nothing folds back over it; with few taps the cutoff
+  // stays above half of it, at the cost of some attenuation in the band
+  const size_t taps = taps_per_phase * factor + 1;
+  const double nyquist = 1 / (2.0 * factor);
+  const double cutoff = std::max(nyquist - FT_DECIMATOR_TRANSITION_WIDTH / (2.0 * (taps - 1)), nyquist / 2);
+  coefficients_.resize(taps);
+  double sum = 0;
+  for (size_t i = 0; i < taps; ++i)
+  {
+    const double m = i - (taps - 1) / 2.0;
+    const double sinc = (m == 0) ? 2 * cutoff : sin(2 * M_PI * cutoff * m) / (M_PI * m);
+    const double window = 0.42 - 0.5 * cos(2 * M_PI * i / (taps - 1)) + 0.08 * cos(4 * M_PI * i / (taps - 1));
+    coefficients_[i] = sinc * window;
+    sum += coefficients_[i];
+  }
+  // Unity gain for a constant
+  for (size_t i = 0; i < taps; ++i)
+    coefficients_[i] /= sum;
+  history_.resize(2 * taps * 6);
+  return true;
+}
+
+void FTDecimator::reset()
+{
+  position_ = 0;
+  phase_ = 0;
+  primed_ = false;
+}
+
+size_t FTDecimator::process(const Sample* in, size_t n, Sample* out)
+{
+  if (factor_ == 1)
+  {
+    if (out != in)
+      memmove(out, in, n * sizeof(Sample));
+    return n;
+  }
+
+  const size_t taps = coefficients_.size();
+  size_t count = 0;
+  for (size_t i = 0; i < n; ++i)
+  {
+    if (!primed_)
+    {
+      for (size_t t = 0; t < 2 * taps; ++t)
+        memcpy(&history_[t * 6], in[i].ft, sizeof(in[i].ft));
+      primed_ = true;
+    }
+    memcpy(&history_[position_ * 6], in[i].ft, sizeof(in[i].ft));
+    memcpy(&history_[(position_ + taps) * 6], in[i].ft, sizeof(in[i].ft));
+    position_ = (position_ + 1 == taps) ? 0 : position_ + 1;
+
+    if (++phase_ < factor_)
+      continue;
+    phase_ = 0;
+
+    // The last taps samples, oldest first, start at position_
+    const double* window = &history_[position_ * 6];
+    double acc[6] = {0, 0, 0, 0, 0, 0};
+    for (size_t t = 0; t < taps; ++t)
+    {
+      const double c = coefficients_[t];
+      for (int j = 0; j < 6; ++j)
+        acc[j] += c * window[t * 6 + j];
+    }
+    Sample& s = out[count++];
+    s = in[i];
+    for (int j = 0; j < 6; ++j)
+      s.ft[j] = acc[j];
+  }
+  return count;
+}
+
+double FTDecimator::magnitude(double frequency) const
+{
+  if (coefficients_.empty())
+    return 1;
+  std::complex<double> h(0, 0);
+  for (size_t t = 0; t < coefficients_.size(); ++t)
+    h += coefficients_[t] * std::polar(1.0, -2 * M_PI * frequency * t);
+  return std::abs(h);
+}
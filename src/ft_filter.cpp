@@ -0,0 +1,187 @@
+#include "ati_sensor/ft_filter.h"
+#include "ati_sensor/ft_sensor.h"
+#include <math.h>
+#include <string.h>
+#include <complex>
+
+#define FT_FILTER_MAX_ORDER 8
+
+using namespace ati;
+
+FTFilter::FTFilter()
+: rate_(0)
+, designed_(false)
+, primed_(false)
+{
+}
+
+bool FTFilter::addStage(stage_t type, double frequency, double param, size_t sections)
+{
+  if (!(frequency > 0))
+    return false;
+  Stage stage = {type, frequency, param};
+  stages_.push_back(stage);
+  sections_.resize(sections_.size() + sections);
+  // Redesign everything for the rate already set, if any
+  if (rate_ > 0)
+    return setSampleRate(rate_);
+  return true;
+}
+
+bool FTFilter::addLowPass(double cutoff, unsigned int order)
+{
+  if (order < 1 || order > FT_FILTER_MAX_ORDER)
+    return false;
+  return addStage(LOW_PASS, cutoff, order, (order + 1) / 2);
+}
+
+bool FTFilter::addHighPass(double cutoff, unsigned int order)
+{
+  if (order < 1 || order > FT_FILTER_MAX_ORDER)
+    return false;
+  return addStage(HIGH_PASS, cutoff, order, (order + 1) / 2);
+}
+
+bool FTFilter::addNotch(double frequency, double q)
+{
+  if (!(q > 0))
+    return false;
+  return addStage(NOTCH, frequency, q, 1);
+}
+
+void FTFilter::clear()
+{
+  stages_.clear();
+  sections_.clear();
+  designed_ = false;
+  primed_ = false;
+}
+
+bool FTFilter::setSampleRate(double rate)
+{
+  rate_ = rate;
+  primed_ = false;
+  designed_ = rate > 0 && !sections_.empty();
+  if (!designed_)
+    return rate > 0;
+
+  bool ok = true;
+  size_t s = 0;
+  for (size_t i = 0; i < stages_.size(); ++i)
+  {
+    const Stage& stage = stages_[i];
+    const unsigned int order = stage.type == NOTCH ? 2 : static_cast<unsigned int>(stage.param);
+    const size_t count = (order + 1) / 2;
+    const bool valid = stage.frequency < rate / 2;
+    ok &= valid;
+    const double w0 = 2 * M_PI * stage.frequency / rate;
+    const double cosw = cos(w0);
+    for (size_t k = 0; k < count; ++k, ++s)
+    {
+      Section& section = sections_[s];
+      double b0 = 1, b1 = 0, b2 = 0, a0 = 1, a1 = 0, a2 = 0;
+      if (valid && stage.type == NOTCH)
+      {
+        const double alpha = sin(w0) / (2 * stage.param);
+        b0 = 1; b1 = -2 * cosw; b2 = 1;
+        a0 = 1 + alpha; a1 = -2 * cosw; a2 = 1 - alpha;
+      }
+      else if (valid && 2 * k + 1 == order)
+      {
+        // First order section of an odd order
+        const double t = tan(w0 / 2);
+        a0 = 1 + t; a1 = t - 1;
+        if (stage.type == LOW_PASS) {
+          b0 = t; b1 = t;
+        } else {
+          b0 = 1; b1 = -1;
+        }
+      }
+      else if (valid)
+      {
+        // Pole pair k of the Butterworth polynomial
+        const double q = 1 / (2 * sin((2 * k + 1) * M_PI / (2 * order)));
+        const double alpha = sin(w0) / (2 * q);
+        if (stage.type == LOW_PASS) {
+          b0 = (1 - cosw) / 2; b1 = 1 - cosw; b2 = b0;
+        } else {
+          b0 = (1 + cosw) / 2; b1 = -(1 + cosw); b2 = b0;
+        }
+        a0 = 1 + alpha; a1 = -2 * cosw; a2 = 1 - alpha;
+      }
+      section.b0 = b0 / a0;
+      section.b1 = b1 / a0;
+      section.b2 = b2 / a0;
+      section.a1 = a1 / a0;
+      section.a2 = a2 / a0;
+    }
+  }
+  return ok;
+}
+
+void FTFilter::prime(const double x[6])
+{
+  // Each section at its DC output for a constant input
+  double in[6];
+  memcpy(in, x, sizeof(in));
+  for (size_t s = 0; s < sections_.size(); ++s)
+  {
+    Section& section = sections_[s];
+    const double gain = (section.b0 + section.b1 + section.b2) / (1 + section.a1 + section.a2);
+    for (int j = 0; j < 6; ++j)
+    {
+      const double y = gain * in[j];
+      section.z1[j] = y - section.b0 * in[j];
+      section.z2[j] = section.b2 * in[j] - section.a2 * y;
+      in[j] = y;
+    }
+  }
+  primed_ = true;
+}
+
+void FTFilter::process(double ft[6])
+{
+  if (!designed_)
+    return;
+  if (!primed_)
+    prime(ft);
+  // The six axes are independent, the inner loops vectorize
+  for (size_t s = 0; s < sections_.size(); ++s)
+  {
+    Section& section = sections_[s];
+    const double b0 = section.b0, b1 = section.b1, b2 = section.b2;
+    const double a1 = section.a1, a2 = section.a2;
+    double y[6];
+    for (int j = 0; j < 6; ++j)
+      y[j] = b0 * ft[j] + section.z1[j];
+    for (int j = 0; j < 6; ++j)
+      section.z1[j] = b1 * ft[j] - a1 * y[j] + section.z2[j];
+    for (int j = 0; j < 6; ++j)
+      section.z2[j] = b2 * ft[j] - a2 * y[j];
+    for (int j = 0; j < 6; ++j)
+      ft[j] = y[j];
+  }
+}
+
+void FTFilter::process(Sample* samples, size_t n)
+{
+  if (!designed_)
+    return;
+  for (size_t i = 0; i < n; ++i)
+    process(samples[i].ft);
+}
+
+double FTFilter::magnitude(double frequency) const
+{
+  if (!designed_)
+    return 1;
+  const std::complex<double> z1 = std::polar(1.0, -2 * M_PI * frequency / rate_);
+  const std::complex<double> z2 = z1 * z1;
+  std::complex<double> h(1, 0);
+  for (size_t s = 0; s < sections_.size(); ++s)
+  {
+    const Section& section = sections_[s];
+    h *= (section.b0 + section.b1 * z1 + section.b2 * z2) / (1.0 + section.a1 * z1 + section.a2 * z2);
+  }
+  return std::abs(h);
+}
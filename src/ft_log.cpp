@@ -0,0 +1,493 @@
+#include "ati_sensor/ft_log.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Flags byte of every encoded record
+#define LOG_RDT_JUMP      0x01    // rdt_sequence is not previous + 1
+#define LOG_FT_STEP       0x02    // ft_sequence step changed
+#define LOG_TIME_STEP     0x04    // timestamp step changed
+#define LOG_STATUS        0x08    // status changed
+#define LOG_SCALE         0x10    // cpf/cpt changed
+
+// Worst case encoded record : flags, 5 varints of 32 bits, 1 of 64 bits,
+// 2 for the scales, 6 counts
+#define LOG_MAX_RECORD_SIZE (1 + 5 * 5 + 10 + 6 * 5)
+
+using namespace ati;
+
+static inline uint32_t zigzag32(int32_t v) {return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);}
+static inline int32_t unzigzag32(uint32_t v) {return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);}
+static inline uint64_t zigzag64(int64_t v) {return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);}
+static inline int64_t unzigzag64(uint64_t v) {return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);}
+
+static inline unsigned char* putVarint(unsigned char* p, uint64_t v)
+{
+  while(v >= 0x80)
+  {
+    *p++ = static_cast<unsigned char>(v) | 0x80;
+    v >>= 7;
+  }
+  *p++ = static_cast<unsigned char>(v);
+  return p;
+}
+
+// Returns NULL past end or on an overlong encoding
+static inline const unsigned char* getVarint(const unsigned char* p, const unsigned char* end, uint64_t& v)
+{
+  v = 0;
+  for(int shift = 0; shift < 64 && p < end; shift += 7)
+  {
+    const unsigned char b = *p++;
+    v |= static_cast<uint64_t>(b & 0x7f) << shift;
+    if(!(b & 0x80))
+      return p;
+  }
+  return NULL;
+}
+
+// What the next record is predicted from
+struct LogState {
+  uint64_t timestamp;
+  int64_t time_step;
+  uint32_t rdt_sequence;
+  uint32_t ft_sequence;
+  uint32_t ft_step;
+  uint32_t status;
+  uint32_t cpf;
+  uint32_t cpt;
+  int32_t counts[6];
+
+  explicit LogState(uint64_t first_timestamp)
+  {
+    memset(this, 0, sizeof(*this));
+    timestamp = first_timestamp;
+  }
+};
+
+struct FTLogWriter::ChunkEncoder {
+  uint16_t sensor;
+  uint32_t count;
+  uint64_t first_timestamp;
+  LogState state;
+  std::vector<unsigned char> payload;
+  size_t size;
+
+  ChunkEncoder(uint16_t s, uint32_t chunk_records)
+  : sensor(s), count(0), first_timestamp(0), state(0)
+  , payload(sizeof(LogChunkHeader) + static_cast<size_t>(chunk_records) * LOG_MAX_RECORD_SIZE)
+  , size(sizeof(LogChunkHeader))
+  {
+  }
+
+  void encode(const RecordEntry& e)
+  {
+    if(count == 0)
+    {
+      first_timestamp = e.timestamp;
+      state = LogState(e.timestamp);
+    }
+    unsigned char* const start = &payload[size];
+    unsigned char* p = start + 1;
+    unsigned char flags = 0;
+
+    const uint32_t rdt_jump = e.rdt_sequence - state.rdt_sequence - 1;
+    if(rdt_jump != 0)
+    {
+      flags |= LOG_RDT_JUMP;
+      p = putVarint(p, zigzag32(static_cast<int32_t>(rdt_jump)));
+    }
+    const uint32_t ft_step = e.ft_sequence - state.ft_sequence;
+    if(ft_step != state.ft_step)
+    {
+      flags |= LOG_FT_STEP;
+      p = putVarint(p, zigzag32(static_cast<int32_t>(ft_step - state.ft_step)));
+    }
+    const int64_t time_step = static_cast<int64_t>(e.timestamp - state.timestamp);
+    if(time_step != state.time_step)
+    {
+      flags |= LOG_TIME_STEP;
+      p = putVarint(p, zigzag64(time_step - state.time_step));
+    }
+    if(e.status != state.status)
+    {
+      flags |= LOG_STATUS;
+      p = putVarint(p, e.status);
+    }
+    if(e.cpf != state.cpf || e.cpt != state.cpt)
+    {
+      flags |= LOG_SCALE;
+      p = putVarint(p, e.cpf);
+      p = putVarint(p, e.cpt);
+    }
+    for(int j = 0; j < 6; ++j)
+    {
+      p = putVarint(p, zigzag32(static_cast<int32_t>(static_cast<uint32_t>(e.counts[j]) - static_cast<uint32_t>(state.counts[j]))));
+      state.counts[j] = e.counts[j];
+    }
+    *start = flags;
+    size += p - start;
+
+    state.timestamp = e.timestamp;
+    state.time_step = time_step;
+    state.rdt_sequence = e.rdt_sequence;
+    state.ft_sequence = e.ft_sequence;
+    state.ft_step = ft_step;
+    state.status = e.status;
+    state.cpf = e.cpf;
+    state.cpt = e.cpt;
+    ++count;
+  }
+};
+
+FTLogWriter::FTLogWriter()
+: fd_(-1)
+, offset_(0)
+, records_(0)
+, chunk_records_(0)
+{
+  memset(&header_, 0, sizeof(header_));
+  memset(chunks_, 0, sizeof(chunks_));
+}
+
+FTLogWriter::~FTLogWriter()
+{
+  close();
+}
+
+bool FTLogWriter::open(const std::string& path, uint32_t chunk_records)
+{
+  if(isOpen())
+    close();
+  fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if(fd_ < 0)
+  {
+    std::cerr << "[ft_log] Could not open " << path << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  chunk_records_ = chunk_records > 0 ? chunk_records : 1;
+  memset(&header_, 0, sizeof(header_));
+  memcpy(header_.magic, LOG_MAGIC, sizeof(header_.magic));
+  header_.version = LOG_VERSION;
+  header_.byte_order = 0x01020304;
+  header_.header_size = sizeof(LogFileHeader);
+  header_.chunk_records = chunk_records_;
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  header_.start_time = static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+  index_.clear();
+  records_ = 0;
+  // The header is rewritten with the sensor table by setSensor() and close()
+  offset_ = 0;
+  if(write(fd_, &header_, sizeof(header_)) != static_cast<ssize_t>(sizeof(header_)))
+  {
+    std::cerr << "[ft_log] Could not write " << path << ": " << strerror(errno) << std::endl;
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  offset_ = sizeof(header_);
+  return true;
+}
+
+bool FTLogWriter::setSensor(uint16_t sensor, const RecordSensorInfo& info)
+{
+  if(!isOpen() || sensor >= RECORD_MAX_SENSORS)
+    return false;
+  header_.sensors[sensor] = info;
+  if(header_.sensor_count <= sensor)
+    header_.sensor_count = sensor + 1;
+  // Rewritten now, so that a log that is never closed still describes its sensors
+  if(pwrite(fd_, &header_, sizeof(header_), 0) != static_cast<ssize_t>(sizeof(header_)))
+  {
+    std::cerr << "[ft_log] Could not write the sensor table: " << strerror(errno) << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool FTLogWriter::append(const RecordEntry& entry)
+{
+  if(!isOpen() || entry.sensor >= RECORD_MAX_SENSORS)
+    return false;
+  ChunkEncoder*& chunk = chunks_[entry.sensor];
+  if(!chunk)
+    chunk = new ChunkEncoder(entry.sensor, chunk_records_);
+  chunk->encode(entry);
+  ++records_;
+  return chunk->count < chunk_records_ || flush(*chunk);
+}
+
+bool FTLogWriter::flush(ChunkEncoder& chunk)
+{
+  if(chunk.count == 0)
+    return true;
+  LogChunkHeader* h = reinterpret_cast<LogChunkHeader*>(&chunk.payload[0]);
+  h->magic = LOG_CHUNK_MAGIC;
+  h->sensor = chunk.sensor;
+  h->reserved = 0;
+  h->record_count = chunk.count;
+  h->payload_size = static_cast<uint32_t>(chunk.size - sizeof(LogChunkHeader));
+  h->first_timestamp = chunk.first_timestamp;
+  h->last_timestamp = chunk.state.timestamp;
+
+  LogIndexEntry entry;
+  entry.offset = offset_;
+  entry.first_timestamp = h->first_timestamp;
+  entry.last_timestamp = h->last_timestamp;
+  entry.record_count = h->record_count;
+  entry.sensor = h->sensor;
+  entry.reserved = 0;
+
+  const size_t size = chunk.size;
+  const ssize_t ret = write(fd_, &chunk.payload[0], size);
+  chunk.count = 0;
+  chunk.size = sizeof(LogChunkHeader);
+  if(ret != static_cast<ssize_t>(size))
+  {
+    std::cerr << "[ft_log] Could not write a chunk: " << strerror(errno) << std::endl;
+    return false;
+  }
+  offset_ += ret;
+  index_.push_back(entry);
+  return true;
+}
+
+bool FTLogWriter::close()
+{
+  if(!isOpen())
+    return true;
+  bool ok = true;
+  for(int i = 0; i < RECORD_MAX_SENSORS; ++i)
+  {
+    if(chunks_[i])
+      ok &= flush(*chunks_[i]);
+    delete chunks_[i];
+    chunks_[i] = NULL;
+  }
+  LogTrailer trailer;
+  trailer.index_offset = offset_;
+  trailer.chunk_count = index_.size();
+  memcpy(trailer.magic, LOG_INDEX_MAGIC, sizeof(trailer.magic));
+  const size_t index_size = index_.size() * sizeof(LogIndexEntry);
+  if(index_size > 0)
+    ok &= write(fd_, &index_[0], index_size) == static_cast<ssize_t>(index_size);
+  ok &= write(fd_, &trailer, sizeof(trailer)) == static_cast<ssize_t>(sizeof(trailer));
+  ok &= pwrite(fd_, &header_, sizeof(header_), 0) == static_cast<ssize_t>(sizeof(header_));
+  if(!ok)
+    std::cerr << "[ft_log] Error while closing the log: " << strerror(errno) << std::endl;
+  ::close(fd_);
+  fd_ = -1;
+  return ok;
+}
+
+FTLogReader::FTLogReader()
+: map_(NULL)
+, map_size_(0)
+, records_(0)
+{
+}
+
+FTLogReader::~FTLogReader()
+{
+  close();
+}
+
+bool FTLogReader::open(const std::string& path)
+{
+  close();
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+  {
+    std::cerr << "[ft_log] Could not open " << path << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(LogFileHeader))
+  {
+    std::cerr << "[ft_log] " << path << " is not a log" << std::endl;
+    ::close(fd);
+    return false;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(map == MAP_FAILED)
+  {
+    std::cerr << "[ft_log] Could not map " << path << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  map_ = static_cast<unsigned char*>(map);
+  map_size_ = st.st_size;
+
+  const LogFileHeader& h = header();
+  if(memcmp(h.magic, LOG_MAGIC, sizeof(h.magic)) != 0 || h.version != LOG_VERSION
+     || h.byte_order != 0x01020304 || h.header_size > map_size_)
+  {
+    std::cerr << "[ft_log] " << path << " is not a version " << LOG_VERSION << " log of this byte order" << std::endl;
+    close();
+    return false;
+  }
+  if(h.sensor_count > RECORD_MAX_SENSORS)
+  {
+    std::cerr << "[ft_log] " << path << " has a corrupt sensor table" << std::endl;
+    close();
+    return false;
+  }
+
+  // Index written by close(), checked without overflowing on a corrupt trailer
+  const LogTrailer* trailer = reinterpret_cast<const LogTrailer*>(map_ + map_size_ - sizeof(LogTrailer));
+  const uint64_t index_end = map_size_ - sizeof(LogTrailer);
+  if(map_size_ >= h.header_size + sizeof(LogTrailer)
+     && memcmp(trailer->magic, LOG_INDEX_MAGIC, sizeof(trailer->magic)) == 0
+     && trailer->index_offset >= h.header_size && trailer->index_offset <= index_end
+     && trailer->chunk_count == (index_end - trailer->index_offset) / sizeof(LogIndexEntry)
+     && (index_end - trailer->index_offset) % sizeof(LogIndexEntry) == 0)
+  {
+    const LogIndexEntry* index = reinterpret_cast<const LogIndexEntry*>(map_ + trailer->index_offset);
+    index_.assign(index, index + trailer->chunk_count);
+    for(size_t i = 0; i < index_.size(); ++i)
+    {
+      if(!validChunk(index_[i].offset, trailer->index_offset)
+         || reinterpret_cast<const LogChunkHeader*>(map_ + index_[i].offset)->record_count != index_[i].record_count)
+      {
+        std::cerr << "[ft_log] " << path << " has a corrupt index, scanning chunks" << std::endl;
+        scanChunks();
+        break;
+      }
+    }
+  }
+  else
+  {
+    std::cerr << "[ft_log] " << path << " has no index, scanning chunks" << std::endl;
+    scanChunks();
+  }
+  records_ = 0;
+  for(size_t i = 0; i < index_.size(); ++i)
+    records_ += index_[i].record_count;
+  madvise(map_, map_size_, MADV_SEQUENTIAL);
+  return true;
+}
+
+bool FTLogReader::validChunk(uint64_t offset, uint64_t end) const
+{
+  if(end > map_size_ || offset < header().header_size || offset > end
+     || end - offset < sizeof(LogChunkHeader))
+    return false;
+  const LogChunkHeader* h = reinterpret_cast<const LogChunkHeader*>(map_ + offset);
+  // Every record takes at least its flags byte
+  return h->magic == LOG_CHUNK_MAGIC && h->payload_size <= end - offset - sizeof(LogChunkHeader)
+      && h->record_count <= h->payload_size;
+}
+
+bool FTLogReader::scanChunks()
+{
+  index_.clear();
+  uint64_t offset = header().header_size;
+  while(validChunk(offset, map_size_))
+  {
+    const LogChunkHeader* h = reinterpret_cast<const LogChunkHeader*>(map_ + offset);
+    LogIndexEntry entry;
+    entry.offset = offset;
+    entry.first_timestamp = h->first_timestamp;
+    entry.last_timestamp = h->last_timestamp;
+    entry.record_count = h->record_count;
+    entry.sensor = h->sensor;
+    entry.reserved = 0;
+    index_.push_back(entry);
+    offset += sizeof(LogChunkHeader) + h->payload_size;
+  }
+  return !index_.empty();
+}
+
+void FTLogReader::close()
+{
+  if(map_)
+    munmap(map_, map_size_);
+  map_ = NULL;
+  map_size_ = 0;
+  records_ = 0;
+  index_.clear();
+}
+
+bool FTLogReader::decodeChunk(size_t i, RecordEntry* out) const
+{
+  // out is sized from the index, the chunk must agree with it
+  if(i >= index_.size() || !validChunk(index_[i].offset, map_size_))
+    return false;
+  const LogChunkHeader* h = reinterpret_cast<const LogChunkHeader*>(map_ + index_[i].offset);
+  if(h->record_count != index_[i].record_count)
+    return false;
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(h + 1);
+  const unsigned char* const end = p + h->payload_size;
+
+  LogState state(h->first_timestamp);
+  uint64_t v;
+  for(uint32_t r = 0; r < h->record_count; ++r)
+  {
+    if(p >= end)
+      return false;
+    const unsigned char flags = *p++;
+    uint32_t rdt_jump = 0;
+    if(flags & LOG_RDT_JUMP)
+    {
+      if(!(p = getVarint(p, end, v))) return false;
+      rdt_jump = static_cast<uint32_t>(unzigzag32(static_cast<uint32_t>(v)));
+    }
+    if(flags & LOG_FT_STEP)
+    {
+      if(!(p = getVarint(p, end, v))) return false;
+      state.ft_step += static_cast<uint32_t>(unzigzag32(static_cast<uint32_t>(v)));
+    }
+    if(flags & LOG_TIME_STEP)
+    {
+      if(!(p = getVarint(p, end, v))) return false;
+      state.time_step += unzigzag64(v);
+    }
+    if(flags & LOG_STATUS)
+    {
+      if(!(p = getVarint(p, end, v))) return false;
+      state.status = static_cast<uint32_t>(v);
+    }
+    if(flags & LOG_SCALE)
+    {
+      if(!(p = getVarint(p, end, v))) return false;
+      state.cpf = static_cast<uint32_t>(v);
+      if(!(p = getVarint(p, end, v))) return false;
+      state.cpt = static_cast<uint32_t>(v);
+    }
+    RecordEntry& e = out[r];
+    for(int j = 0; j < 6; ++j)
+    {
+      if(!(p = getVarint(p, end, v))) return false;
+      state.counts[j] = static_cast<int32_t>(static_cast<uint32_t>(state.counts[j]) + static_cast<uint32_t>(unzigzag32(static_cast<uint32_t>(v))));
+      e.counts[j] = state.counts[j];
+    }
+    state.rdt_sequence += 1 + rdt_jump;
+    state.ft_sequence += state.ft_step;
+    state.timestamp += state.time_step;
+
+    e.timestamp = state.timestamp;
+    e.rdt_sequence = state.rdt_sequence;
+    e.ft_sequence = state.ft_sequence;
+    e.status = state.status;
+    e.cpf = state.cpf;
+    e.cpt = state.cpt;
+    e.sensor = h->sensor;
+    e.reserved = 0;
+  }
+  return true;
+}
+
+size_t FTLogReader::findChunk(uint16_t sensor, uint64_t timestamp) const
+{
+  // Chunks of a sensor are in time order, those of other sensors interleave
+  for(size_t i = 0; i < index_.size(); ++i)
+    if(index_[i].sensor == sensor && index_[i].last_timestamp >= timestamp)
+      return i;
+  return index_.size();
+}
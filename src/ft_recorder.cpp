@@ -0,0 +1,375 @@
+#include "ati_sensor/ft_recorder.h"
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/ft_log.h"
+#include "ati_sensor/sensor_group.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <cstddef>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+
+// How long the writer sleeps when every ring is empty (microseconds)
+#define RECORDER_IDLE_US 1000
+
+using namespace ati;
+
+static_assert(sizeof(RecordEntry) == 56, "RecordEntry is part of the file format");
+static_assert(sizeof(RecordFileHeader) <= RECORD_HEADER_SIZE, "RecordFileHeader does not fit");
+// Allocated with new, see CACHE_LINE_SIZE
+static_assert(alignof(RecorderChannel) <= alignof(std::max_align_t), "RecorderChannel must not be over-aligned");
+
+static uint64_t timestampNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+RecorderChannel::RecorderChannel(FTRecorder* recorder, uint16_t sensor, size_t ring_size)
+: recorder_(recorder)
+, sensor_(sensor)
+, ring_(ring_size)
+, dropped_(0)
+{
+  memset(&info_, 0, sizeof(info_));
+}
+
+void RecorderChannel::record(const unsigned char* records, size_t n, uint64_t timestamp, uint32_t cpf, uint32_t cpt)
+{
+  RecordEntry entry;
+  entry.timestamp = timestamp;
+  entry.cpf = cpf;
+  entry.cpt = cpt;
+  entry.sensor = sensor_;
+  entry.reserved = 0;
+  for(size_t i = 0; i < n; ++i)
+  {
+    const uint32_t* record = reinterpret_cast<const uint32_t*>(records + i * RDT_RECORD_SIZE);
+    entry.rdt_sequence = ntohl(record[0]);
+    entry.ft_sequence = ntohl(record[1]);
+    entry.status = ntohl(record[2]);
+    for(int j = 0; j < 6; ++j)
+      entry.counts[j] = static_cast<int32_t>(ntohl(record[3 + j]));
+    if(!ring_.push(entry))
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+FTRecorder::FTRecorder()
+: fd_(-1)
+, log_(NULL)
+, map_(NULL)
+, map_size_(0)
+, chunk_size_(0)
+, ring_size_(0)
+, offset_(0)
+, grow_failed_(false)
+, sensors_described_(0)
+, channel_count_(0)
+, stop_writer_(false)
+, written_(0)
+{
+  memset(channels_, 0, sizeof(channels_));
+  memset(sensors_, 0, sizeof(sensors_));
+}
+
+FTRecorder::~FTRecorder()
+{
+  // The channels can only go once nothing pushes to them anymore
+  const uint32_t count = channel_count_.load(std::memory_order_acquire);
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    FTSensor* sensor = sensors_[i];
+    if(sensor && sensor->isReceiveThreadRunning())
+    {
+      std::cerr << sensor->message_header() << "Recorder destroyed while the sensor is receiving, stopping it" << std::endl;
+      if(sensor->group_)
+        sensor->group_->stop();
+      else
+        sensor->stopReceiveThread();
+    }
+  }
+  close();
+}
+
+bool FTRecorder::open(const std::string& path, size_t ring_size, size_t chunk_size)
+{
+  if(isOpen())
+  {
+    std::cerr << "[ft_recorder] " << path << ": a file is already open" << std::endl;
+    return false;
+  }
+  const size_t page = sysconf(_SC_PAGESIZE);
+  chunk_size_ = ((chunk_size + page - 1) / page) * page;
+  if(chunk_size_ == 0)
+    chunk_size_ = page;
+  ring_size_ = ring_size;
+
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if(fd_ < 0)
+  {
+    std::cerr << "[ft_recorder] Could not open " << path << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  map_size_ = RECORD_HEADER_SIZE + chunk_size_;
+  // Reserve the blocks now, so that writing to the mapping can not fail later
+  const int err = posix_fallocate(fd_, 0, map_size_);
+  void* map = (err == 0) ? mmap(NULL, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0) : MAP_FAILED;
+  if(map == MAP_FAILED)
+  {
+    std::cerr << "[ft_recorder] Could not map " << path << ": " << strerror(err ? err : errno) << std::endl;
+    ::close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  map_ = static_cast<unsigned char*>(map);
+
+  RecordFileHeader* h = header();
+  memset(h, 0, RECORD_HEADER_SIZE);
+  memcpy(h->magic, RECORD_MAGIC, sizeof(h->magic));
+  h->version = RECORD_VERSION;
+  h->byte_order = 0x01020304;
+  h->header_size = RECORD_HEADER_SIZE;
+  h->record_size = sizeof(RecordEntry);
+  h->start_time = timestampNow();
+  snprintf(h->layout, sizeof(h->layout),
+           "timestamp:u64 rdt_sequence:u32 ft_sequence:u32 status:u32 counts:i32[6] "
+           "cpf:u32 cpt:u32 sensor:u16 reserved:u16");
+  offset_ = RECORD_HEADER_SIZE;
+  grow_failed_ = false;
+  if(!startWriter())
+  {
+    munmap(map_, map_size_);
+    ::close(fd_);
+    map_ = NULL;
+    fd_ = -1;
+    return false;
+  }
+  return true;
+}
+
+bool FTRecorder::openCompressed(const std::string& path, size_t ring_size, uint32_t chunk_records)
+{
+  if(isOpen())
+  {
+    std::cerr << "[ft_recorder] " << path << ": a file is already open" << std::endl;
+    return false;
+  }
+  ring_size_ = ring_size;
+  log_ = new FTLogWriter();
+  if(!log_->open(path, chunk_records) || !startWriter())
+  {
+    delete log_;
+    log_ = NULL;
+    return false;
+  }
+  return true;
+}
+
+bool FTRecorder::startWriter()
+{
+  sensors_described_ = 0;
+  written_ = 0;
+  channel_count_ = 0;
+  stop_writer_ = false;
+  if(pthread_create(&writer_, NULL, &FTRecorder::writerEntry, this) != 0)
+  {
+    std::cerr << "\033[1;31m[ft_recorder] Could not create writer thread\033[0m" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool FTRecorder::close()
+{
+  if(!isOpen())
+    return true;
+  const uint32_t count = channel_count_.load(std::memory_order_acquire);
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    if(sensors_[i] && sensors_[i]->isReceiveThreadRunning())
+    {
+      // Still pushing to its channel, which can not be freed
+      std::cerr << sensors_[i]->message_header() << "Can't close the recorder while the sensor is receiving" << std::endl;
+      return false;
+    }
+  }
+  stop_writer_ = true;
+  pthread_join(writer_, NULL);
+
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    detach(sensors_[i]);
+    delete channels_[i];
+  }
+  memset(channels_, 0, sizeof(channels_));
+  memset(sensors_, 0, sizeof(sensors_));
+  channel_count_ = 0;
+
+  if(log_)
+  {
+    log_->close();
+    delete log_;
+    log_ = NULL;
+    return true;
+  }
+
+  // Trim the preallocated space
+  msync(map_, map_size_, MS_SYNC);
+  munmap(map_, map_size_);
+  if(ftruncate(fd_, offset_) != 0)
+    std::cerr << "[ft_recorder] Could not trim the recording: " << strerror(errno) << std::endl;
+  ::close(fd_);
+  map_ = NULL;
+  fd_ = -1;
+  return true;
+}
+
+bool FTRecorder::attach(FTSensor* sensor)
+{
+  if(!isOpen() || !sensor->isInitialized() || sensor->isReceiveThreadRunning() || sensor->recorder_)
+  {
+    std::cerr << sensor->message_header() << "Can't record : recorder must be open, sensor initialized, not receiving nor recorded" << std::endl;
+    return false;
+  }
+  const uint32_t index = channel_count_.load(std::memory_order_relaxed);
+  if(index >= RECORD_MAX_SENSORS)
+  {
+    std::cerr << sensor->message_header() << "Can't record more than " << RECORD_MAX_SENSORS << " sensors in one file" << std::endl;
+    return false;
+  }
+  RecorderChannel* channel = new RecorderChannel(this, static_cast<uint16_t>(index), ring_size_);
+  strncpy(channel->info_.ip, sensor->getIP().c_str(), sizeof(channel->info_.ip) - 1);
+  channel->info_.port = sensor->getPort();
+  channel->info_.http_port = sensor->getHTTPPort();
+  channel->info_.rdt_rate = sensor->getRDTRate();
+  channel->info_.command = sensor->cmd_.command;
+  channel->info_.attached_time = timestampNow();
+  channels_[index] = channel;
+  sensors_[index] = sensor;
+  channel_count_.store(index + 1, std::memory_order_release);
+  sensor->recorder_ = channel;
+  return true;
+}
+
+void FTRecorder::detach(FTSensor* sensor)
+{
+  if(!sensor || !sensor->recorder_)
+    return;
+  if(sensor->isReceiveThreadRunning())
+  {
+    std::cerr << sensor->message_header() << "Can't stop recording while the sensor is receiving" << std::endl;
+    return;
+  }
+  // The channel stays until close(), the writer drains what is left
+  sensor->recorder_ = NULL;
+  for(uint32_t i = 0; i < RECORD_MAX_SENSORS; ++i)
+    if(sensors_[i] == sensor)
+      sensors_[i] = NULL;
+}
+
+uint64_t FTRecorder::recordsDropped() const
+{
+  uint64_t dropped = 0;
+  const uint32_t count = channel_count_.load(std::memory_order_acquire);
+  for(uint32_t i = 0; i < count; ++i)
+    dropped += channels_[i]->dropped_.load(std::memory_order_relaxed);
+  return dropped;
+}
+
+void* FTRecorder::writerEntry(void* arg)
+{
+  static_cast<FTRecorder*>(arg)->writerLoop();
+  return NULL;
+}
+
+void FTRecorder::writerLoop()
+{
+  while(!stop_writer_.load(std::memory_order_relaxed))
+  {
+    if(drainChannels() == 0)
+      usleep(RECORDER_IDLE_US);
+  }
+  // What was received before close()
+  drainChannels();
+}
+
+size_t FTRecorder::drainChannels()
+{
+  if(log_)
+  {
+    // Encode instead of copying
+    const uint32_t count = channel_count_.load(std::memory_order_acquire);
+    size_t n = 0;
+    RecordEntry entry;
+    for(uint32_t i = 0; i < count; ++i)
+    {
+      if(i >= sensors_described_)
+        log_->setSensor(i, channels_[i]->info_);
+      while(channels_[i]->ring_.pop(entry))
+      {
+        log_->append(entry);
+        ++n;
+      }
+    }
+    sensors_described_ = count;
+    written_.fetch_add(n, std::memory_order_relaxed);
+    return n;
+  }
+
+  RecordFileHeader* h = header();
+  const uint32_t count = channel_count_.load(std::memory_order_acquire);
+  size_t n = 0;
+  for(uint32_t i = 0; i < count; ++i)
+  {
+    if(h->sensor_count <= i)
+    {
+      h->sensors[i] = channels_[i]->info_;
+      h->sensor_count = i + 1;
+    }
+    SpscRing<RecordEntry>& ring = channels_[i]->ring_;
+    while(!ring.empty())
+    {
+      if(offset_ + sizeof(RecordEntry) > map_size_ && !grow())
+        return n;
+      // Straight from the ring to the file
+      if(!ring.pop(*reinterpret_cast<RecordEntry*>(map_ + offset_)))
+        break;
+      offset_ += sizeof(RecordEntry);
+      ++n;
+    }
+    h = header();
+  }
+  if(n > 0)
+  {
+    h->record_count = (offset_ - RECORD_HEADER_SIZE) / sizeof(RecordEntry);
+    written_.fetch_add(n, std::memory_order_relaxed);
+  }
+  return n;
+}
+
+bool FTRecorder::grow()
+{
+  const size_t size = map_size_ + chunk_size_;
+  const int err = posix_fallocate(fd_, map_size_, chunk_size_);
+  if(err != 0)
+  {
+    // Rings fill up and further records are counted as dropped
+    if(!grow_failed_)
+      std::cerr << "[ft_recorder] Could not grow the recording: " << strerror(err) << std::endl;
+    grow_failed_ = true;
+    return false;
+  }
+  void* map = mremap(map_, map_size_, size, MREMAP_MAYMOVE);
+  if(map == MAP_FAILED)
+  {
+    std::cerr << "[ft_recorder] Could not remap the recording: " << strerror(errno) << std::endl;
+    return false;
+  }
+  map_ = static_cast<unsigned char*>(map);
+  map_size_ = size;
+  return true;
+}
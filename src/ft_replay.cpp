@@ -0,0 +1,206 @@
+#include "ati_sensor/ft_replay.h"
+#include "ati_sensor/ft_sensor.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace ati;
+
+RecordReplay::RecordReplay()
+: map_(NULL)
+, map_size_(0)
+, records_(NULL)
+, count_(0)
+, next_(0)
+, sensor_(0)
+, speed_(1.0)
+, clock_started_(false)
+, first_timestamp_(0)
+, cpf_(0)
+, cpt_(0)
+, force_scale_(0.0)
+, torque_scale_(0.0)
+{
+}
+
+RecordReplay::~RecordReplay()
+{
+  close();
+}
+
+bool RecordReplay::open(const std::string& path, unsigned int sensor)
+{
+  close();
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if(fd < 0)
+  {
+    std::cerr << "[ft_replay] Could not open " << path << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  struct stat st;
+  if(fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(RecordFileHeader))
+  {
+    std::cerr << "[ft_replay] " << path << " is not a recording" << std::endl;
+    ::close(fd);
+    return false;
+  }
+  void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if(map == MAP_FAILED)
+  {
+    std::cerr << "[ft_replay] Could not map " << path << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  map_ = static_cast<unsigned char*>(map);
+  map_size_ = st.st_size;
+  madvise(map_, map_size_, MADV_SEQUENTIAL);
+
+  const RecordFileHeader& h = header();
+  if(memcmp(h.magic, RECORD_MAGIC, sizeof(h.magic)) != 0 || h.version != RECORD_VERSION
+     || h.byte_order != 0x01020304 || h.record_size != sizeof(RecordEntry) || h.header_size > map_size_)
+  {
+    std::cerr << "[ft_replay] " << path << " is not a version " << RECORD_VERSION
+              << " recording of this byte order" << std::endl;
+    close();
+    return false;
+  }
+  if(h.sensor_count > RECORD_MAX_SENSORS)
+  {
+    std::cerr << "[ft_replay] " << path << " has a corrupt sensor table" << std::endl;
+    close();
+    return false;
+  }
+  if(sensor >= h.sensor_count)
+  {
+    std::cerr << "[ft_replay] " << path << " has " << h.sensor_count << " sensor(s), no sensor " << sensor << std::endl;
+    close();
+    return false;
+  }
+  // A recording that was not closed has a stale count, trust the file size
+  const uint64_t in_file = (map_size_ - h.header_size) / sizeof(RecordEntry);
+  count_ = (h.record_count < in_file) ? h.record_count : in_file;
+  records_ = reinterpret_cast<const RecordEntry*>(map_ + h.header_size);
+  sensor_ = static_cast<uint16_t>(sensor);
+  // Counts are divided by these when read
+  for(uint64_t i = 0; i < count_; ++i)
+  {
+    if(records_[i].sensor == sensor_ && (records_[i].cpf == 0 || records_[i].cpt == 0))
+    {
+      std::cerr << "[ft_replay] " << path << " has no counts per unit in record " << i << std::endl;
+      close();
+      return false;
+    }
+  }
+  rewind();
+  return true;
+}
+
+void RecordReplay::close()
+{
+  if(map_)
+    munmap(map_, map_size_);
+  map_ = NULL;
+  map_size_ = 0;
+  records_ = NULL;
+  count_ = 0;
+  next_ = 0;
+}
+
+void RecordReplay::setSpeed(double speed)
+{
+  speed_ = (speed > 0.0) ? speed : 0.0;
+  // Keep the pace from the next record on
+  clock_started_ = false;
+}
+
+void RecordReplay::rewind()
+{
+  next_ = 0;
+  clock_started_ = false;
+  seekSensor();
+}
+
+bool RecordReplay::seekSensor()
+{
+  while(next_ < count_ && records_[next_].sensor != sensor_)
+    ++next_;
+  return next_ < count_;
+}
+
+const RecordEntry* RecordReplay::peek()
+{
+  return (isOpen() && seekSensor()) ? &records_[next_] : NULL;
+}
+
+size_t RecordReplay::read(Sample* samples, size_t max)
+{
+  if(!isOpen() || max == 0 || !seekSensor())
+    return 0;
+
+  uint64_t due_ns = ~0ULL;  // recorded time up to which records are due
+  if(speed_ > 0.0)
+  {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if(!clock_started_)
+    {
+      clock_started_ = true;
+      first_timestamp_ = records_[next_].timestamp;
+      start_ = now;
+    }
+    // Sleep until the next record is due
+    const uint64_t timestamp = records_[next_].timestamp;
+    const uint64_t wait_ns = (timestamp > first_timestamp_) ? static_cast<uint64_t>((timestamp - first_timestamp_) / speed_) : 0;
+    struct timespec due = start_;
+    due.tv_sec += wait_ns / 1000000000ULL;
+    due.tv_nsec += wait_ns % 1000000000ULL;
+    if(due.tv_nsec >= 1000000000L)
+    {
+      due.tv_nsec -= 1000000000L;
+      ++due.tv_sec;
+    }
+    if(due.tv_sec > now.tv_sec || (due.tv_sec == now.tv_sec && due.tv_nsec > now.tv_nsec))
+    {
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+      now = due;
+    }
+    const double elapsed = (now.tv_sec - start_.tv_sec) * 1e9 + (now.tv_nsec - start_.tv_nsec);
+    due_ns = first_timestamp_ + static_cast<uint64_t>(elapsed * speed_);
+  }
+
+  size_t n = 0;
+  while(n < max && next_ < count_)
+  {
+    const RecordEntry& e = records_[next_];
+    if(e.sensor != sensor_)
+    {
+      ++next_;
+      continue;
+    }
+    if(n > 0 && e.timestamp > due_ns)
+      break;
+    if(e.cpf != cpf_ || e.cpt != cpt_)
+    {
+      cpf_ = e.cpf;
+      cpt_ = e.cpt;
+      force_scale_ = 1.0 / cpf_;
+      torque_scale_ = 1.0 / cpt_;
+    }
+    Sample& s = samples[n++];
+    s.timestamp = e.timestamp;
+    s.rdt_sequence = e.rdt_sequence;
+    s.ft_sequence = e.ft_sequence;
+    s.status = e.status;
+    s.ft[0] = e.counts[0] * force_scale_;
+    s.ft[1] = e.counts[1] * force_scale_;
+    s.ft[2] = e.counts[2] * force_scale_;
+    s.ft[3] = e.counts[3] * torque_scale_;
+    s.ft[4] = e.counts[4] * torque_scale_;
+    s.ft[5] = e.counts[5] * torque_scale_;
+    ++next_;
+  }
+  return n;
+}
@@ -1,150 +1,101 @@
 #include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/ft_convert.h"
+#include "ati_sensor/sensor_group.h"
+#include "ati_sensor/ft_recorder.h"
+#include "ati_sensor/ft_replay.h"
+#include "ati_sensor/rdt_receiver.h"
+#include "ati_sensor/netft_settings.h"
+#include "ati_sensor/shm_stream.h"
+#include "rt_dev.h"
 #include <stdexcept>
+#include <cstddef>
+#include <time.h>
 
-#ifndef XENOMAI_VERSION_MAJOR
-
-// XML related libraries
-#include <libxml/parser.h>
-#include <libxml/tree.h>
-#include <libxml/encoding.h>
-#include <libxml/xmlwriter.h>
 #include <sstream>
 #include <vector>
 #include <string>
 
-#define rt_dev_socket       socket
-#define rt_dev_setsockopt   setsockopt
-#define rt_dev_bind         bind
-#define rt_dev_recvfrom     recvfrom
-#define rt_dev_sendto       sendto
-#define rt_dev_close        close
-#define rt_dev_connect      connect
-#define rt_dev_recv         recv
-#define rt_dev_send         send
-#define RT_SO_TIMEOUT       SO_RCVTIMEO
-
-#else
-
-// Xenomai 2 : give RTnet capabilities
-#if XENOMAI_VERSION_MAJOR == 2
-    #include <rtnet.h>
-    #include <rtdm/rtdm.h>
-#endif
-
-// Xenomai 3 : RTnet is included
-#if XENOMAI_VERSION_MAJOR == 3
-// This is included in the cobalt core
-// Putting it here as a reminder
-#include <sys/socket.h>
-
-#define rt_dev_socket       socket
-#define rt_dev_setsockopt   setsockopt
-#define rt_dev_bind         bind
-#define rt_dev_recvfrom     recvfrom
-#define rt_dev_sendto       sendto
-#define rt_dev_close        close
-#define rt_dev_connect      connect
-#define rt_dev_recv         recv
-#define rt_dev_send         send
-#define rt_dev_setsockopt   setsockopt
-#define RT_SO_TIMEOUT       SO_RCVTIMEO
-
-#endif
-
-
-#endif
-
-#ifndef XENOMAI_VERSION_MAJOR
-// Read elements from XML file
-static void findElementRecusive(xmlNode * a_node,const std::string element_to_find,std::string&  ret)
-{
-  xmlNode *cur_node = NULL;
-  xmlNode *cur_node_temp = NULL;
-
-  //xmlChar parameter_comp[40];
-  for (cur_node = a_node; cur_node; cur_node = cur_node->next) {
-    if (cur_node->type == XML_ELEMENT_NODE) {
-         std::string parameter_comp(reinterpret_cast<const char*>(cur_node->name));
-
-         if(parameter_comp == element_to_find){
-                cur_node_temp=cur_node->children;
-                ret = std::string(reinterpret_cast<const char*>(cur_node_temp->content));
-                continue;
-         }
-    }
-    findElementRecusive(cur_node->children,element_to_find,ret);
-  }
-  return;
-}
-#endif
-
-static std::string getStringInXml(const std::string& xml_s,const std::string& tag)
+// Reception time in nanoseconds since the epoch
+static uint64_t timestampNow()
 {
-    const std::string tag_open = "<"+tag+">";
-    const std::string tag_close = "</"+tag+">";
-    const std::size_t n_start = xml_s.find(tag_open);
-    const std::size_t n_end = xml_s.find(tag_close);
-    return xml_s.substr(n_start+tag_open.length(),n_end);
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
 }
-template<typename T>
-static T getNumberInXml(const std::string& xml_s,const std::string& tag)
+// Held for the duration of a request to the web server
+struct HttpLock
 {
-    const std::string num = getStringInXml(xml_s,tag);
-    double r = ::atof(num.c_str());
-    return static_cast<T>(r);
-}
-template<typename T>
-static bool getArrayFromString(const std::string& str,const char delim,T *data,size_t len)
-{
-    size_t start = str.find_first_not_of(delim), end=start;
-    size_t idx = 0;
-    while (start != std::string::npos && idx < len){
-        end = str.find(delim, start);
-        std::string token = str.substr(start, end-start);
-        if (token.empty())
-          token = "0.0";
-        double r = ::atof(token.c_str());
-        data[idx] = static_cast<T>(r);
-        ++idx;
-        start = str.find_first_not_of(delim, end);
-    }
-    return (idx == len);
-}
-template<typename T>
-static bool getArrayFromXml(const std::string& xml_s,const std::string& tag,const char delim,T *data,size_t len)
-{
-    const std::string str = getStringInXml(xml_s,tag);
-    return getArrayFromString<T>(str,delim,data,len);
-}
+  explicit HttpLock(pthread_mutex_t& mutex) : mutex_(mutex) {pthread_mutex_lock(&mutex_);}
+  ~HttpLock() {pthread_mutex_unlock(&mutex_);}
+  pthread_mutex_t& mutex_;
+};
 
 
 using namespace ati;
 
+// Applications allocate sensors with new, see CACHE_LINE_SIZE
+static_assert(alignof(FTSensor) <= alignof(std::max_align_t), "FTSensor must not be over-aligned");
+
 FTSensor::FTSensor()
 {
     //  Default parameters
     initialized_                = false;
     ip                          = ati::default_ip;
     port                        = command_s::DEFAULT_PORT;
+    http_port_                  = 80;
     cmd_.command                = command_s::STOP;
     cmd_.sample_count           = 1;
     calibration_index           = ati::current_calibration;
     socketHandle_               = -1;
-    resp_.cpf                   = 1000000;
-    resp_.cpt                   = 1000000;
+    setCountsPerUnit(1000000, 1000000);
+    memset(&sample_, 0, sizeof(sample_));
     rdt_rate_                   = 0;
     timeval_.tv_sec             = 2;
     timeval_.tv_usec            = 0;
-    xml_s_.reserve(MAX_XML_SIZE);
     setbias_ = new int[6];
+    receive_thread_running_     = false;
+    stop_receive_thread_        = false;
+    dropped_samples_            = 0;
+    stream_read_                = READ_NEWEST;
+    stream_sample_count_        = 1;
+    receive_batch_period_us_    = 0;
+    receive_error_report_       = 0;
+    receive_errors_             = 0;
+    records_count_              = 0;
+    records_pos_                = 0;
+    requested_remaining_        = 0;
+    ring_                       = NULL;
+    receiver_                   = NULL;
+    kernel_timestamps_          = false;
+    group_                      = NULL;
+    recorder_                   = NULL;
+    replay_                     = NULL;
+    replay_continuous_          = false;
+    polling_warned_             = false;
+    shm_                        = NULL;
+    use_calibration_cache_      = false;
+    calibration_source_         = CALIBRATION_DEFAULT;
+    calibration_thread_running_ = false;
+    pthread_mutex_init(&http_mutex_, NULL);
 }
 
 FTSensor::~FTSensor()
 {
+  waitCalibrationRefresh();
+  if(group_)
+    group_->remove(this);
+  stopReceiveThread();
+  if(recorder_)
+    recorder_->recorder()->detach(this);
+  delete ring_;
+  delete receiver_;
+  delete replay_;
+  delete shm_;
   stopStreaming();
   if(!closeSockets())
     std::cerr << message_header() << "Sensor did not shutdown correctly" << std::endl;
   delete setbias_;
+  pthread_mutex_destroy(&http_mutex_);
 }
 
 bool FTSensor::startStreaming(int nb_samples)
@@ -194,28 +145,33 @@ bool FTSensor::startStreaming()
 
 bool FTSensor::init(std::string ip, int calibration_index, uint16_t cmd, int sample_count)
 {
+  // The socket is registered in the epoll set of the group
+  if(group_)
+  {
+    std::cerr << message_header() << "Can't re-initialize a sensor of a SensorGroup, remove it first" << std::endl;
+    return false;
+  }
   //  Re-Initialize parameters
+  stopReceiveThread();
+  waitCalibrationRefresh();
+  delete replay_;
+  replay_ = NULL;
   initialized_ = true;
   this->ip = ip;
-  this->port = command_s::DEFAULT_PORT;
   cmd_.command = command_s::STOP;
   cmd_.sample_count = 1;
+  records_count_ = 0;
+  records_pos_ = 0;
   this->calibration_index = calibration_index;
 
   //  Open Socket
   if(!ip.empty() && openSockets())
   {
-
-#if !defined(XENOMAI_VERSION_MAJOR) || (XENOMAI_VERSION_MAJOR == 3)
-
-    if (rt_dev_setsockopt(socketHandle_, SOL_SOCKET, RT_SO_TIMEOUT,&timeval_,sizeof(timeval_)) < 0)
-        std::cerr << message_header() << "Error setting timeout" << std::endl;
-#elif XENOMAI_VERSION_MAJOR == 2
+#if defined(XENOMAI_VERSION_MAJOR) && (XENOMAI_VERSION_MAJOR == 2)
     std::cout <<  message_header() << "Initializing ft sensor (xenomai 2.x + rtnet)"<< std::endl;
-    nanosecs_rel_t timeout = (long long)timeval_.tv_sec*1E9 + (long long)timeval_.tv_usec*1E3;
-    if( rt_dev_ioctl(socketHandle_, RTNET_RTIOC_TIMEOUT, &timeout) < 0)
-        std::cerr << message_header() << "Error setting timeout" << std::endl;
 #endif
+    if (!setReceiveTimeout(timeval_))
+        std::cerr << message_header() << "Error setting timeout" << std::endl;
 
     if(!stopStreaming()) // if previously launched
         std::cerr << "\033[33m" << message_header() << "Could not stop streaming\033[0m" << std::endl;
@@ -228,11 +184,10 @@ bool FTSensor::init(std::string ip, int calibration_index, uint16_t cmd, int sam
         std::cerr << "\033[1;31m" << message_header() << "Could not start streaming\033[0m" << std::endl;
         return initialized_;
     }
+    // Parse Calibration from web server, or from the cache, before the
+    // first datagram is converted with it
+    loadCalibration();
     initialized_ &= getResponse();
-
-    // Parse Calibration from web server
-    if(initialized_)
-        getCalibrationData();
   }else
     initialized_ = false;
 
@@ -241,11 +196,76 @@ bool FTSensor::init(std::string ip, int calibration_index, uint16_t cmd, int sam
 
   return initialized_;
 }
+bool FTSensor::setReceiveTimeout(const struct timeval& tv)
+{
+#if !defined(XENOMAI_VERSION_MAJOR) || (XENOMAI_VERSION_MAJOR == 3)
+    return rt_dev_setsockopt(socketHandle_, SOL_SOCKET, RT_SO_TIMEOUT,&tv,sizeof(tv)) >= 0;
+#elif XENOMAI_VERSION_MAJOR == 2
+    nanosecs_rel_t timeout = (long long)tv.tv_sec*1E9 + (long long)tv.tv_usec*1E3;
+    return rt_dev_ioctl(socketHandle_, RTNET_RTIOC_TIMEOUT, &timeout) >= 0;
+#endif
+}
+bool FTSensor::initReplay(const std::string& path, unsigned int sensor, double speed)
+{
+  if(group_)
+  {
+    std::cerr << message_header() << "Can't replay on a sensor of a SensorGroup, remove it first" << std::endl;
+    return false;
+  }
+  stopReceiveThread();
+  waitCalibrationRefresh();
+  if(!replay_)
+    replay_ = new RecordReplay();
+  initialized_ = replay_->open(path, sensor);
+  if (!initialized_)
+  {
+    std::cerr << "\033[1;31m" << message_header() << "Could not open recording " << path << "\033[0m" << std::endl;
+    delete replay_;
+    replay_ = NULL;
+    return false;
+  }
+  replay_->setSpeed(speed);
+  const RecordSensorInfo& info = replay_->sensorInfo();
+  this->ip = info.ip;
+  this->port = info.port;
+  http_port_ = info.http_port;
+  rdt_rate_ = info.rdt_rate;
+  cmd_.command = info.command;
+  const RecordEntry* first = replay_->peek();
+  if (first)
+    setCountsPerUnit(first->cpf, first->cpt);
+  // Request by request recordings number the records of every request from 1
+  replay_continuous_ = true;
+  size_t seen = 0;
+  for (uint64_t i = 0; i < replay_->recordCount() && seen < REPLAY_CONTINUITY_RECORDS; ++i)
+  {
+    const RecordEntry& e = replay_->records()[i];
+    if (e.sensor != sensor)
+      continue;
+    if (seen++ > 0 && e.rdt_sequence == 1)
+    {
+      replay_continuous_ = false;
+      break;
+    }
+  }
+  records_count_ = 0;
+  records_pos_ = 0;
+  sequence_.restart();
+  filter_.reset();
+  decimator_.reset();
+  host_bias_.restart();
+  std::cout << message_header() << "Replaying " << path << " at "
+            << (speed > 0 ? speed : 0) << "x (0 : as fast as possible)" << std::endl;
+  return true;
+}
+
 bool FTSensor::openSockets()
 {
   try{
-    // To get the online configuration (need to build rtnet with TCP option)
-    openSocket(socketHTTPHandle_,getIP(),80,IPPROTO_TCP);
+    // To get the online configuration (need to build rtnet with TCP option),
+    // connected on the first request
+    http_.setServer(getIP(),getHTTPPort());
+    http_.setTimeout(timeval_);
     // The data socket
     openSocket(socketHandle_,getIP(),getPort(),IPPROTO_UDP);
   }
@@ -280,6 +300,10 @@ void FTSensor::openSocket(int& handle,const std::string ip,const uint16_t port,c
         throw std::runtime_error("failed to init sensor socket");
     }
 
+    // Stamp RDT datagrams with their arrival time in the kernel, not when we get to read them
+    if(option == IPPROTO_UDP)
+        kernel_timestamps_ = enableReceiveTimestamps(handle);
+
     // re-use address in case it's still binded
     rt_dev_setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, 0, 0);
 
@@ -303,7 +327,8 @@ void FTSensor::openSocket(int& handle,const std::string ip,const uint16_t port,c
 }
 bool FTSensor::closeSockets()
 {
-  return closeSocket(socketHandle_) == 0 && closeSocket(socketHTTPHandle_) == 0;
+  http_.close();
+  return closeSocket(socketHandle_) == 0;
 }
 int FTSensor::closeSocket(const int& handle)
 {
@@ -314,21 +339,137 @@ int FTSensor::closeSocket(const int& handle)
 
 bool FTSensor::getCalibrationData()
 {
-  FTSensor::settings_error_t err = getSettings();
+  CalibrationData data;
+  FTSensor::settings_error_t err = getSettings(data);
+  uint32_t cpf, cpt;
+  getCountsPerUnit(cpf, cpt);
   if(err!=SETTINGS_REQUEST_ERROR && err!=CALIB_PARSE_ERROR)
   {
-      std::cout << message_header() << "Sucessfully retrieved counts per force : " << resp_.cpf << std::endl;
-      std::cout << message_header() << "Sucessfully retrieved counts per torque : " << resp_.cpt << std::endl;
+      std::cout << message_header() << "Sucessfully retrieved counts per force : " << cpf << std::endl;
+      std::cout << message_header() << "Sucessfully retrieved counts per torque : " << cpt << std::endl;
+      const NetFTSettings device = getDeviceSettings();
+      if(device.has(NetFTSettings::SERIAL | NetFTSettings::CALIBRATION_SERIAL))
+          std::cout << message_header() << "Sensor " << device.serial << ", calibration " << device.calibration_serial
+                    << " " << device.calibration_part << " of " << device.calibration_date << ", in "
+                    << device.force_units << " and " << device.torque_units << std::endl;
+      {
+        HttpLock lock(http_mutex_);
+        calibration_source_ = CALIBRATION_SENSOR;
+      }
+      if(use_calibration_cache_ && err==NO_SETTINGS_ERROR
+         && !CalibrationCache(calibration_cache_dir_).store(httpHost(), calibration_index, data))
+          std::cerr << message_header() << "Could not write the calibration cache in "
+                    << CalibrationCache(calibration_cache_dir_).directory() << std::endl;
+      return true;
   }
   else
   {
-      std::cerr << message_header() << "Using default counts per force : " << resp_.cpf << std::endl;
-      std::cerr << message_header() << "Using default counts per torque : " << resp_.cpt << std::endl;
+      std::cerr << message_header() << "Using default counts per force : " << cpf << std::endl;
+      std::cerr << message_header() << "Using default counts per torque : " << cpt << std::endl;
+      return false;
+  }
+}
+
+void FTSensor::setCalibrationCache(bool enable, const std::string& directory)
+{
+  use_calibration_cache_ = enable;
+  calibration_cache_dir_ = directory;
+}
+
+void FTSensor::loadCalibration()
+{
+  CalibrationCache cache(calibration_cache_dir_);
+  if(!use_calibration_cache_ || !cache.load(httpHost(), calibration_index, cached_calibration_))
+  {
+    getCalibrationData();
+    return;
+  }
+  applySettings(cached_calibration_);
+  calibration_source_ = CALIBRATION_CACHE;
+  std::cout << message_header() << "Using cached counts per force : " << cached_calibration_.cpf
+            << ", counts per torque : " << cached_calibration_.cpt << std::endl;
+  // Check them against the web server without delaying the stream
+  calibration_thread_running_ = pthread_create(&calibration_thread_, NULL, &FTSensor::calibrationRefreshEntry, this) == 0;
+  if(!calibration_thread_running_)
+    calibrationRefresh();
+}
+
+void* FTSensor::calibrationRefreshEntry(void* arg)
+{
+  static_cast<FTSensor*>(arg)->calibrationRefresh();
+  return NULL;
+}
+
+void FTSensor::calibrationRefresh()
+{
+  CalibrationData data;
+  int index;
+  {
+    // configure() may select another calibration meanwhile
+    HttpLock lock(http_mutex_);
+    if(fetchSettings(data) != NO_SETTINGS_ERROR || data.cpf == 0 || data.cpt == 0)
+    {
+      std::cerr << "\033[33m" << message_header() << "Could not read the settings from the web server, "
+                << "keeping the cached calibration\033[0m" << std::endl;
+      return;
+    }
+    index = calibration_index;
+    if(data != cached_calibration_)
+      applySettings(data);
+    calibration_source_ = CALIBRATION_SENSOR;
   }
+  if(data == cached_calibration_)
+    return;
+  // Samples received until now were converted with the old values
+  std::cout << "\033[33m" << message_header() << "Settings changed since they were cached, now using counts per force : "
+            << data.cpf << ", counts per torque : " << data.cpt << "\033[0m" << std::endl;
+  if(!CalibrationCache(calibration_cache_dir_).store(httpHost(), index, data))
+    std::cerr << message_header() << "Could not write the calibration cache in "
+              << CalibrationCache(calibration_cache_dir_).directory() << std::endl;
+}
+
+bool FTSensor::waitCalibrationRefresh()
+{
+  if(calibration_thread_running_)
+  {
+    pthread_join(calibration_thread_, NULL);
+    calibration_thread_running_ = false;
+  }
+  return calibration_source_ == CALIBRATION_SENSOR;
 }
 
 FTSensor::settings_error_t FTSensor::getSettings()
 {
+  CalibrationData data;
+  return getSettings(data);
+}
+
+FTSensor::settings_error_t FTSensor::getSettings(CalibrationData& data)
+{
+  HttpLock lock(http_mutex_);
+  const settings_error_t err = fetchSettings(data);
+  // Whatever could be parsed is used
+  if(err != SETTINGS_REQUEST_ERROR)
+    applySettings(data);
+  return err;
+}
+
+void FTSensor::applySettings(const CalibrationData& data)
+{
+  setCountsPerUnit(data.cpf, data.cpt);
+  rdt_rate_ = data.rdt_rate;
+  for (int i = 0; i < 6; ++i)
+    setbias_[i] = data.gauge_bias[i];
+}
+
+FTSensor::settings_error_t FTSensor::fetchSettings(CalibrationData& data)
+{
+  // Fields that cannot be parsed keep their current value
+  getCountsPerUnit(data.cpf, data.cpt);
+  data.rdt_rate = rdt_rate_;
+  for (int i = 0; i < 6; ++i)
+    data.gauge_bias[i] = setbias_[i];
+
   std::string index("");
   if(calibration_index != ati::current_calibration)
   {
@@ -339,99 +480,48 @@ FTSensor::settings_error_t FTSensor::getSettings()
   }else
       std::cout << message_header() << "Using current calibration" << std::endl;
 
+  const std::string filename = "/netftapi2.xml"+index;
+  const int status = http_.get(filename);
+  if (status != 200 || http_.bodyLength() == 0)
+  {
 #ifndef XENOMAI_VERSION_MAJOR
-  xmlNode *root_element = NULL;
-  std::string filename = "http://"+getIP()+"/netftapi2.xml"+index;
+    std::cerr << message_header() << "Could not get http://" << httpHost() << filename << std::endl;
+#else
+    std::cerr << message_header() << "Could not get http://" << httpHost() << filename
+              << ". Please make sure that RTnet TCP protocol is installed" << std::endl;
+#endif
+    return SETTINGS_REQUEST_ERROR;
+  }
 
-  xmlDocPtr doc = xmlReadFile(filename.c_str(), NULL, 0);
-  if (doc != NULL)
+  NetFTSettings settings;
+  parseNetFTSettings(http_.body(), http_.bodyLength(), settings);
+  device_settings_ = settings;
+  if (settings.has(NetFTSettings::CPF | NetFTSettings::CPT) && settings.cpf && settings.cpt)
   {
-      root_element = xmlDocGetRootElement(doc);
-
-      std::string cfgcpf;
-      findElementRecusive(root_element,"cfgcpf",cfgcpf);
-      resp_.cpf = static_cast<uint32_t>(::atoi(cfgcpf.c_str()));
-
-      std::string cfgcpt;
-      findElementRecusive(root_element,"cfgcpt",cfgcpt);
-      resp_.cpt = static_cast<uint32_t>(::atoi(cfgcpt.c_str()));
-
-      std::string setbias;
-      findElementRecusive(root_element,"setbias",setbias);
-      // 6 tokens separated by semi-colon
-      if (!getArrayFromString<int>(setbias,';',setbias_, 6))
-      {
-        return GAUGE_PARSE_ERROR;
-      }
-      /* std::cout << "current gauge bias "<< setbias_[0] <<", "
-                                        << setbias_[1] <<", "
-                                        << setbias_[2] <<", "
-                                        << setbias_[3] <<", "
-                                        << setbias_[4] <<", "
-                                        << setbias_[5] <<", " <<std::endl;
-      */
-
-      // Read the RDT Output rate
-      //xmlChar cfgcomrdtrate[40];
-      std::string cfgcomrdtrate;
-      findElementRecusive(root_element,"comrdtrate",cfgcomrdtrate);
-      std::stringstream cfgcomrdtrate_ss;
-      cfgcomrdtrate_ss << cfgcomrdtrate;
-      cfgcomrdtrate_ss >> rdt_rate_;
-
-      xmlFreeDoc(doc);
-      xmlCleanupParser();
-
-      return NO_SETTINGS_ERROR;
+    data.cpf = settings.cpf;
+    data.cpt = settings.cpt;
   }
-  xmlCleanupParser();
-#else
-    static const uint32_t chunkSize = 4;        // Every chunk of data will be of this size
-    static const uint32_t maxSize = 65536;      // The maximum file size to receive
-                          // The recv buffer
-    std::string filename = "/netftapi2.xml"+index; // the name of the file to reveice
-    std::string host = getIP();
-
-    std::string request_s = "GET "+filename+" HTTP/1.1\r\nHost: "+host+"\r\n\r\n";
-
-    if (rt_dev_send(socketHTTPHandle_, request_s.c_str(),request_s.length(), 0) < 0)
-    {
-        std::cerr << message_header() << "Could not send GET request to " << getIP()
-                  << ":80. Please make sure that RTnet TCP protocol is installed" << std::endl;
-        return SETTINGS_REQUEST_ERROR;
-    }
-
-    int recvLength=0;
-    int posBuff = 0;
-    while(posBuff < maxSize) // Just a security to avoid infinity loop
-    {
-            recvLength = rt_dev_recv(socketHTTPHandle_, &xml_c_[posBuff],chunkSize, 0);
-            posBuff += recvLength;
-            if(recvLength <= 0) // The last chunk returns 0
-                break;
-    }
-    xml_s_ = xml_c_;
+  if (settings.has(NetFTSettings::GAUGE_BIAS))
+    memcpy(data.gauge_bias, settings.gauge_bias, sizeof(data.gauge_bias));
+  if (settings.has(NetFTSettings::RDT_RATE))
+    data.rdt_rate = settings.rdt_rate;
 
-    const uint32_t cfgcpf_r = getNumberInXml<uint32_t>(xml_s_,"cfgcpf");
-    const uint32_t cfgcpt_r = getNumberInXml<uint32_t>(xml_s_,"cfgcpt");
-    const int cfgcomrdtrate = getNumberInXml<int>(xml_s_,"comrdtrate");
-    rdt_rate_ = cfgcomrdtrate;
-
-    // 6 tokens separated by semi-colon
-    if (!getArrayFromXml<int>(xml_s_,"setbias",';',setbias_, 6))
-    {
-        return GAUGE_PARSE_ERROR;
-    }
+  if (!settings.has(NetFTSettings::CPF | NetFTSettings::CPT) || !settings.cpf || !settings.cpt)
+  {
+    std::cerr << message_header() << "Could not parse file " << filename << std::endl;
+    return CALIB_PARSE_ERROR;
+  }
+  if (!settings.has(NetFTSettings::GAUGE_BIAS))
+    return GAUGE_PARSE_ERROR;
+  if (!settings.has(NetFTSettings::RDT_RATE))
+    return RDTRATE_PARSE_ERROR;
+  return NO_SETTINGS_ERROR;
+}
 
-    if(cfgcpf_r && cfgcpt_r)
-    {
-        resp_.cpf = cfgcpf_r;
-        resp_.cpt = cfgcpt_r;
-        return NO_SETTINGS_ERROR;
-    }
-#endif
-  std::cerr << message_header() << "Could not parse file " << filename << std::endl;
-  return SETTINGS_REQUEST_ERROR;
+NetFTSettings FTSensor::getDeviceSettings()
+{
+  HttpLock lock(http_mutex_);
+  return device_settings_;
 }
 
 bool FTSensor::sendTCPrequest(std::string &request_cmd)
@@ -441,56 +531,110 @@ bool FTSensor::sendTCPrequest(std::string &request_cmd)
     std::cerr << message_header() << "Empty TCP command, not sending" << std::endl;
     return false;
   }
-  else
+  HttpLock lock(http_mutex_);
+  const int status = http_.get(request_cmd);
+  // The web server redirects to the page of the form
+  if (status == 302 || status == 200)
+    return true;
+  if (status < 0)
   {
-    static const uint32_t chunkSize = 4;        // Every chunk of data will be of this size
-    static const uint32_t maxSize = 65536;      // The maximum file size to receive
-    std::string host = getIP();
-
-    std::string request_s = "GET "+request_cmd+" HTTP/1.0\r\nHost: "+host+"\r\n\r\n";
-
-    if (rt_dev_send(socketHTTPHandle_, request_s.c_str(),request_s.length(), 0) < 0)
-    {
 #ifndef XENOMAI_VERSION_MAJOR
-        std::cerr << message_header() << "Could not send GET request to " << host << ":80." << std::endl;
+    std::cerr << message_header() << "Could not send GET request to " << httpHost() << "." << std::endl;
 #else
-        std::cerr << message_header() << "Could not send GET request to " << host 
-                  << ":80. Please make sure that RTnet TCP protocol is installed" << std::endl;
+    std::cerr << message_header() << "Could not send GET request to " << httpHost()
+              << ". Please make sure that RTnet TCP protocol is installed" << std::endl;
 #endif
-        return false;
-    }
+  }
+  else
+    std::cerr << message_header() << "Bad response from set command " << request_cmd << ", status " << status << std::endl;
+  return false;
+}
 
-    //empty the buffer but we don't care about the result
-    int recvLength=0;
-    int posBuff = 0;
-    while(posBuff < maxSize) // Just a security to avoid infinity loop
-    {
-        recvLength = rt_dev_recv(socketHTTPHandle_, &xml_c_[posBuff],chunkSize, 0);
-        posBuff += recvLength;
-        if(recvLength <= 0) // The last chunk returns 0
-            break;
-    }
-    if (posBuff > 4)
+bool FTSensor::configure(const SettingsUpdate& update)
+{
+  std::vector<std::string> requests;
+  if (!update.gauge_bias.empty())
+  {
+    std::stringstream ss;
+    ss << "/setting.cgi";
+    for (std::map<unsigned int, int>::const_iterator it = update.gauge_bias.begin(); it != update.gauge_bias.end(); ++it)
     {
-        const char *awaited_response = "HTTP/1.0 302 Found";
-        if (strncmp(xml_c_, awaited_response, 18 )==0)
-        {
-            return true;
-        }
-        else
-        {
-            std::cerr << message_header() << "Bad response from set command. Response is :" <<  xml_c_ << std::endl;
-            return false;
-        }
+      if (it->first >= 6)
+      {
+        std::cerr << message_header() << "Invalid gauge number "<< it->first << std::endl;
+        return false;
+      }
+      ss << (it == update.gauge_bias.begin() ? "?" : "&") << "setbias" << it->first << "=" << it->second;
     }
-    else
+    requests.push_back(ss.str());
+  }
+  if (update.rdt_rate != 0 || update.rdt_buffer_size != 0)
+  {
+    // 0 leaves the setting unchanged, anything else must be in range
+    if (update.rdt_rate < 0 || update.rdt_rate > 7000
+        || update.rdt_buffer_size < 0 || update.rdt_buffer_size > RDT_MAX_RECORDS)
     {
-        std::cerr << message_header() << "Bad response from set command. Response is :" <<  xml_c_  << std::endl;
-        return false;
+      std::cerr << message_header() << "RDT rate must be in range [1-7000] and buffer size in [1-" << RDT_MAX_RECORDS << "]" << std::endl;
+      return false;
     }
+    std::stringstream ss;
+    ss << "/comm.cgi?";
+    if (update.rdt_rate != 0)
+      ss << "comrdtrate=" << update.rdt_rate << (update.rdt_buffer_size != 0 ? "&" : "");
+    if (update.rdt_buffer_size != 0)
+      ss << "comrdtbsiz=" << update.rdt_buffer_size;
+    requests.push_back(ss.str());
   }
+  if (update.calibration_index != ati::current_calibration)
+  {
+    std::stringstream ss;
+    ss << "/config.cgi?cfgcalsel=" << update.calibration_index;
+    requests.push_back(ss.str());
+  }
+  if (requests.empty())
+    return true;
+
+  std::vector<int> status;
+  {
+    HttpLock lock(http_mutex_);
+    http_.get(requests, status);
+  }
+  bool ok = true;
+  for (size_t i = 0; i < requests.size(); ++i)
+  {
+    if (status[i] == 302 || status[i] == 200)
+      continue;
+    std::cerr << message_header() << "Bad response from set command " << requests[i] << ", status " << status[i] << std::endl;
+    ok = false;
+  }
+  if (!ok)
+    return false;
+
+  // We consider the settings were applied and only read back the
+  // calibration, needed to convert the samples
+  {
+    // Shared with the calibration refresh thread
+    HttpLock lock(http_mutex_);
+    if (update.rdt_rate != 0)
+      rdt_rate_ = update.rdt_rate;
+    for (std::map<unsigned int, int>::const_iterator it = update.gauge_bias.begin(); it != update.gauge_bias.end(); ++it)
+      setbias_[it->first] = it->second;
+    if (update.calibration_index != ati::current_calibration)
+      calibration_index = update.calibration_index;
+  }
+  if (update.calibration_index != ati::current_calibration)
+    return getCalibrationData();
+  return true;
 }
 
+std::string FTSensor::httpHost()
+{
+  if (getHTTPPort() == 80)
+    return getIP();
+  std::stringstream ss;
+  ss << getIP() << ":" << getHTTPPort();
+  return ss.str();
+}
 
 bool FTSensor::setRDTOutputRate(unsigned int rate)
 {
@@ -526,10 +670,11 @@ bool FTSensor::setGaugeBias(unsigned int gauge_idx, int gauge_bias)
 
 std::vector<int> FTSensor::getGaugeBias()
 {
-  FTSensor::settings_error_t err = getSettings();
+  CalibrationData data;
+  FTSensor::settings_error_t err = getSettings(data);
   if(err!=SETTINGS_REQUEST_ERROR && err!=GAUGE_PARSE_ERROR)
   {
-     std::vector<int> bias(setbias_, setbias_ + 6);
+     std::vector<int> bias(data.gauge_bias, data.gauge_bias + 6);
      return bias;
   }
   else
@@ -552,35 +697,9 @@ bool FTSensor::setGaugeBias(std::vector<int> &gauge_vect)
 
 bool FTSensor::setGaugeBias(std::map<unsigned int, int> &gauge_map)
 {
-  std::stringstream setbias_ss;
-  std::map<unsigned int, int>::iterator it;
-  bool first_element = true;
-  //prepare the query
-  for (it=gauge_map.begin(); it!=gauge_map.end(); ++it)
-  {
-    if( it->first < 6)
-    {
-      if(first_element)
-      {
-        setbias_ss << "?";
-        first_element = false;
-      }
-      else
-      {
-        setbias_ss << "&";
-      }
-      setbias_ss << "setbias" << it->first << "=" << it->second;
-    }
-    else
-    {
-      std::cerr << message_header() << "Invalid gauge number "<< it->first << std::endl;
-      return false;
-    }
-  }
-
-  std::string host = getIP();
-  std::string cmd = "/setting.cgi" + setbias_ss.str();
-  return sendTCPrequest(cmd);
+  SettingsUpdate update;
+  update.gauge_bias = gauge_map;
+  return configure(update);
 }
 
 bool FTSensor::sendCommand()
@@ -594,43 +713,336 @@ bool FTSensor::sendCommand(uint16_t cmd)
   *reinterpret_cast<uint16_t*>(&request_[2]) = htons(cmd);
   *reinterpret_cast<uint32_t*>(&request_[4]) = htonl(cmd_.sample_count);
   //return rt_dev_sendto(socketHandle_, (void*) &request_, sizeof(request_), 0, (sockaddr*) &addr_, addr_len_ ) == 8;
-  return rt_dev_send(socketHandle_, (void*) &request_, sizeof(request_), 0) == sizeof(request_);//, (sockaddr*) &addr_, addr_len_ ) == 8;
+  const bool sent = rt_dev_send(socketHandle_, (void*) &request_, sizeof(request_), 0) == sizeof(request_);//, (sockaddr*) &addr_, addr_len_ ) == 8;
+  if (sent && (cmd == command_s::REALTIME || cmd == command_s::BUFFERED || cmd == command_s::MULTIUNIT))
+  {
+    requested_remaining_ = cmd_.sample_count;
+    // The sensor numbers the records of every request from 1
+    sequence_.restart();
+  }
+  else if (sent && cmd == command_s::STOP)
+    requested_remaining_ = 0;
+  return sent;
 }
 
 bool FTSensor::getResponse()
 {
-
+  records_count_ = 0;
+  records_pos_ = 0;
   //response_ret_ = rt_dev_recvfrom(socketHandle_, (void*) &response_, sizeof(response_), 0, (sockaddr*) &addr_, &addr_len_ );
-  response_ret_ = rt_dev_recv(socketHandle_, (void*) &response_, sizeof(response_), 0);//, (sockaddr*) &addr_, &addr_len_ );
-  resp_.rdt_sequence = ntohl(*reinterpret_cast<uint32_t*>(&response_[0]));
-  resp_.ft_sequence = ntohl(*reinterpret_cast<uint32_t*>(&response_[4]));
-  resp_.status = ntohl(*reinterpret_cast<uint32_t*>(&response_[8]));
-  resp_.Fx = static_cast<int32_t>(ntohl(*reinterpret_cast<int32_t*>(&response_[12 + 0 * 4])));
-  resp_.Fy = static_cast<int32_t>(ntohl(*reinterpret_cast<int32_t*>(&response_[12 + 1 * 4])));
-  resp_.Fz = static_cast<int32_t>(ntohl(*reinterpret_cast<int32_t*>(&response_[12 + 2 * 4])));
-  resp_.Tx = static_cast<int32_t>(ntohl(*reinterpret_cast<int32_t*>(&response_[12 + 3 * 4])));
-  resp_.Ty = static_cast<int32_t>(ntohl(*reinterpret_cast<int32_t*>(&response_[12 + 4 * 4])));
-  resp_.Tz = static_cast<int32_t>(ntohl(*reinterpret_cast<int32_t*>(&response_[12 + 5 * 4])));
+  uint64_t arrival = 0;
+  response_ret_ = receiveTimestamped(socketHandle_, (void*) &response_, sizeof(response_), 0, arrival);
   if (response_ret_ < 0)
   {
     std::cerr << "\033[1;31m" << message_header() << "Error while receiving: " << strerror(errno) << "\033[0m" << std::endl;
   }
-  if (response_ret_!=RDT_RECORD_SIZE)
-    std::cerr << message_header() <<  "Error of package size " <<response_ret_ << " but should be "<< RDT_RECORD_SIZE << std::endl;
-  return response_ret_==RDT_RECORD_SIZE;
+  if (response_ret_ <= 0 || response_ret_ % RDT_RECORD_SIZE != 0)
+  {
+    std::cerr << message_header() <<  "Error of package size " <<response_ret_ << " but should be a multiple of "<< RDT_RECORD_SIZE << std::endl;
+    // Whatever was requested is lost, ask again on the next read
+    requested_remaining_ = 0;
+    return false;
+  }
+  // Buffered mode packs several records in one datagram
+  const uint64_t timestamp = arrival ? arrival : timestampNow();
+  uint32_t cpf, cpt;
+  getCountsPerUnit(cpf, cpt);
+  const double force_scale = 1.0 / cpf;
+  const double torque_scale = 1.0 / cpt;
+  records_count_ = response_ret_ / RDT_RECORD_SIZE;
+  convertRecords(response_, records_count_, timestamp, force_scale, torque_scale, records_);
+  if (recorder_)
+    recorder_->record(response_, records_count_, timestamp, cpf, cpt);
+  requested_remaining_ -= (requested_remaining_ > records_count_) ? records_count_ : requested_remaining_;
+  // Keep only the records the sequence tracker lets through
+  size_t kept = 0;
+  for (size_t i = 0; i < records_count_; ++i)
+    if (sequence_.update(records_[i].rdt_sequence))
+      records_[kept++] = records_[i];
+  records_count_ = kept;
+  records_count_ = filterSamples(records_, records_count_);
+  return true;
+}
+
+size_t FTSensor::readBatch(Sample* samples, size_t max)
+{
+    size_t n = 0;
+    if (isReceiveThreadRunning()) {
+        while (n < max && ring_->pop(samples[n]))
+            ++n;
+    }
+    else if (replay_) {
+        // Same filtering as what comes from the socket, if it was streamed continuously
+        const size_t count = replay_->read(samples, max);
+        for (size_t i = 0; i < count; ++i) {
+            // Each request of the recording numbered its records from 1
+            sequence_.restartIfRenumbered(samples[i].rdt_sequence);
+            if (sequence_.update(samples[i].rdt_sequence))
+                samples[n++] = samples[i];
+        }
+        n = filterSamples(samples, n);
+    }
+    else if (isInitialized()) {
+        // Until a record is left by the sequence tracker and the decimation
+        while (records_pos_ >= records_count_) {
+            // Only ask for more once the previous request is fully received
+            if(cmd_.sample_count != 0 && requested_remaining_ == 0)
+                if(!sendCommand())
+                    std::cerr << message_header() << "Error while sending command" << std::endl;
+            if(!getResponse()) {
+                std::cerr << message_header() << "Error while getting response, command:" <<cmd_.command << std::endl;
+                break;
+            }
+        }
+        while (n < max && records_pos_ < records_count_)
+            samples[n++] = records_[records_pos_++];
+    }
+    if (n > 0)
+        sample_ = samples[n - 1];
+    return n;
 }
 
 void FTSensor::doComm()
 {
-    if (isInitialized()) {
-        if(cmd_.sample_count != 0) //do not repeat send if infinite samples
-            if(!sendCommand())
-                std::cerr << message_header() << "Error while sending command" << std::endl;
-        if(!getResponse())
-            std::cerr << message_header() << "Error while getting response, command:" <<cmd_.command << std::endl;
+    if (isReceiveThreadRunning()) {
+        // Everything is already decoded by the receive thread, no syscall here
+        // A full ring drops the newest samples, the latest slot always holds it
+        if (stream_read_ == READ_CALLBACK)
+            latest_.load(sample_);
+        else if (stream_read_ == READ_NEWEST) {
+            if (ring_->popLatest(sample_))
+                latest_.load(sample_);
+        }
+        else
+            ring_->pop(sample_);
+        return;
+    }
+    readBatch(&sample_, 1);
+}
+
+bool FTSensor::startReceiveThread(stream_read_t policy, size_t ring_size)
+{
+    if (!isInitialized()) {
+        std::cerr << message_header() << "Can't start the receive thread before init()" << std::endl;
+        return false;
+    }
+    if (group_) {
+        std::cerr << message_header() << "Receiving is driven by a SensorGroup, start the group instead" << std::endl;
+        return false;
+    }
+    if (isReceiveThreadRunning())
+        return true;
+    if (replay_) {
+        std::cerr << message_header() << "Replay is read directly, there is no receive thread" << std::endl;
+        return false;
+    }
+    if (!beginStreaming(policy, ring_size))
+        return false;
+
+    // Wake up regularly to check for stop requests
+    struct timeval poll_tv;
+    poll_tv.tv_sec = 0;
+    poll_tv.tv_usec = RECEIVE_THREAD_POLL_US;
+    if (!setReceiveTimeout(poll_tv))
+        std::cerr << message_header() << "Error setting receive thread timeout" << std::endl;
+
+    // Bursts queue in the socket while the thread is preempted
+    if (realtime_.socket_buffer > 0) {
+        const int granted = setSocketReceiveBuffer(socketHandle_, realtime_.socket_buffer);
+        if (granted < 0)
+            std::cerr << message_header() << "Could not size the socket buffer: " << strerror(errno) << std::endl;
+        else if (granted / 2 < realtime_.socket_buffer)
+            std::cerr << message_header() << "Socket buffer limited to " << granted / 2 << " bytes, see net.core.rmem_max" << std::endl;
+    }
+    // Locked once the ring and the receiver are allocated
+    if (realtime_.lock_memory && !lockProcessMemory()) {
+        std::cerr << "\033[1;31m" << message_header() << "Could not lock memory: " << strerror(errno) << "\033[0m" << std::endl;
+        setReceiveTimeout(timeval_);
+        endStreaming();
+        return false;
+    }
+
+    stop_receive_thread_ = false;
+    const int err = createRealtimeThread(receive_thread_, realtime_, &FTSensor::receiveThreadEntry, this);
+    if (err != 0) {
+        std::cerr << "\033[1;31m" << message_header() << "Could not create receive thread: " << strerror(err) << "\033[0m" << std::endl;
+        // Memory stays locked, see lockProcessMemory()
+        setReceiveTimeout(timeval_);
+        endStreaming();
+        return false;
+    }
+    receive_thread_running_.store(true, std::memory_order_release);
+    return true;
+}
+
+void FTSensor::stopReceiveThread()
+{
+    if (!isReceiveThreadRunning())
+        return;
+    if (group_) {
+        std::cerr << message_header() << "Receiving is driven by a SensorGroup, stop the group instead" << std::endl;
+        return;
+    }
+    stop_receive_thread_ = true;
+    pthread_join(receive_thread_, NULL);
+    receive_thread_running_.store(false, std::memory_order_release);
+
+    // Back to request/response mode
+    if (!setReceiveTimeout(timeval_))
+        std::cerr << message_header() << "Error setting timeout" << std::endl;
+    endStreaming();
+}
+
+bool FTSensor::isReceiveThreadRunning()
+{
+    return receive_thread_running_.load(std::memory_order_acquire);
+}
+
+uint64_t FTSensor::getDroppedSamples()
+{
+    return dropped_samples_.load(std::memory_order_relaxed);
+}
+
+void* FTSensor::receiveThreadEntry(void* arg)
+{
+    FTSensor* sensor = static_cast<FTSensor*>(arg);
+    prefaultStack(sensor->realtime_.prefault_stack);
+    sensor->receiveLoop();
+    return NULL;
+}
+
+bool FTSensor::setRealtimeConfig(const RealtimeConfig& config)
+{
+    if (isReceiveThreadRunning()) {
+        std::cerr << message_header() << "Can't change the real-time configuration while the receive thread runs" << std::endl;
+        return false;
+    }
+    realtime_ = config;
+    return true;
+}
+
+void FTSensor::setReceiveBatchPeriod(unsigned int period_us)
+{
+    if (isReceiveThreadRunning()) {
+        std::cerr << message_header() << "Can't change the batch period while the receive thread runs" << std::endl;
+        return;
     }
+    receive_batch_period_us_ = period_us;
 }
 
+bool FTSensor::beginStreaming(stream_read_t policy, size_t ring_size)
+{
+    if (policy == READ_CALLBACK && !sample_callback_) {
+        std::cerr << message_header() << "Set a sample callback before streaming to it only" << std::endl;
+        return false;
+    }
+    stream_read_ = policy;
+    delete ring_;
+    // Stays empty with READ_CALLBACK, readBatch() then returns nothing
+    ring_ = new SpscRing<Sample>(policy == READ_CALLBACK ? 1 : ring_size);
+    if (!receiver_)
+        receiver_ = new RDTReceiver(RECEIVE_BATCH_SIZE, RDT_MAX_DATAGRAM_SIZE);
+    dropped_samples_ = 0;
+
+    // The ring is fed by a continuous stream, re-requesting samples would throttle it
+    stream_sample_count_ = cmd_.sample_count;
+    if (!stopStreaming())
+        std::cerr << message_header() << "Could not stop streaming" << std::endl;
+    return startStreaming(0);
+}
+
+void FTSensor::endStreaming()
+{
+    if (!stopStreaming())
+        std::cerr << message_header() << "Could not stop streaming" << std::endl;
+    if (!startStreaming(stream_sample_count_))
+        std::cerr << message_header() << "Could not restart streaming" << std::endl;
+}
+
+int FTSensor::drainSocket(bool wait)
+{
+    Sample samples[RDT_MAX_RECORDS];
+    const int n = receiver_->receive(socketHandle_, wait);
+    if (n <= 0)
+        return n;
+    const uint64_t now = timestampNow();
+    uint32_t cpf, cpt;
+    getCountsPerUnit(cpf, cpt);
+    const double force_scale = 1.0 / cpf;
+    const double torque_scale = 1.0 / cpt;
+    for (int i = 0; i < n; ++i)
+    {
+        const int length = receiver_->length(i);
+        if (length <= 0 || length % RDT_RECORD_SIZE != 0)
+        {
+            std::cerr << message_header() <<  "Error of package size " << length << " but should be a multiple of "<< RDT_RECORD_SIZE << std::endl;
+            continue;
+        }
+        // Buffered mode packs several records in one datagram
+        const size_t count = length / RDT_RECORD_SIZE;
+        const uint64_t timestamp = receiver_->timestamp(i) ? receiver_->timestamp(i) : now;
+        convertRecords(receiver_->data(i), count, timestamp, force_scale, torque_scale, samples);
+        if (recorder_)
+            recorder_->record(receiver_->data(i), count, timestamp, cpf, cpt);
+        size_t kept = 0;
+        for (size_t j = 0; j < count; ++j)
+            if (sequence_.update(samples[j].rdt_sequence))
+                samples[kept++] = samples[j];
+        kept = filterSamples(samples, kept);
+        if (sample_callback_ && kept > 0)
+            sample_callback_(samples, kept);
+        if (stream_read_ == READ_CALLBACK)
+            continue;
+        for (size_t j = 0; j < kept; ++j)
+            if (!ring_->push(samples[j]))
+                dropped_samples_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return n;
+}
+
+void FTSensor::receiveLoop()
+{
+    struct timespec next_wakeup;
+    clock_gettime(CLOCK_MONOTONIC, &next_wakeup);
+    while (!stop_receive_thread_.load(std::memory_order_relaxed))
+    {
+        bool wait = true;
+        if (receive_batch_period_us_ > 0)
+        {
+            // Let datagrams pile up in the socket, then drain them at once
+            next_wakeup.tv_nsec += static_cast<long>(receive_batch_period_us_) * 1000;
+            while (next_wakeup.tv_nsec >= 1000000000L) {
+                next_wakeup.tv_nsec -= 1000000000L;
+                ++next_wakeup.tv_sec;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_wakeup, NULL);
+            wait = false;
+        }
+
+        // Errors such as ECONNREFUSED come back at once, don't spin on the socket
+        if (drainSocket(wait) < 0 && receiveFailed(errno))
+            usleep(RECEIVE_THREAD_ERROR_BACKOFF_US);
+    }
+}
+
+bool FTSensor::receiveFailed(int error)
+{
+    // Timeouts are only used to poll the stop flag
+    if (error == EAGAIN || error == EWOULDBLOCK || error == EINTR || error == ETIMEDOUT)
+        return false;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ++receive_errors_;
+    if (now.tv_sec != receive_error_report_) {
+        std::cerr << message_header() << "Receive error: " << strerror(error);
+        if (receive_errors_ > 1)
+            std::cerr << " (" << receive_errors_ << " errors in the last second)";
+        std::cerr << std::endl;
+        receive_error_report_ = now.tv_sec;
+        receive_errors_ = 0;
+    }
+    return true;
+}
 
 void FTSensor::setBias()
 {
@@ -642,6 +1054,175 @@ bool FTSensor::isInitialized()
     return initialized_;
 }
 
+void FTSensor::setDropStalePackets(bool drop)
+{
+    if (isReceiveThreadRunning()) {
+        std::cerr << message_header() << "Can't change stale packet dropping while the receive thread runs" << std::endl;
+        return;
+    }
+    sequence_.setDropStale(drop);
+}
+
+bool FTSensor::setSampleCallback(const sample_callback_t& callback)
+{
+    if (isReceiveThreadRunning()) {
+        std::cerr << message_header() << "Can't change the sample callback while the receive thread runs" << std::endl;
+        return false;
+    }
+    sample_callback_ = callback;
+    return true;
+}
+
+bool FTSensor::startSharing(const std::string& name, size_t capacity)
+{
+    if (isReceiveThreadRunning()) {
+        std::cerr << message_header() << "Can't change the shared stream while the receive thread runs" << std::endl;
+        return false;
+    }
+    ShmPublisher* shm = new ShmPublisher();
+    // Rate of the continuous stream the readers are meant to follow
+    const double rate = static_cast<double>(rdt_rate_) / decimator_.factor();
+    if (!shm->open(name, capacity, static_cast<uint32_t>(rate + 0.5))) {
+        std::cerr << message_header() << "Could not share the stream as " << name << std::endl;
+        delete shm;
+        return false;
+    }
+    delete shm_;
+    shm_ = shm;
+    return true;
+}
+
+void FTSensor::stopSharing()
+{
+    if (isReceiveThreadRunning()) {
+        std::cerr << message_header() << "Can't change the shared stream while the receive thread runs" << std::endl;
+        return;
+    }
+    delete shm_;
+    shm_ = NULL;
+}
+
+bool FTSensor::setFilter(const FTFilter& filter)
+{
+    if (isReceiveThreadRunning()) {
+        std::cerr << message_header() << "Can't change the filter while the receive thread runs" << std::endl;
+        return false;
+    }
+    filter_ = filter;
+    if (filter_.empty())
+        return true;
+    polling_warned_ = false;
+    if (!filter_.setSampleRate(rdt_rate_)) {
+        std::cerr << message_header() << "Filter stages above the Nyquist frequency of the RDT rate ("
+                  << rdt_rate_ << " Hz) pass through" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FTSensor::setDecimation(unsigned int factor, unsigned int taps_per_phase)
+{
+    if (isReceiveThreadRunning()) {
+        std::cerr << message_header() << "Can't change the decimation while the receive thread runs" << std::endl;
+        return false;
+    }
+    if (!decimator_.setFactor(factor, taps_per_phase)) {
+        std::cerr << message_header() << "Invalid decimation factor " << factor << " with " << taps_per_phase << " taps per phase" << std::endl;
+        return false;
+    }
+    polling_warned_ = false;
+    return true;
+}
+
+size_t FTSensor::filterSamples(Sample* samples, size_t n)
+{
+    if (n == 0)
+        return 0;
+    if (!filter_.empty() && streamsContinuously()) {
+        // The rate may be changed by another thread, the filter is redesigned by its own
+        const int rate = rdt_rate_.load(std::memory_order_relaxed);
+        if (rate != filter_.sampleRate())
+            filter_.setSampleRate(rate);
+        filter_.process(samples, n);
+    }
+    else if ((!filter_.empty() || decimator_.factor() > 1) && !polling_warned_) {
+        // Polled samples are a read apart, not the RDT period the filter is designed for
+        std::cerr << message_header() << "Polled samples are not filtered nor decimated, start the receive thread or stream with sample count 0" << std::endl;
+        polling_warned_ = true;
+    }
+    host_bias_.record(samples, n);
+    // A read would otherwise wait for factor round trips
+    if (streamsContinuously())
+        n = decimator_.process(samples, n, samples);
+    if (n > 0)
+        latest_.store(samples[n - 1]);
+    if (shm_)
+        shm_->publish(samples, n);
+    return n;
+}
+
+bool FTSensor::getLatestSample(Sample& sample, uint64_t& age_ns)
+{
+    if (!latest_.load(sample))
+        return false;
+    // clock_gettime() is served by the vDSO, no system call. The age jumps
+    // when the clock is stepped, and means nothing for replayed samples
+    const uint64_t now = timestampNow();
+    age_ns = now > sample.timestamp ? now - sample.timestamp : 0;
+    return true;
+}
+
+size_t FTSensor::readBatchInFrames(Sample* const frames[], size_t max, int profile)
+{
+    Sample samples[RDT_MAX_RECORDS];
+    size_t count = 0;
+    while (count < max)
+    {
+        const size_t chunk = (max - count < RDT_MAX_RECORDS) ? max - count : RDT_MAX_RECORDS;
+        const size_t n = profile >= 0 ? readTaredBatch(samples, chunk, profile) : readBatch(samples, chunk);
+        frames_.apply(samples, n, frames, count);
+        count += n;
+        if (n < chunk || !isReceiveThreadRunning())
+            break;
+    }
+    return count;
+}
+
+bool FTSensor::tare(unsigned int profile, size_t n, double reject)
+{
+    if (n > host_bias_.maxSamples()) {
+        std::cerr << message_header() << "Can't tare over more than " << host_bias_.maxSamples() << " samples" << std::endl;
+        return false;
+    }
+    // Without the receive thread nothing comes in between reads
+    if (!isReceiveThreadRunning() && isInitialized() && !replay_) {
+        const uint64_t target = host_bias_.recorded() + n;
+        Sample samples[RDT_MAX_RECORDS];
+        while (host_bias_.recorded() < target)
+            if (readBatch(samples, RDT_MAX_RECORDS) == 0)
+                break;
+    }
+    return host_bias_.tare(profile, n, reject);
+}
+
+void FTSensor::setPort(uint16_t port)
+{
+    if (isInitialized()) {
+        std::cerr << message_header() << "Can't change the port if socket is initialized, call this before init()." << std::endl;
+        return;
+    }
+    this->port = port;
+}
+
+void FTSensor::setHTTPPort(uint16_t port)
+{
+    if (isInitialized()) {
+        std::cerr << message_header() << "Can't change the port if socket is initialized, call this before init()." << std::endl;
+        return;
+    }
+    http_port_ = port;
+}
+
 void FTSensor::setTimeout(float sec)
 {
     if (sec <= 0) {
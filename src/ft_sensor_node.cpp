@@ -3,12 +3,16 @@
 #include <std_msgs/String.h>
 #include <std_msgs/Bool.h>
 #include <geometry_msgs/WrenchStamped.h>
+#include <ati_sensor/WrenchStampedArray.h>
 #include <std_srvs/Empty.h>
 #include <tf/transform_listener.h>
 #include <tf/transform_broadcaster.h>
 #include <tf/transform_datatypes.h>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <boost/shared_ptr.hpp>
+#include <boost/bind.hpp>
 // FTSensor class definition
 #include "ati_sensor/ft_sensor.h"
 
@@ -26,9 +30,18 @@ class FTSensorPublisher
     boost::shared_ptr<ati::FTSensor> ftsensor_;
     std::string ip_;
     std::string frame_ft_;
+    double publish_rate_;
+    //! Wrenches per message, 1 publishes WrenchStamped, more WrenchStampedArray
+    int batch_size_;
+    bool event_driven_;
 
-    //! Publisher for sensor readings
-    ros::Publisher pub_sensor_readings_;
+    //! Publishers for sensor readings, at the index of their frame in the sensor
+    std::vector<ros::Publisher> pub_frames_;
+    //! Samples read in every frame, the sensor frame first
+    std::vector< std::vector<ati::Sample> > frame_samples_;
+    std::vector<ati::Sample*> frame_buffers_;
+    //! Messages being filled in every frame, with batch_size_ > 1
+    std::vector<ati_sensor::WrenchStampedArray> batches_;
 
     //! Service for setting the bias
     ros::ServiceServer srv_set_bias_;
@@ -37,21 +50,51 @@ class FTSensorPublisher
     //------------------ Callbacks -------------------
     // Callback for setting bias
     bool setBiasCallback(std_srvs::Empty::Request &request, std_srvs::Empty::Response &response);
+    // Called by the receive thread of the sensor with every new sample
+    void onSamples(const ati::Sample* samples, size_t n);
 
-    // Publish the measurements
+    // Publish the measurements read since the last call, without the receive thread
     void publishMeasurements();
+    void publish(size_t frame, const ati::Sample* samples, size_t n);
+    // Add the frames of ~output_frames, looked up in tf
+    void addOutputFrames(const std::vector<std::string>& frames, int queue_size);
+
+    double publishRate() const {return publish_rate_;}
+    bool isEventDriven() const {return event_driven_;}
 
     //! Subscribes to and advertises topics
-    FTSensorPublisher(ros::NodeHandle nh) : nh_(nh), priv_nh_("~")
+    FTSensorPublisher(ros::NodeHandle nh) : nh_(nh), priv_nh_("~"), event_driven_(false)
     {
       priv_nh_.param<std::string>("frame", frame_ft_, "/ati_ft_link");
       priv_nh_.param<std::string>("ip", ip_, "192.168.100.103");
+      bool calibration_cache;
+      priv_nh_.param<bool>("calibration_cache", calibration_cache, true);
+      // 0 publishes at the RDT rate
+      priv_nh_.param<double>("publish_rate", publish_rate_, 0.0);
+      priv_nh_.param<int>("batch_size", batch_size_, 1);
+      int queue_size;
+      priv_nh_.param<int>("queue_size", queue_size, 100);
+      std::vector<std::string> output_frames;
+      priv_nh_.param< std::vector<std::string> >("output_frames", output_frames, std::vector<std::string>());
+      // Also share the stream with local processes through shared memory
+      std::string shm_name;
+      priv_nh_.param<std::string>("shm_name", shm_name, "");
+      // SCHED_FIFO receive thread, 0 keeps the normal scheduler
+      int rt_priority, rt_cpu;
+      priv_nh_.param<int>("rt_priority", rt_priority, 0);
+      priv_nh_.param<int>("rt_cpu", rt_cpu, -1);
+      if (batch_size_ < 1)
+        batch_size_ = 1;
+      if (queue_size < 1)
+        queue_size = 1;
 
       ROS_INFO_STREAM("ATISensor IP : "<< ip_);
       ROS_INFO_STREAM("ATISensor frame : "<< frame_ft_);
 
       // Create a new sensor
       ftsensor_ = boost::shared_ptr<ati::FTSensor>(new ati::FTSensor());
+      // Start publishing without waiting for the web server of the sensor
+      ftsensor_->setCalibrationCache(calibration_cache);
 
       // Init FT Sensor
       if (ftsensor_->init(ip_))
@@ -61,11 +104,47 @@ class FTSensorPublisher
 
         ROS_INFO_STREAM("ATISensor RDT Rate : "<< ftsensor_->getRDTRate());
 
-        // Advertise topic where readings are published
-        pub_sensor_readings_ = priv_nh_.advertise<geometry_msgs::WrenchStamped>("data", 10);
+        // Every sample goes through the anti-aliasing filter, one in factor
+        // is published
+        const int factor = publish_rate_ > 0 ? static_cast<int>(ftsensor_->getRDTRate() / publish_rate_ + 0.5) : 1;
+        if (factor > 1)
+          ftsensor_->setDecimation(factor);
+
+        // Topics in the sensor frame and the other frames, all filled from one read
+        const size_t sensor_frame = ftsensor_->addFrame(frame_ft_, ati::WrenchTransform());
+        pub_frames_.resize(sensor_frame + 1);
+        pub_frames_[sensor_frame] = batch_size_ > 1
+                                    ? priv_nh_.advertise<ati_sensor::WrenchStampedArray>("data_array", queue_size)
+                                    : priv_nh_.advertise<geometry_msgs::WrenchStamped>("data", queue_size);
+        addOutputFrames(output_frames, queue_size);
 
         // Advertise service for setting the bias
         srv_set_bias_ = priv_nh_.advertiseService("set_bias", &FTSensorPublisher::setBiasCallback, this);
+
+        if (!shm_name.empty())
+        {
+          if (ftsensor_->startSharing(shm_name))
+            ROS_INFO_STREAM("ATISensor sharing the stream as " << shm_name);
+          else
+            ROS_WARN_STREAM("ATISensor could not share the stream as " << shm_name);
+        }
+
+        if (rt_priority > 0)
+          ftsensor_->setRealtimeConfig(ati::RealtimeConfig::fifo(rt_priority, rt_cpu));
+
+        // Publish from the receive thread as samples arrive
+        ftsensor_->setSampleCallback(boost::bind(&FTSensorPublisher::onSamples, this, _1, _2));
+        event_driven_ = ftsensor_->startReceiveThread(ati::FTSensor::READ_CALLBACK);
+        // Polling is not decimated, it reads at the requested rate
+        if (event_driven_)
+          publish_rate_ = ftsensor_->getOutputRate();
+        else
+        {
+          ROS_WARN_STREAM("ATISensor could not start the receive thread, polling");
+          if (publish_rate_ <= 0)
+            publish_rate_ = 100.0;
+        }
+        ROS_INFO_STREAM("ATISensor publish rate : "<< publish_rate_ << ", " << batch_size_ << " wrenches per message");
       }
       else
       {
@@ -73,37 +152,137 @@ class FTSensorPublisher
       }
     }
 
-    //! Empty stub
-    ~FTSensorPublisher() {}
+    ~FTSensorPublisher()
+    {
+      // No more callbacks once the publishers are gone
+      ftsensor_->stopReceiveThread();
+    }
 
 };
 
 bool FTSensorPublisher::setBiasCallback(std_srvs::Empty::Request &request, std_srvs::Empty::Response &response)
 {
   ftsensor_->setBias();
+  return true;
+}
+
+void FTSensorPublisher::addOutputFrames(const std::vector<std::string>& frames, int queue_size)
+{
+  tf::TransformListener listener;
+  for (size_t i = 0; i < frames.size(); ++i)
+  {
+    // Adding it again would replace the transform of a frame already published
+    if (ftsensor_->getFrames().find(frames[i]) >= 0)
+    {
+      ROS_WARN_STREAM("ATISensor output frame " << frames[i] << " is already published, ignored");
+      continue;
+    }
+    // Pose of the sensor in the output frame
+    tf::StampedTransform transform;
+    try
+    {
+      listener.waitForTransform(frames[i], frame_ft_, ros::Time(0), ros::Duration(5.0));
+      listener.lookupTransform(frames[i], frame_ft_, ros::Time(0), transform);
+    }
+    catch (tf::TransformException& ex)
+    {
+      ROS_ERROR_STREAM("ATISensor output frame " << frames[i] << " ignored : " << ex.what());
+      continue;
+    }
+    const tf::Quaternion q = transform.getRotation();
+    const tf::Vector3 t = transform.getOrigin();
+    const size_t frame = ftsensor_->addFrame(frames[i], ati::WrenchTransform::fromQuaternion(q.x(), q.y(), q.z(), q.w(), t.x(), t.y(), t.z()));
+
+    std::string topic = frames[i];
+    if (!topic.empty() && topic[0] == '/')
+      topic.erase(0, 1);
+    std::replace(topic.begin(), topic.end(), '/', '_');
+    if (frame >= pub_frames_.size())
+      pub_frames_.resize(frame + 1);
+    pub_frames_[frame] = batch_size_ > 1
+                         ? priv_nh_.advertise<ati_sensor::WrenchStampedArray>("data_array_" + topic, queue_size)
+                         : priv_nh_.advertise<geometry_msgs::WrenchStamped>("data_" + topic, queue_size);
+    ROS_INFO_STREAM("ATISensor publishing in " << frames[i] << " on " << pub_frames_[frame].getTopic());
+  }
+
+  // Everything per frame is indexed like the frames of the sensor
+  const ati::WrenchFrames& output = ftsensor_->getFrames();
+  pub_frames_.resize(output.size());
+  frame_samples_.assign(output.size(), std::vector<ati::Sample>(RDT_MAX_RECORDS));
+  for (size_t k = 0; k < output.size(); ++k)
+    frame_buffers_.push_back(&frame_samples_[k][0]);
+  batches_.resize(output.size());
+  for (size_t k = 0; k < output.size(); ++k)
+  {
+    batches_[k].header.frame_id = output.name(k);
+    batches_[k].stamps.reserve(batch_size_);
+    batches_[k].wrenches.reserve(batch_size_);
+  }
+}
+
+void FTSensorPublisher::onSamples(const ati::Sample* samples, size_t n)
+{
+  // At most a datagram, written in every frame at once
+  const ati::WrenchFrames& frames = ftsensor_->getFrames();
+  for (size_t done = 0; done < n; done += RDT_MAX_RECORDS)
+  {
+    const size_t chunk = std::min<size_t>(n - done, RDT_MAX_RECORDS);
+    frames.apply(samples + done, chunk, &frame_buffers_[0]);
+    for (size_t k = 0; k < frames.size(); ++k)
+      publish(k, &frame_samples_[k][0], chunk);
+  }
 }
 
 void FTSensorPublisher::publishMeasurements()
 {
   // Recall that this has to be transformed using the stewart platform
   //tf_broadcaster_.sendTransform(tf::StampedTransform(nano_top_frame_, ros::Time::now(), "/world", "/nano_top_frame"));
-  geometry_msgs::WrenchStamped ftreadings;
-  float measurements[6];
-  ftsensor_->getMeasurements(measurements);
-
-  ftreadings.wrench.force.x = measurements[0];
-  ftreadings.wrench.force.y = measurements[1];
-  ftreadings.wrench.force.z = measurements[2];
-  ftreadings.wrench.torque.x = measurements[3];
-  ftreadings.wrench.torque.y = measurements[4];
-  ftreadings.wrench.torque.z = measurements[5];
+  const size_t n = ftsensor_->readBatchInFrames(&frame_buffers_[0], RDT_MAX_RECORDS);
+  const ati::WrenchFrames& frames = ftsensor_->getFrames();
+  for (size_t k = 0; k < frames.size(); ++k)
+    publish(k, frame_buffers_[k], n);
+}
 
-  ftreadings.header.stamp = ros::Time::now();
-  ftreadings.header.frame_id = frame_ft_;
+void FTSensorPublisher::publish(size_t frame, const ati::Sample* samples, size_t n)
+{
+  // frame is the index in the sensor, also that of its publisher and batch
+  if (frame >= pub_frames_.size() || !pub_frames_[frame])
+    return;
+  const std::string& frame_id = ftsensor_->getFrames().name(frame);
+  for (size_t i = 0; i < n; ++i)
+  {
+    geometry_msgs::Wrench wrench;
+    wrench.force.x = samples[i].ft[0];
+    wrench.force.y = samples[i].ft[1];
+    wrench.force.z = samples[i].ft[2];
+    wrench.torque.x = samples[i].ft[3];
+    wrench.torque.y = samples[i].ft[4];
+    wrench.torque.z = samples[i].ft[5];
+    // When the datagram arrived, not when we got around to publishing it
+    ros::Time stamp;
+    stamp.fromNSec(samples[i].timestamp);
 
-  pub_sensor_readings_.publish(ftreadings);
+    if (batch_size_ == 1)
+    {
+      geometry_msgs::WrenchStamped ftreadings;
+      ftreadings.wrench = wrench;
+      ftreadings.header.stamp = stamp;
+      ftreadings.header.frame_id = frame_id;
+      pub_frames_[frame].publish(ftreadings);
+      continue;
+    }
 
-  //ROS_INFO("Measured Force: %f %f %f Measured Torque: %f %f %f", measurements[0], measurements[1], measurements[2], measurements[3], measurements[4], measurements[5]);
+    ati_sensor::WrenchStampedArray& batch = batches_[frame];
+    batch.stamps.push_back(stamp);
+    batch.wrenches.push_back(wrench);
+    if (batch.wrenches.size() >= static_cast<size_t>(batch_size_))
+    {
+      batch.header.stamp = stamp;
+      pub_frames_[frame].publish(batch);
+      batch.stamps.clear();
+      batch.wrenches.clear();
+    }
+  }
 }
 
 } // namespace ftsensor
@@ -112,10 +291,16 @@ int main(int argc, char **argv)
 {
   ros::init(argc, argv, "ft_sensor");
   ros::NodeHandle nh;
-  ros::Rate loop(100);
   try
   {
     ftsensor::FTSensorPublisher node(nh);
+    if (node.isEventDriven())
+    {
+      // Samples are published by the receive thread, only serve the bias service
+      ros::spin();
+      return 0;
+    }
+    ros::Rate loop(node.publishRate());
     while(ros::ok())
     {
       node.publishMeasurements();
@@ -0,0 +1,135 @@
+#include "ati_sensor/host_bias.h"
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/claimed_ring.h"
+#include <math.h>
+#include <string.h>
+
+// Readers give up after this many concurrent overwrites
+#define HOST_BIAS_MAX_RETRIES 100
+
+using namespace ati;
+
+HostBias::HostBias(size_t history)
+: capacity_(history < 2 * CLAIMED_RING_CHUNK ? 2 * CLAIMED_RING_CHUNK : history)
+, claimed_(0)
+, head_(0)
+, history_(capacity_ * 6)
+{
+}
+
+void HostBias::record(const Sample* samples, size_t n)
+{
+  double* const history = &history_[0];
+  const size_t capacity = capacity_;
+  claimedRingWrite(claimed_, head_, n, [history, capacity, samples](uint64_t position, size_t i) {
+    memcpy(&history[(position % capacity) * 6], samples[i].ft, sizeof(samples[i].ft));
+  });
+}
+
+void HostBias::restart()
+{
+  claimed_.store(0, std::memory_order_relaxed);
+  head_.store(0, std::memory_order_release);
+}
+
+bool HostBias::tare(unsigned int profile, size_t n, double reject)
+{
+  if (profile >= MAX_PROFILES || n == 0 || n > maxSamples())
+    return false;
+
+  std::vector<double> window(n * 6);
+  bool copied = false;
+  for (int attempt = 0; attempt < HOST_BIAS_MAX_RETRIES && !copied; ++attempt)
+  {
+    const uint64_t head = head_.load(std::memory_order_acquire);
+    if (head < n)
+      return false;
+    for (size_t i = 0; i < n; ++i)
+      memcpy(&window[i * 6], &history_[((head - n + i) % capacity_) * 6], 6 * sizeof(double));
+    copied = claimedRingOverwritten(claimed_, head - n, capacity_) == 0;
+  }
+  if (!copied)
+    return false;
+
+  double mean[6] = {0, 0, 0, 0, 0, 0};
+  for (size_t i = 0; i < n; ++i)
+    for (int j = 0; j < 6; ++j)
+      mean[j] += window[i * 6 + j];
+  for (int j = 0; j < 6; ++j)
+    mean[j] /= n;
+
+  if (reject > 0 && n > 2)
+  {
+    double limit[6] = {0, 0, 0, 0, 0, 0};
+    for (size_t i = 0; i < n; ++i)
+      for (int j = 0; j < 6; ++j)
+        limit[j] += (window[i * 6 + j] - mean[j]) * (window[i * 6 + j] - mean[j]);
+    for (int j = 0; j < 6; ++j)
+      limit[j] = reject * sqrt(limit[j] / (n - 1));
+
+    // A sample off on one axis, e.g. a knock, is off on all of them
+    double kept_mean[6] = {0, 0, 0, 0, 0, 0};
+    size_t kept = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      bool outlier = false;
+      for (int j = 0; j < 6; ++j)
+        outlier |= fabs(window[i * 6 + j] - mean[j]) > limit[j];
+      if (outlier)
+        continue;
+      for (int j = 0; j < 6; ++j)
+        kept_mean[j] += window[i * 6 + j];
+      ++kept;
+    }
+    if (kept > 0)
+      for (int j = 0; j < 6; ++j)
+        mean[j] = kept_mean[j] / kept;
+  }
+  store(profile, mean);
+  return true;
+}
+
+void HostBias::clear(unsigned int profile)
+{
+  if (profile >= MAX_PROFILES)
+    return;
+  const double zero[6] = {0, 0, 0, 0, 0, 0};
+  store(profile, zero);
+}
+
+void HostBias::store(unsigned int profile, const double offset[6])
+{
+  Profile& p = profiles_[profile];
+  const uint32_t version = p.version.load(std::memory_order_relaxed);
+  p.version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(p.offset, offset, sizeof(p.offset));
+  p.version.store(version + 2, std::memory_order_release);
+}
+
+bool HostBias::offset(unsigned int profile, double offset[6]) const
+{
+  if (profile >= MAX_PROFILES)
+    return false;
+  const Profile& p = profiles_[profile];
+  for (;;)
+  {
+    const uint32_t version = p.version.load(std::memory_order_acquire);
+    if (version & 1)
+      continue;
+    memcpy(offset, p.offset, sizeof(p.offset));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (p.version.load(std::memory_order_relaxed) == version)
+      return true;
+  }
+}
+
+void HostBias::apply(unsigned int profile, Sample* samples, size_t n) const
+{
+  double o[6];
+  if (!offset(profile, o))
+    return;
+  for (size_t i = 0; i < n; ++i)
+    for (int j = 0; j < 6; ++j)
+      samples[i].ft[j] -= o[j];
+}
@@ -0,0 +1,296 @@
+#include "ati_sensor/http_client.h"
+#include "rt_dev.h"
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sstream>
+
+using namespace ati;
+
+// Find needle in [begin, end), NULL if absent
+static const char* findSequence(const char* begin, const char* end, const char* needle, size_t length)
+{
+  for (const char* p = begin; p + length <= end; ++p)
+  {
+    p = static_cast<const char*>(memchr(p, needle[0], end - p));
+    if (!p || p + length > end)
+      return NULL;
+    if (memcmp(p, needle, length) == 0)
+      return p;
+  }
+  return NULL;
+}
+
+HttpClient::HttpClient()
+: port_(80)
+, keep_alive_(true)
+, socket_(-1)
+, server_closes_(false)
+, buffer_(HTTP_MAX_RESPONSE_SIZE)
+, buffer_used_(0)
+, response_length_(0)
+, body_offset_(0)
+, body_length_(0)
+, connections_(0)
+{
+  timeout_.tv_sec = 2;
+  timeout_.tv_usec = 0;
+}
+
+HttpClient::~HttpClient()
+{
+  close();
+}
+
+void HttpClient::setServer(const std::string& host, uint16_t port)
+{
+  if (host == host_ && port == port_)
+    return;
+  close();
+  host_ = host;
+  port_ = port;
+  server_closes_ = false;
+}
+
+void HttpClient::setTimeout(const struct timeval& tv)
+{
+  timeout_ = tv;
+  close();
+}
+
+void HttpClient::setKeepAlive(bool keep_alive)
+{
+  keep_alive_ = keep_alive;
+}
+
+void HttpClient::close()
+{
+  if (socket_ >= 0)
+    ::rt_dev_close(socket_);
+  socket_ = -1;
+}
+
+bool HttpClient::connect()
+{
+  close();
+  buffer_used_ = 0;
+  response_length_ = 0;
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port_);
+  if (inet_pton(AF_INET, host_.c_str(), &addr.sin_addr) != 1)
+  {
+    hostent* he = gethostbyname(host_.c_str());
+    if (!he)
+      return false;
+    memcpy(&addr.sin_addr, he->h_addr_list[0], he->h_length);
+  }
+
+  socket_ = rt_dev_socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (socket_ < 0)
+    return false;
+#if !defined(XENOMAI_VERSION_MAJOR) || (XENOMAI_VERSION_MAJOR == 3)
+  rt_dev_setsockopt(socket_, SOL_SOCKET, RT_SO_TIMEOUT, &timeout_, sizeof(timeout_));
+#elif XENOMAI_VERSION_MAJOR == 2
+  nanosecs_rel_t timeout = (long long)timeout_.tv_sec*1E9 + (long long)timeout_.tv_usec*1E3;
+  rt_dev_ioctl(socket_, RTNET_RTIOC_TIMEOUT, &timeout);
+#endif
+#ifndef XENOMAI_VERSION_MAJOR
+  // Bounds connect() too, and the requests are small and latency bound
+  setsockopt(socket_, SOL_SOCKET, SO_SNDTIMEO, &timeout_, sizeof(timeout_));
+  int yes = 1;
+  setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+#endif
+
+  if (::rt_dev_connect(socket_, (struct sockaddr*) &addr, sizeof(addr)) < 0)
+  {
+    close();
+    return false;
+  }
+  ++connections_;
+  return true;
+}
+
+bool HttpClient::sendAll(const std::string& data)
+{
+  size_t sent = 0;
+  while (sent < data.size())
+  {
+#ifndef XENOMAI_VERSION_MAJOR
+    const ssize_t n = rt_dev_send(socket_, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+#else
+    const ssize_t n = rt_dev_send(socket_, data.data() + sent, data.size() - sent, 0);
+#endif
+    if (n <= 0)
+      return false;
+    sent += n;
+  }
+  return true;
+}
+
+void HttpClient::discardResponse()
+{
+  if (!isConnected())
+    buffer_used_ = 0;
+  else if (response_length_ > 0)
+  {
+    memmove(&buffer_[0], &buffer_[response_length_], buffer_used_ - response_length_);
+    buffer_used_ -= response_length_;
+  }
+  response_length_ = 0;
+  body_offset_ = 0;
+  body_length_ = 0;
+}
+
+int HttpClient::readResponse()
+{
+  // Headers
+  const char* header_end = NULL;
+  while (!(header_end = findSequence(&buffer_[0], &buffer_[0] + buffer_used_, "\r\n\r\n", 4)))
+  {
+    if (buffer_used_ == buffer_.size())
+      return -1;
+    const ssize_t n = rt_dev_recv(socket_, &buffer_[buffer_used_], buffer_.size() - buffer_used_, 0);
+    if (n <= 0)
+      return buffer_used_ == 0 && n == 0 ? 0 : -1;
+    buffer_used_ += n;
+  }
+  const size_t headers_length = header_end + 4 - &buffer_[0];
+
+  // Status line : HTTP/1.x NNN Reason
+  const std::string headers(&buffer_[0], headers_length);
+  if (headers.compare(0, 7, "HTTP/1.") != 0 || headers.size() < 12)
+    return -1;
+  const bool http10 = (headers[7] == '0');
+  const int status = atoi(headers.c_str() + 9);
+  if (status < 100 || status > 999)
+    return -1;
+
+  bool has_length = false;
+  size_t content_length = 0;
+  bool close_header = false, keep_alive_header = false;
+  size_t line = headers.find("\r\n") + 2;
+  while (line < headers_length - 2)
+  {
+    const size_t line_end = headers.find("\r\n", line);
+    const size_t colon = headers.find(':', line);
+    if (colon != std::string::npos && colon < line_end)
+    {
+      const std::string name = headers.substr(line, colon - line);
+      size_t value = colon + 1;
+      while (value < line_end && (headers[value] == ' ' || headers[value] == '\t'))
+        ++value;
+      const std::string v = headers.substr(value, line_end - value);
+      if (strcasecmp(name.c_str(), "Content-Length") == 0)
+      {
+        has_length = true;
+        content_length = strtoul(v.c_str(), NULL, 10);
+      }
+      else if (strcasecmp(name.c_str(), "Connection") == 0)
+      {
+        close_header = (strncasecmp(v.c_str(), "close", 5) == 0);
+        keep_alive_header = (strncasecmp(v.c_str(), "keep-alive", 10) == 0);
+      }
+    }
+    line = line_end + 2;
+  }
+  server_closes_ = close_header || (http10 && !keep_alive_header) || !has_length;
+
+  // Body, compared without overflowing on a huge Content-Length
+  if (has_length && content_length > buffer_.size() - headers_length)
+    return -1;
+  while (!has_length || buffer_used_ < headers_length + content_length)
+  {
+    if (buffer_used_ == buffer_.size())
+      return -1;
+    const ssize_t n = rt_dev_recv(socket_, &buffer_[buffer_used_], buffer_.size() - buffer_used_, 0);
+    if (n == 0 && !has_length)
+      break;
+    if (n <= 0)
+      return -1;
+    buffer_used_ += n;
+  }
+  body_offset_ = headers_length;
+  body_length_ = has_length ? content_length : buffer_used_ - headers_length;
+  response_length_ = headers_length + body_length_;
+  return status;
+}
+
+int HttpClient::get(const std::string& target)
+{
+  std::vector<std::string> targets(1, target);
+  std::vector<int> status;
+  get(targets, status);
+  return status[0];
+}
+
+size_t HttpClient::get(const std::vector<std::string>& targets, std::vector<int>& status)
+{
+  status.assign(targets.size(), -1);
+  std::string host = host_;
+  if (port_ != 80)
+  {
+    std::stringstream ss;
+    ss << host_ << ":" << port_;
+    host = ss.str();
+  }
+
+  size_t next = 0;
+  bool retried = false;
+  while (next < targets.size())
+  {
+    discardResponse();
+    const bool reused = isConnected();
+    if (!reused && !connect())
+      break;
+
+    // Pipeline the remaining requests, unless the server closes after each
+    const size_t batch = (keep_alive_ && !server_closes_) ? targets.size() - next : 1;
+    std::string requests;
+    for (size_t i = next; i < next + batch; ++i)
+      requests += "GET " + targets[i] + " HTTP/1.1\r\nHost: " + host
+                + (keep_alive_ ? "\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+
+    size_t answered = 0;
+    if (sendAll(requests))
+    {
+      while (answered < batch)
+      {
+        const int code = readResponse();
+        if (code <= 0)
+        {
+          close();
+          break;
+        }
+        status[next++] = code;
+        ++answered;
+        if (server_closes_)
+        {
+          close();
+          break;
+        }
+        if (answered < batch)
+          discardResponse();
+      }
+    }
+    else
+      close();
+
+    // An idle connection may have been closed by the server, try a new one once
+    if (answered == 0)
+    {
+      if (!reused || retried)
+        break;
+      retried = true;
+    }
+  }
+  return next;
+}
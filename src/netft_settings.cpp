@@ -0,0 +1,239 @@
+#include "ati_sensor/netft_settings.h"
+#include <string.h>
+
+using namespace ati;
+
+namespace {
+
+struct TagField
+{
+  const char* name;
+  size_t length;
+  uint32_t field;
+};
+
+const TagField tag_fields[] = {
+  {"cfgcpf",     6,  NetFTSettings::CPF},
+  {"cfgcpt",     6,  NetFTSettings::CPT},
+  {"setbias",    7,  NetFTSettings::GAUGE_BIAS},
+  {"comrdtrate", 10, NetFTSettings::RDT_RATE},
+  {"comrdtbsiz", 10, NetFTSettings::RDT_BUFFER_SIZE},
+  {"cfgcalsel",  9,  NetFTSettings::CALIBRATION_INDEX},
+  {"scfgfu",     6,  NetFTSettings::FORCE_UNITS},
+  {"scfgtu",     6,  NetFTSettings::TORQUE_UNITS},
+  {"setserial",  9,  NetFTSettings::SERIAL},
+  {"setfwver",   8,  NetFTSettings::FIRMWARE},
+  {"calsn",      5,  NetFTSettings::CALIBRATION_SERIAL},
+  {"calpartnum", 10, NetFTSettings::CALIBRATION_PART},
+  {"calcaldt",   8,  NetFTSettings::CALIBRATION_DATE}
+};
+const size_t tag_field_count = sizeof(tag_fields) / sizeof(tag_fields[0]);
+
+inline bool isSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline bool isNameChar(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+      || c == '_' || c == '-' || c == '.' || c == ':';
+}
+
+inline const char* find(const char* p, const char* end, char c)
+{
+  if (p >= end)
+    return NULL;
+  return static_cast<const char*>(memchr(p, c, static_cast<size_t>(end - p)));
+}
+
+void trim(const char*& begin, const char*& end)
+{
+  while (begin < end && isSpace(*begin))
+    ++begin;
+  while (end > begin && isSpace(end[-1]))
+    --end;
+}
+
+// A decimal integer, optionally followed by a fractional part that is
+// dropped, like atof() and a cast did
+bool parseInteger(const char* begin, const char* end, int64_t min, int64_t max, int64_t& value)
+{
+  trim(begin, end);
+  bool negative = false;
+  if (begin < end && (*begin == '-' || *begin == '+'))
+    negative = (*begin++ == '-');
+  if (begin == end || *begin < '0' || *begin > '9')
+    return false;
+  int64_t v = 0;
+  for (; begin < end && *begin >= '0' && *begin <= '9'; ++begin)
+  {
+    v = v * 10 + (*begin - '0');
+    if (v > max - min)
+      return false;
+  }
+  if (begin < end && *begin == '.')
+    for (++begin; begin < end && *begin >= '0' && *begin <= '9'; ++begin) {}
+  if (begin != end)
+    return false;
+  v = negative ? -v : v;
+  if (v < min || v > max)
+    return false;
+  value = v;
+  return true;
+}
+
+bool parseIntegers(const char* begin, const char* end, char delim, int* values, size_t count)
+{
+  int parsed[6];
+  for (size_t i = 0; i < count; ++i)
+  {
+    const char* next = (i + 1 < count) ? find(begin, end, delim) : end;
+    int64_t v;
+    if (!next || !parseInteger(begin, next, INT32_MIN, INT32_MAX, v))
+      return false;
+    parsed[i] = static_cast<int>(v);
+    begin = next + 1;
+  }
+  memcpy(values, parsed, count * sizeof(int));
+  return true;
+}
+
+template<size_t N>
+bool copyString(const char* begin, const char* end, char (&out)[N])
+{
+  trim(begin, end);
+  size_t n = end - begin;
+  if (n > N - 1)
+    n = N - 1;
+  memcpy(out, begin, n);
+  out[n] = '\0';
+  return true;
+}
+
+bool parseField(uint32_t field, const char* begin, const char* end, NetFTSettings& s)
+{
+  int64_t v;
+  switch (field)
+  {
+    case NetFTSettings::CPF:
+      if (!parseInteger(begin, end, 0, UINT32_MAX, v))
+        return false;
+      s.cpf = static_cast<uint32_t>(v);
+      return true;
+    case NetFTSettings::CPT:
+      if (!parseInteger(begin, end, 0, UINT32_MAX, v))
+        return false;
+      s.cpt = static_cast<uint32_t>(v);
+      return true;
+    case NetFTSettings::GAUGE_BIAS:
+      return parseIntegers(begin, end, ';', s.gauge_bias, 6);
+    case NetFTSettings::RDT_RATE:
+      if (!parseInteger(begin, end, 0, INT32_MAX, v))
+        return false;
+      s.rdt_rate = static_cast<int>(v);
+      return true;
+    case NetFTSettings::RDT_BUFFER_SIZE:
+      if (!parseInteger(begin, end, 0, INT32_MAX, v))
+        return false;
+      s.rdt_buffer_size = static_cast<int>(v);
+      return true;
+    case NetFTSettings::CALIBRATION_INDEX:
+      if (!parseInteger(begin, end, INT32_MIN, INT32_MAX, v))
+        return false;
+      s.calibration_index = static_cast<int>(v);
+      return true;
+    case NetFTSettings::FORCE_UNITS:
+      return copyString(begin, end, s.force_units);
+    case NetFTSettings::TORQUE_UNITS:
+      return copyString(begin, end, s.torque_units);
+    case NetFTSettings::SERIAL:
+      return copyString(begin, end, s.serial);
+    case NetFTSettings::FIRMWARE:
+      return copyString(begin, end, s.firmware);
+    case NetFTSettings::CALIBRATION_SERIAL:
+      return copyString(begin, end, s.calibration_serial);
+    case NetFTSettings::CALIBRATION_PART:
+      return copyString(begin, end, s.calibration_part);
+    case NetFTSettings::CALIBRATION_DATE:
+      return copyString(begin, end, s.calibration_date);
+    default:
+      return false;
+  }
+}
+
+}
+
+NetFTSettings::NetFTSettings()
+{
+  clear();
+}
+
+void NetFTSettings::clear()
+{
+  memset(this, 0, sizeof(*this));
+}
+
+unsigned int ati::parseNetFTSettings(const char* xml, size_t length, NetFTSettings& settings)
+{
+  uint32_t seen = 0;
+  const char* p = xml;
+  const char* const end = xml + length;
+  while (p < end)
+  {
+    p = find(p, end, '<');
+    if (!p || ++p == end)
+      break;
+
+    // Comments, declarations, processing instructions and end tags
+    if (*p == '!' && end - p >= 3 && p[1] == '-' && p[2] == '-')
+    {
+      for (p += 3; (p = find(p, end, '-')) && end - p >= 3 && !(p[1] == '-' && p[2] == '>'); ++p) {}
+      if (!p || end - p < 3)
+        break;
+      p += 3;
+      continue;
+    }
+    if (*p == '!' || *p == '?' || *p == '/')
+    {
+      p = find(p, end, '>');
+      if (!p)
+        break;
+      ++p;
+      continue;
+    }
+
+    // Start tag, and its attributes if any
+    const char* name = p;
+    while (p < end && isNameChar(*p))
+      ++p;
+    const size_t name_length = p - name;
+    const char* close = find(p, end, '>');
+    if (!close)
+      break;
+    const bool empty_element = (close[-1] == '/');
+    p = close + 1;
+    if (name_length == 0 || empty_element)
+      continue;
+
+    const TagField* tag = NULL;
+    for (size_t i = 0; i < tag_field_count && !tag; ++i)
+      if (tag_fields[i].length == name_length && memcmp(tag_fields[i].name, name, name_length) == 0)
+        tag = &tag_fields[i];
+    if (!tag)
+      continue;
+
+    // The text up to the next tag, ours are never nested
+    const char* value_end = find(p, end, '<');
+    if (!value_end)
+      break;
+    if (parseField(tag->field, p, value_end, settings))
+      seen |= tag->field;
+    p = value_end;
+  }
+  settings.found |= seen;
+  unsigned int count = 0;
+  for (; seen; seen &= seen - 1)
+    ++count;
+  return count;
+}
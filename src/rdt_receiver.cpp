@@ -0,0 +1,147 @@
+#include "ati_sensor/rdt_receiver.h"
+#include "rt_dev.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <time.h>
+
+#if defined(__linux__) && (!defined(XENOMAI_VERSION_MAJOR) || XENOMAI_VERSION_MAJOR == 3)
+#define ATI_SENSOR_HAVE_RECVMMSG
+#endif
+
+#if defined(SO_TIMESTAMPNS) && (!defined(XENOMAI_VERSION_MAJOR) || XENOMAI_VERSION_MAJOR == 3)
+#define ATI_SENSOR_HAVE_TIMESTAMPNS
+#endif
+
+// Room for the SCM_TIMESTAMPNS control message of one datagram
+#define RDT_CONTROL_SIZE 64
+
+using namespace ati;
+
+#ifdef ATI_SENSOR_HAVE_TIMESTAMPNS
+static uint64_t controlTimestamp(struct msghdr* msg)
+{
+  for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(msg); cmsg != NULL; cmsg = CMSG_NXTHDR(msg, cmsg))
+  {
+    if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+    {
+      struct timespec ts;
+      memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+      return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+    }
+  }
+  return 0;
+}
+#endif
+
+bool ati::enableReceiveTimestamps(int socket)
+{
+#ifdef ATI_SENSOR_HAVE_TIMESTAMPNS
+  const int on = 1;
+  return rt_dev_setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) == 0;
+#else
+  (void)socket;
+  return false;
+#endif
+}
+
+int ati::receiveTimestamped(int socket, void* buffer, size_t size, int flags, uint64_t& timestamp)
+{
+  timestamp = 0;
+#ifdef ATI_SENSOR_HAVE_TIMESTAMPNS
+  union {
+    struct cmsghdr align;
+    unsigned char data[RDT_CONTROL_SIZE];
+  } control;
+  struct iovec iov;
+  iov.iov_base = buffer;
+  iov.iov_len = size;
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control.data;
+  msg.msg_controllen = sizeof(control.data);
+  const int ret = recvmsg(socket, &msg, flags);
+  if(ret >= 0)
+    timestamp = controlTimestamp(&msg);
+  return ret;
+#else
+  return rt_dev_recv(socket, buffer, size, flags);
+#endif
+}
+
+RDTReceiver::RDTReceiver(size_t max_datagrams, size_t datagram_size)
+: max_datagrams_(max_datagrams > 0 ? max_datagrams : 1)
+, datagram_size_(datagram_size)
+, buffer_(max_datagrams_ * datagram_size_)
+, lengths_(max_datagrams_, 0)
+, timestamps_(max_datagrams_, 0)
+, control_(max_datagrams_ * RDT_CONTROL_SIZE)
+, msgs_(NULL)
+, iov_(NULL)
+, syscalls_(0)
+, datagrams_(0)
+{
+#ifdef ATI_SENSOR_HAVE_RECVMMSG
+  msgs_ = new struct mmsghdr[max_datagrams_];
+  iov_ = new struct iovec[max_datagrams_];
+  memset(msgs_, 0, max_datagrams_ * sizeof(struct mmsghdr));
+  for(size_t i = 0; i < max_datagrams_; ++i)
+  {
+    iov_[i].iov_base = &buffer_[i * datagram_size_];
+    iov_[i].iov_len = datagram_size_;
+    msgs_[i].msg_hdr.msg_iov = &iov_[i];
+    msgs_[i].msg_hdr.msg_iovlen = 1;
+  }
+#endif
+}
+
+RDTReceiver::~RDTReceiver()
+{
+  delete[] msgs_;
+  delete[] iov_;
+}
+
+int RDTReceiver::receive(int socket, bool wait)
+{
+#ifdef ATI_SENSOR_HAVE_RECVMMSG
+  const int flags = wait ? MSG_WAITFORONE : MSG_DONTWAIT;
+  // The kernel shrinks msg_controllen to what it wrote, restore it
+  for(size_t i = 0; i < max_datagrams_; ++i)
+  {
+    msgs_[i].msg_hdr.msg_control = &control_[i * RDT_CONTROL_SIZE];
+    msgs_[i].msg_hdr.msg_controllen = RDT_CONTROL_SIZE;
+  }
+  const int n = recvmmsg(socket, msgs_, max_datagrams_, flags, NULL);
+  ++syscalls_;
+  if(n < 0)
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+  for(int i = 0; i < n; ++i)
+  {
+    lengths_[i] = static_cast<int>(msgs_[i].msg_len);
+#ifdef ATI_SENSOR_HAVE_TIMESTAMPNS
+    timestamps_[i] = controlTimestamp(&msgs_[i].msg_hdr);
+#endif
+  }
+#else
+  int n = 0;
+  while(n < static_cast<int>(max_datagrams_))
+  {
+    const int flags = (wait && n == 0) ? 0 : MSG_DONTWAIT;
+    uint64_t timestamp;
+    const int ret = receiveTimestamped(socket, &buffer_[n * datagram_size_], datagram_size_, flags, timestamp);
+    ++syscalls_;
+    if(ret < 0)
+    {
+      if(n == 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ETIMEDOUT)
+        return -1;
+      break;
+    }
+    timestamps_[n] = timestamp;
+    lengths_[n++] = ret;
+  }
+#endif
+  datagrams_ += n;
+  return n;
+}
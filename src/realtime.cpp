@@ -0,0 +1,100 @@
+#include "ati_sensor/realtime.h"
+#include <alloca.h>
+#include <errno.h>
+#include <malloc.h>
+#include <sched.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+// Largest stack prefaulted, well within the default 8 MB stacks
+#define REALTIME_MAX_PREFAULT (4 << 20)
+
+using namespace ati;
+
+RealtimeConfig RealtimeConfig::fifo(int priority, int cpu)
+{
+  RealtimeConfig config;
+  config.priority = priority;
+  config.cpu = cpu;
+  config.lock_memory = true;
+  config.prefault_stack = 256 << 10;
+  config.socket_buffer = 1 << 20;
+  return config;
+}
+
+int ati::createRealtimeThread(pthread_t& thread, const RealtimeConfig& config, void* (*entry)(void*), void* arg)
+{
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  int err = 0;
+  if (config.priority > 0)
+  {
+    // Not inherited from the creating thread
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = config.priority;
+    err = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    if (!err)
+      err = pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    if (!err)
+      err = pthread_attr_setschedparam(&attr, &param);
+  }
+#ifdef __linux__
+  if (!err && config.cpu >= 0)
+  {
+    if (config.cpu >= CPU_SETSIZE)
+      err = EINVAL;
+    else
+    {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(config.cpu, &cpus);
+      err = pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+    }
+  }
+#else
+  if (config.cpu >= 0)
+    err = ENOTSUP;
+#endif
+  if (!err)
+    err = pthread_create(&thread, &attr, entry, arg);
+  pthread_attr_destroy(&attr);
+  return err;
+}
+
+bool ati::lockProcessMemory()
+{
+#ifdef M_TRIM_THRESHOLD
+  // Freed memory stays in the heap, new blocks come from it rather than mmap()
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+#endif
+  return mlockall(MCL_CURRENT | MCL_FUTURE) == 0;
+}
+
+void ati::prefaultStack(size_t bytes)
+{
+  if (bytes == 0)
+    return;
+  if (bytes > REALTIME_MAX_PREFAULT)
+    bytes = REALTIME_MAX_PREFAULT;
+  unsigned char* stack = static_cast<unsigned char*>(alloca(bytes));
+  memset(stack, 0, bytes);
+  // Keep the stores
+  __asm__ __volatile__("" : : "r"(stack) : "memory");
+}
+
+int ati::setSocketReceiveBuffer(int socket, int bytes)
+{
+#ifdef SO_RCVBUFFORCE
+  if (setsockopt(socket, SOL_SOCKET, SO_RCVBUFFORCE, &bytes, sizeof(bytes)) < 0)
+#endif
+    if (setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes)) < 0)
+      return -1;
+  int granted = 0;
+  socklen_t length = sizeof(granted);
+  if (getsockopt(socket, SOL_SOCKET, SO_RCVBUF, &granted, &length) < 0)
+    return -1;
+  return granted;
+}
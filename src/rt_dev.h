@@ -0,0 +1,52 @@
+// Socket primitives shared by the library sources :
+// plain POSIX sockets, or RTnet sockets when building for Xenomai
+#ifndef ATI_SENSOR_RT_DEV_H
+#define ATI_SENSOR_RT_DEV_H
+
+#ifndef XENOMAI_VERSION_MAJOR
+
+#include <sys/socket.h>
+
+#define rt_dev_socket       socket
+#define rt_dev_setsockopt   setsockopt
+#define rt_dev_bind         bind
+#define rt_dev_recvfrom     recvfrom
+#define rt_dev_sendto       sendto
+#define rt_dev_close        close
+#define rt_dev_connect      connect
+#define rt_dev_recv         recv
+#define rt_dev_send         send
+#define RT_SO_TIMEOUT       SO_RCVTIMEO
+
+#else
+
+// Xenomai 2 : give RTnet capabilities
+#if XENOMAI_VERSION_MAJOR == 2
+    #include <rtnet.h>
+    #include <rtdm/rtdm.h>
+#endif
+
+// Xenomai 3 : RTnet is included
+#if XENOMAI_VERSION_MAJOR == 3
+// This is included in the cobalt core
+// Putting it here as a reminder
+#include <sys/socket.h>
+
+#define rt_dev_socket       socket
+#define rt_dev_setsockopt   setsockopt
+#define rt_dev_bind         bind
+#define rt_dev_recvfrom     recvfrom
+#define rt_dev_sendto       sendto
+#define rt_dev_close        close
+#define rt_dev_connect      connect
+#define rt_dev_recv         recv
+#define rt_dev_send         send
+#define rt_dev_setsockopt   setsockopt
+#define RT_SO_TIMEOUT       SO_RCVTIMEO
+
+#endif
+
+
+#endif
+
+#endif
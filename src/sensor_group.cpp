@@ -0,0 +1,281 @@
+#include "ati_sensor/sensor_group.h"
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+
+// RTDM sockets can not be polled from Linux, the group needs plain sockets
+#if defined(__linux__) && !defined(XENOMAI_VERSION_MAJOR)
+#define ATI_SENSOR_HAVE_EPOLL
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+// Events handled per epoll_wait() call
+#define GROUP_MAX_EVENTS 64
+
+using namespace ati;
+
+SensorGroup::SensorGroup()
+: policy_(FTSensor::READ_NEWEST)
+, ring_size_(1024)
+, batch_period_us_(0)
+, epoll_fd_(-1)
+, wake_fd_(-1)
+, running_(false)
+, stop_(false)
+, wakeups_(0)
+, datagrams_(0)
+{
+}
+
+SensorGroup::~SensorGroup()
+{
+  stop();
+  for(size_t i = 0; i < sensors_.size(); ++i)
+    sensors_[i]->group_ = NULL;
+}
+
+bool SensorGroup::add(FTSensor* sensor)
+{
+  if(isRunning())
+  {
+    std::cerr << sensor->message_header() << "Can't add a sensor to a running group" << std::endl;
+    return false;
+  }
+  if(!sensor->isInitialized() || sensor->isReceiveThreadRunning() || sensor->group_ || sensor->replay_)
+  {
+    std::cerr << sensor->message_header() << "Sensor must be initialized on a live socket, without receive thread nor group" << std::endl;
+    return false;
+  }
+  sensor->group_ = this;
+  sensors_.push_back(sensor);
+  return true;
+}
+
+void SensorGroup::remove(FTSensor* sensor)
+{
+  std::vector<FTSensor*>::iterator it = std::find(sensors_.begin(), sensors_.end(), sensor);
+  if(it == sensors_.end())
+    return;
+  const bool was_running = isRunning();
+  stop();
+  sensors_.erase(it);
+  sensor->group_ = NULL;
+  if(was_running && !sensors_.empty())
+    start(policy_, ring_size_);
+}
+
+void SensorGroup::setBatchPeriod(unsigned int period_us)
+{
+  if(isRunning())
+  {
+    std::cerr << "[sensor_group] Can't change the batch period while the group runs" << std::endl;
+    return;
+  }
+  batch_period_us_ = period_us;
+}
+
+void SensorGroup::setRealtimeConfig(const RealtimeConfig& config)
+{
+  if(isRunning())
+  {
+    std::cerr << "[sensor_group] Can't change the real-time configuration while the group runs" << std::endl;
+    return;
+  }
+  realtime_ = config;
+}
+
+bool SensorGroup::start(FTSensor::stream_read_t policy, size_t ring_size)
+{
+#ifdef ATI_SENSOR_HAVE_EPOLL
+  if(isRunning())
+    return true;
+  for(size_t i = 0; i < sensors_.size(); ++i)
+  {
+    if(sensors_[i]->isReceiveThreadRunning())
+    {
+      std::cerr << sensors_[i]->message_header() << "Sensor has its own receive thread, stop it before starting the group" << std::endl;
+      return false;
+    }
+  }
+  policy_ = policy;
+  ring_size_ = ring_size;
+
+  epoll_fd_ = epoll_create1(0);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK);
+  if(epoll_fd_ < 0 || wake_fd_ < 0)
+  {
+    std::cerr << "[sensor_group] Could not create epoll instance: " << strerror(errno) << std::endl;
+    stop();
+    return false;
+  }
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev);
+
+  size_t started = 0;
+  for(; started < sensors_.size(); ++started)
+  {
+    FTSensor* sensor = sensors_[started];
+    if(!sensor->beginStreaming(policy, ring_size))
+      break;
+    ev.data.ptr = sensor;
+    if(epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, sensor->socketHandle_, &ev) < 0)
+    {
+      sensor->endStreaming();
+      break;
+    }
+    sensor->receive_thread_running_.store(true, std::memory_order_release);
+  }
+  if(started < sensors_.size())
+  {
+    std::cerr << sensors_[started]->message_header() << "Could not start streaming in the group" << std::endl;
+    for(size_t i = 0; i < started; ++i)
+    {
+      sensors_[i]->receive_thread_running_.store(false, std::memory_order_release);
+      sensors_[i]->endStreaming();
+    }
+    close(epoll_fd_);
+    close(wake_fd_);
+    epoll_fd_ = wake_fd_ = -1;
+    return false;
+  }
+
+  for(size_t i = 0; realtime_.socket_buffer > 0 && i < sensors_.size(); ++i)
+  {
+    const int granted = setSocketReceiveBuffer(sensors_[i]->socketHandle_, realtime_.socket_buffer);
+    if(granted < 0)
+      std::cerr << sensors_[i]->message_header() << "Could not size the socket buffer: " << strerror(errno) << std::endl;
+    else if(granted / 2 < realtime_.socket_buffer)
+      std::cerr << sensors_[i]->message_header() << "Socket buffer limited to " << granted / 2
+                << " bytes, see net.core.rmem_max" << std::endl;
+  }
+  if(realtime_.lock_memory && !lockProcessMemory())
+  {
+    std::cerr << "\033[1;31m[sensor_group] Could not lock memory: " << strerror(errno) << "\033[0m" << std::endl;
+    running_.store(true, std::memory_order_release);
+    stop_ = true;
+    stop();
+    return false;
+  }
+
+  stop_ = false;
+  wakeups_ = 0;
+  datagrams_ = 0;
+  const int err = createRealtimeThread(thread_, realtime_, &SensorGroup::loopEntry, this);
+  if(err != 0)
+  {
+    std::cerr << "\033[1;31m[sensor_group] Could not create receive thread: " << strerror(err) << "\033[0m" << std::endl;
+    // Memory stays locked, see lockProcessMemory()
+    running_.store(true, std::memory_order_release);
+    stop_ = true;
+    stop();
+    return false;
+  }
+  running_.store(true, std::memory_order_release);
+  return true;
+#else
+  (void)policy;
+  (void)ring_size;
+  std::cerr << "[sensor_group] Not supported on this platform, use FTSensor::startReceiveThread()" << std::endl;
+  return false;
+#endif
+}
+
+void SensorGroup::stop()
+{
+#ifdef ATI_SENSOR_HAVE_EPOLL
+  if(isRunning())
+  {
+    if(!stop_)
+    {
+      stop_ = true;
+      const uint64_t one = 1;
+      if(write(wake_fd_, &one, sizeof(one)) != sizeof(one))
+        std::cerr << "[sensor_group] Could not wake up the receive thread" << std::endl;
+      pthread_join(thread_, NULL);
+    }
+    // Back to request/response mode
+    for(size_t i = 0; i < sensors_.size(); ++i)
+    {
+      sensors_[i]->receive_thread_running_.store(false, std::memory_order_release);
+      sensors_[i]->endStreaming();
+    }
+    running_.store(false, std::memory_order_release);
+  }
+  if(epoll_fd_ >= 0)
+    close(epoll_fd_);
+  if(wake_fd_ >= 0)
+    close(wake_fd_);
+  epoll_fd_ = wake_fd_ = -1;
+#endif
+}
+
+void* SensorGroup::loopEntry(void* arg)
+{
+  SensorGroup* group = static_cast<SensorGroup*>(arg);
+  prefaultStack(group->realtime_.prefault_stack);
+  group->loop();
+  return NULL;
+}
+
+void SensorGroup::loop()
+{
+#ifdef ATI_SENSOR_HAVE_EPOLL
+  struct epoll_event events[GROUP_MAX_EVENTS];
+  struct timespec next_wakeup;
+  clock_gettime(CLOCK_MONOTONIC, &next_wakeup);
+  while(!stop_.load(std::memory_order_relaxed))
+  {
+    int timeout = -1;
+    if(batch_period_us_ > 0)
+    {
+      // Let datagrams pile up in every socket, then drain them at once
+      next_wakeup.tv_nsec += static_cast<long>(batch_period_us_) * 1000;
+      while(next_wakeup.tv_nsec >= 1000000000L)
+      {
+        next_wakeup.tv_nsec -= 1000000000L;
+        ++next_wakeup.tv_sec;
+      }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_wakeup, NULL);
+      timeout = 0;
+    }
+
+    const int n = epoll_wait(epoll_fd_, events, GROUP_MAX_EVENTS, timeout);
+    if(n < 0)
+    {
+      if(errno != EINTR)
+        std::cerr << "[sensor_group] epoll_wait error: " << strerror(errno) << std::endl;
+      continue;
+    }
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    uint64_t datagrams = 0;
+    bool failed = false;
+    for(int i = 0; i < n; ++i)
+    {
+      FTSensor* sensor = static_cast<FTSensor*>(events[i].data.ptr);
+      if(!sensor)
+        continue;  // stop request, checked by the loop
+      // A full batch means more may be queued
+      int received;
+      do
+      {
+        received = sensor->drainSocket(false);
+        if(received > 0)
+          datagrams += received;
+      }
+      while(received == static_cast<int>(sensor->receiver_->maxDatagrams()));
+      if(received < 0 && sensor->receiveFailed(errno))
+        failed = true;
+    }
+    datagrams_.fetch_add(datagrams, std::memory_order_relaxed);
+    // Same back-off as the receive thread of a sensor
+    if(failed)
+      usleep(RECEIVE_THREAD_ERROR_BACKOFF_US);
+  }
+#endif
+}
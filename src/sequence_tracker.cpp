@@ -0,0 +1,118 @@
+#include "ati_sensor/sequence_tracker.h"
+
+// Larger jumps, forward or backward, are not network effects
+#define SEQUENCE_RESYNC_DISTANCE 100000
+// Depth of the duplicate detection bitmap
+#define SEQUENCE_HISTORY 64
+
+using namespace ati;
+
+SequenceTracker::SequenceTracker(uint32_t loss_window)
+: started_(false)
+, drop_stale_(false)
+, last_(0)
+, window_(0)
+, loss_window_(loss_window > 0 ? loss_window : 1)
+, window_expected_(0)
+, window_lost_(0)
+{
+  resetStats();
+}
+
+void SequenceTracker::restart()
+{
+  started_ = false;
+}
+
+void SequenceTracker::restartIfRenumbered(uint32_t rdt_sequence)
+{
+  if (started_ && (rdt_sequence == 1 || static_cast<int32_t>(rdt_sequence - last_) <= -SEQUENCE_HISTORY))
+    started_ = false;
+}
+
+bool SequenceTracker::update(uint32_t rdt_sequence)
+{
+  received_.fetch_add(1, std::memory_order_relaxed);
+  const int32_t distance = static_cast<int32_t>(rdt_sequence - last_);
+
+  if (!started_ || distance > SEQUENCE_RESYNC_DISTANCE || distance < -SEQUENCE_RESYNC_DISTANCE)
+  {
+    if (started_)
+      resyncs_.fetch_add(1, std::memory_order_relaxed);
+    started_ = true;
+    last_ = rdt_sequence;
+    window_ = 1;
+    return true;
+  }
+
+  if (distance > 0)
+  {
+    // In order, possibly after a gap
+    const uint32_t skipped = static_cast<uint32_t>(distance) - 1;
+    if (skipped > 0)
+      lost_.fetch_add(skipped, std::memory_order_relaxed);
+    window_ = (distance >= SEQUENCE_HISTORY) ? 1 : ((window_ << distance) | 1);
+    last_ = rdt_sequence;
+
+    window_expected_ += distance;
+    window_lost_ += skipped;
+    if (window_expected_ >= loss_window_)
+    {
+      recent_loss_rate_.store(static_cast<double>(window_lost_) / window_expected_, std::memory_order_relaxed);
+      window_expected_ = 0;
+      window_lost_ = 0;
+    }
+    return true;
+  }
+
+  const uint32_t age = static_cast<uint32_t>(-distance);
+  if (age < SEQUENCE_HISTORY && (window_ & (1ULL << age)))
+  {
+    duplicates_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  // Past the bitmap we cannot tell a late record from an old duplicate :
+  // stale either way, and not credited against the losses
+  if (age >= SEQUENCE_HISTORY)
+  {
+    stale_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  // Late : it was counted as lost when skipped
+  window_ |= 1ULL << age;
+  reordered_.fetch_add(1, std::memory_order_relaxed);
+  if (lost_.load(std::memory_order_relaxed) > 0)
+    lost_.fetch_sub(1, std::memory_order_relaxed);
+  if (window_lost_ > 0)
+    --window_lost_;
+  if (drop_stale_)
+  {
+    stale_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  return true;
+}
+
+SequenceStats SequenceTracker::stats() const
+{
+  SequenceStats s;
+  s.received = received_.load(std::memory_order_relaxed);
+  s.lost = lost_.load(std::memory_order_relaxed);
+  s.reordered = reordered_.load(std::memory_order_relaxed);
+  s.duplicates = duplicates_.load(std::memory_order_relaxed);
+  s.stale_dropped = stale_dropped_.load(std::memory_order_relaxed);
+  s.resyncs = resyncs_.load(std::memory_order_relaxed);
+  s.recent_loss_rate = recent_loss_rate_.load(std::memory_order_relaxed);
+  return s;
+}
+
+void SequenceTracker::resetStats()
+{
+  received_ = 0;
+  lost_ = 0;
+  reordered_ = 0;
+  duplicates_ = 0;
+  stale_dropped_ = 0;
+  resyncs_ = 0;
+  recent_loss_rate_ = 0.0;
+}
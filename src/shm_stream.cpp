@@ -0,0 +1,277 @@
+#include "ati_sensor/shm_stream.h"
+#include "ati_sensor/claimed_ring.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Reads of the latest sample tried before giving up on a stalled writer
+#define SHM_STREAM_LATEST_ATTEMPTS 64
+
+using namespace ati;
+
+static_assert(sizeof(ShmStreamHeader) <= SHM_STREAM_HEADER_SIZE, "ShmStreamHeader does not fit");
+
+// Object name given to shm_open, /dev/shm/ati_sensor.<name> on Linux
+static bool shmPath(const std::string& name, std::string& path)
+{
+  if (name.empty() || name.find('/') != std::string::npos)
+  {
+    std::cerr << "[shm_stream] Invalid stream name '" << name << "'" << std::endl;
+    return false;
+  }
+  path = "/ati_sensor." + name;
+  return true;
+}
+
+static bool validHeader(const ShmStreamHeader* h, size_t size)
+{
+  if (memcmp(h->magic, SHM_STREAM_MAGIC, sizeof(h->magic)) != 0)
+    return false;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return h->version == SHM_STREAM_VERSION && h->sample_size == sizeof(Sample)
+      && h->capacity > 0 && (h->capacity & (h->capacity - 1)) == 0
+      && size >= SHM_STREAM_HEADER_SIZE + h->capacity * sizeof(Sample);
+}
+
+ShmPublisher::ShmPublisher()
+: header_(NULL)
+, ring_(NULL)
+, map_size_(0)
+, mask_(0)
+{
+}
+
+ShmPublisher::~ShmPublisher()
+{
+  close();
+}
+
+bool ShmPublisher::open(const std::string& name, size_t capacity, uint32_t rate)
+{
+  std::string path;
+  if (isOpen() || !shmPath(name, path))
+    return false;
+  size_t size = 2 * CLAIMED_RING_CHUNK;
+  while (size < capacity)
+    size <<= 1;
+
+  // Tell the readers of a previous stream of that name that it is gone
+  int fd = shm_open(path.c_str(), O_RDWR, 0);
+  if (fd >= 0)
+  {
+    struct stat st;
+    void* old = (fstat(fd, &st) == 0 && st.st_size >= SHM_STREAM_HEADER_SIZE)
+              ? mmap(NULL, SHM_STREAM_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    if (old != MAP_FAILED)
+    {
+      ShmStreamHeader* h = static_cast<ShmStreamHeader*>(old);
+      if (memcmp(h->magic, SHM_STREAM_MAGIC, sizeof(h->magic)) == 0)
+        h->closed.store(1, std::memory_order_release);
+      munmap(old, SHM_STREAM_HEADER_SIZE);
+    }
+    ::close(fd);
+    shm_unlink(path.c_str());
+  }
+
+  fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+  {
+    std::cerr << "[shm_stream] Could not create " << path << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  map_size_ = SHM_STREAM_HEADER_SIZE + size * sizeof(Sample);
+  // A full /dev/shm fails here, instead of with SIGBUS in publish()
+  const int err = posix_fallocate(fd, 0, map_size_);
+  void* map = (err == 0) ? mmap(NULL, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (map == MAP_FAILED)
+  {
+    std::cerr << "[shm_stream] Could not map " << path << ": " << strerror(err ? err : errno) << std::endl;
+    shm_unlink(path.c_str());
+    return false;
+  }
+  // Fault the ring in here rather than on the first publications
+  memset(map, 0, map_size_);
+
+  header_ = static_cast<ShmStreamHeader*>(map);
+  ring_ = reinterpret_cast<Sample*>(static_cast<unsigned char*>(map) + SHM_STREAM_HEADER_SIZE);
+  mask_ = size - 1;
+  name_ = name;
+  header_->version = SHM_STREAM_VERSION;
+  header_->sample_size = sizeof(Sample);
+  header_->capacity = size;
+  header_->rate = rate;
+  header_->owner_pid = getpid();
+  // Readers only look at the rest once the magic is there
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(header_->magic, SHM_STREAM_MAGIC, sizeof(header_->magic));
+  return true;
+}
+
+void ShmPublisher::close()
+{
+  if (!header_)
+    return;
+  header_->closed.store(1, std::memory_order_release);
+  munmap(header_, map_size_);
+  std::string path;
+  if (shmPath(name_, path))
+    shm_unlink(path.c_str());
+  header_ = NULL;
+  ring_ = NULL;
+  name_.clear();
+}
+
+void ShmPublisher::publish(const Sample* samples, size_t n)
+{
+  if (!header_ || n == 0)
+    return;
+  Sample* const ring = ring_;
+  const uint64_t mask = mask_;
+  claimedRingWrite(header_->claimed, header_->head, n,
+                   [ring, mask, samples](uint64_t position, size_t i) {ring[position & mask] = samples[i];});
+
+  const uint32_t version = header_->latest_version.load(std::memory_order_relaxed);
+  header_->latest_version.store(version + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  header_->latest = samples[n - 1];
+  header_->latest_version.store(version + 2, std::memory_order_release);
+}
+
+ShmReader::ShmReader()
+: header_(NULL)
+, ring_(NULL)
+, map_size_(0)
+, mask_(0)
+, cursor_(0)
+, lost_(0)
+{
+}
+
+ShmReader::~ShmReader()
+{
+  detach();
+}
+
+bool ShmReader::attach(const std::string& name)
+{
+  std::string path;
+  if (isAttached() || !shmPath(name, path))
+    return false;
+  const int fd = shm_open(path.c_str(), O_RDONLY, 0);
+  if (fd < 0)
+  {
+    std::cerr << "[shm_stream] Could not open " << path << ": " << strerror(errno) << std::endl;
+    return false;
+  }
+  struct stat st;
+  void* map = (fstat(fd, &st) == 0 && st.st_size >= SHM_STREAM_HEADER_SIZE)
+            ? mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  ::close(fd);
+  if (map == MAP_FAILED)
+  {
+    std::cerr << "[shm_stream] Could not map " << path << std::endl;
+    return false;
+  }
+  const ShmStreamHeader* h = static_cast<const ShmStreamHeader*>(map);
+  if (!validHeader(h, st.st_size))
+  {
+    std::cerr << "[shm_stream] " << path << " is not a version " << SHM_STREAM_VERSION
+              << " stream of this build" << std::endl;
+    munmap(map, st.st_size);
+    return false;
+  }
+  header_ = h;
+  ring_ = reinterpret_cast<const Sample*>(static_cast<const unsigned char*>(map) + SHM_STREAM_HEADER_SIZE);
+  map_size_ = st.st_size;
+  mask_ = h->capacity - 1;
+  lost_ = 0;
+  skipToLatest();
+  return true;
+}
+
+void ShmReader::detach()
+{
+  if (!header_)
+    return;
+  munmap(const_cast<ShmStreamHeader*>(header_), map_size_);
+  header_ = NULL;
+  ring_ = NULL;
+}
+
+bool ShmReader::isLive() const
+{
+  if (!header_ || header_->closed.load(std::memory_order_acquire) != 0)
+    return false;
+  // An owner that crashed never sets closed
+  return kill(header_->owner_pid, 0) == 0 || errno != ESRCH;
+}
+
+bool ShmReader::latest(Sample& sample) const
+{
+  if (!header_ || header_->closed.load(std::memory_order_acquire) != 0)
+    return false;
+  // Bounded : an owner that died in the middle of a write leaves the version odd
+  for (unsigned int attempt = 0; attempt < SHM_STREAM_LATEST_ATTEMPTS; ++attempt)
+  {
+    const uint32_t version = header_->latest_version.load(std::memory_order_acquire);
+    if (version == 0)
+      return false;
+    if (version & 1)
+      continue;
+    sample = header_->latest;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header_->latest_version.load(std::memory_order_relaxed) == version)
+      return true;
+  }
+  return false;
+}
+
+size_t ShmReader::read(Sample* samples, size_t max)
+{
+  if (!header_)
+    return 0;
+  const uint64_t capacity = mask_ + 1;
+  const uint64_t head = header_->head.load(std::memory_order_acquire);
+  if (head - cursor_ > capacity)
+  {
+    lost_ += head - capacity - cursor_;
+    cursor_ = head - capacity;
+  }
+  size_t n = head - cursor_ < max ? head - cursor_ : max;
+  for (size_t i = 0; i < n; ++i)
+    samples[i] = ring_[(cursor_ + i) & mask_];
+
+  // The first copies may have been overwritten meanwhile
+  const uint64_t overwritten = claimedRingOverwritten(header_->claimed, cursor_, capacity);
+  if (overwritten > 0)
+  {
+    lost_ += overwritten;
+    if (overwritten >= n)
+    {
+      cursor_ += overwritten;
+      return 0;
+    }
+    memmove(samples, samples + overwritten, (n - overwritten) * sizeof(Sample));
+    cursor_ += n;
+    return n - overwritten;
+  }
+  cursor_ += n;
+  return n;
+}
+
+void ShmReader::skipToLatest()
+{
+  if (header_)
+    cursor_ = header_->head.load(std::memory_order_acquire);
+}
+
+uint64_t ShmReader::pending() const
+{
+  return header_ ? header_->head.load(std::memory_order_acquire) - cursor_ : 0;
+}
@@ -0,0 +1,152 @@
+#include "ati_sensor/wrench_transform.h"
+#include "ati_sensor/ft_sensor.h"
+#include <string.h>
+
+using namespace ati;
+
+WrenchTransform::WrenchTransform()
+{
+  const double identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  const double zero[3] = {0, 0, 0};
+  *this = WrenchTransform(identity, zero);
+}
+
+WrenchTransform::WrenchTransform(const double rotation[9], const double translation[3])
+{
+  memcpy(r_, rotation, sizeof(r_));
+  memcpy(t_, translation, sizeof(t_));
+  // [t]x R, column by column : t x (column j of R)
+  for (int j = 0; j < 3; ++j)
+  {
+    const double c0 = r_[j], c1 = r_[3 + j], c2 = r_[6 + j];
+    tr_[j]     = t_[1] * c2 - t_[2] * c1;
+    tr_[3 + j] = t_[2] * c0 - t_[0] * c2;
+    tr_[6 + j] = t_[0] * c1 - t_[1] * c0;
+  }
+}
+
+WrenchTransform WrenchTransform::fromQuaternion(double qx, double qy, double qz, double qw,
+                                                double tx, double ty, double tz)
+{
+  const double r[9] = {
+    1 - 2 * (qy * qy + qz * qz), 2 * (qx * qy - qz * qw),     2 * (qx * qz + qy * qw),
+    2 * (qx * qy + qz * qw),     1 - 2 * (qx * qx + qz * qz), 2 * (qy * qz - qx * qw),
+    2 * (qx * qz - qy * qw),     2 * (qy * qz + qx * qw),     1 - 2 * (qx * qx + qy * qy)
+  };
+  const double t[3] = {tx, ty, tz};
+  return WrenchTransform(r, t);
+}
+
+WrenchTransform WrenchTransform::then(const WrenchTransform& other) const
+{
+  // Poses compose as R = R2 R1, t = R2 t1 + t2
+  double r[9], t[3];
+  for (int i = 0; i < 3; ++i)
+  {
+    for (int j = 0; j < 3; ++j)
+      r[i * 3 + j] = other.r_[i * 3] * r_[j] + other.r_[i * 3 + 1] * r_[3 + j] + other.r_[i * 3 + 2] * r_[6 + j];
+    t[i] = other.r_[i * 3] * t_[0] + other.r_[i * 3 + 1] * t_[1] + other.r_[i * 3 + 2] * t_[2] + other.t_[i];
+  }
+  return WrenchTransform(r, t);
+}
+
+WrenchTransform WrenchTransform::inverse() const
+{
+  // R^T, -R^T t
+  double r[9], t[3];
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j)
+      r[i * 3 + j] = r_[j * 3 + i];
+  for (int i = 0; i < 3; ++i)
+    t[i] = -(r[i * 3] * t_[0] + r[i * 3 + 1] * t_[1] + r[i * 3 + 2] * t_[2]);
+  return WrenchTransform(r, t);
+}
+
+// The 27 multiply-adds of the non zero blocks
+static inline void transformWrench(const double* r, const double* tr, const double* in, double* out)
+{
+  const double f0 = in[0], f1 = in[1], f2 = in[2];
+  const double m0 = in[3], m1 = in[4], m2 = in[5];
+  for (int i = 0; i < 3; ++i)
+  {
+    out[i] = r[i * 3] * f0 + r[i * 3 + 1] * f1 + r[i * 3 + 2] * f2;
+    out[3 + i] = r[i * 3] * m0 + r[i * 3 + 1] * m1 + r[i * 3 + 2] * m2
+               + tr[i * 3] * f0 + tr[i * 3 + 1] * f1 + tr[i * 3 + 2] * f2;
+  }
+}
+
+void WrenchTransform::apply(const double in[6], double out[6]) const
+{
+  double result[6];
+  transformWrench(r_, tr_, in, result);
+  memcpy(out, result, sizeof(result));
+}
+
+void WrenchTransform::apply(const Sample* in, size_t n, Sample* out) const
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    double result[6];
+    transformWrench(r_, tr_, in[i].ft, result);
+    out[i].timestamp = in[i].timestamp;
+    out[i].rdt_sequence = in[i].rdt_sequence;
+    out[i].ft_sequence = in[i].ft_sequence;
+    out[i].status = in[i].status;
+    memcpy(out[i].ft, result, sizeof(result));
+  }
+}
+
+void WrenchTransform::matrix(double m[36]) const
+{
+  memset(m, 0, 36 * sizeof(double));
+  for (int i = 0; i < 3; ++i)
+    for (int j = 0; j < 3; ++j)
+    {
+      m[i * 6 + j] = r_[i * 3 + j];
+      m[(i + 3) * 6 + j] = tr_[i * 3 + j];
+      m[(i + 3) * 6 + j + 3] = r_[i * 3 + j];
+    }
+}
+
+size_t WrenchFrames::add(const std::string& name, const WrenchTransform& transform)
+{
+  const int existing = find(name);
+  if (existing >= 0)
+  {
+    transforms_[existing] = transform;
+    return existing;
+  }
+  names_.push_back(name);
+  transforms_.push_back(transform);
+  return transforms_.size() - 1;
+}
+
+void WrenchFrames::clear()
+{
+  names_.clear();
+  transforms_.clear();
+}
+
+int WrenchFrames::find(const std::string& name) const
+{
+  for (size_t k = 0; k < names_.size(); ++k)
+    if (names_[k] == name)
+      return static_cast<int>(k);
+  return -1;
+}
+
+void WrenchFrames::apply(const Sample* in, size_t n, Sample* const out[], size_t at) const
+{
+  const size_t frames = transforms_.size();
+  for (size_t i = 0; i < n; ++i)
+  {
+    // Loaded once, written in every frame
+    const Sample s = in[i];
+    for (size_t k = 0; k < frames; ++k)
+    {
+      Sample& o = out[k][at + i];
+      o = s;
+      transformWrench(transforms_[k].r_, transforms_[k].tr_, s.ft, o.ft);
+    }
+  }
+}
@@ -0,0 +1,178 @@
+// Publishing the stream of a loopback Net F/T simulator : a loop reading one
+// sample at a fixed rate, the next queued one (what the ROS node did at
+// 100 Hz) or the newest, against FTSensor::setSampleCallback(), called on
+// the receive thread as datagrams arrive. Measures the share of the samples delivered and their age when
+// delivered. Results are written as one JSON object per case and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ft_simulator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+static const uint16_t RDT_PORT = 49700;
+static const uint16_t HTTP_PORT = 8700;
+
+struct Delivery
+{
+  vector<double> ages_us;
+  uint32_t last_sequence;
+  Delivery() : last_sequence(0) {}
+  void add(const ati::Sample& sample, uint64_t now)
+  {
+    last_sequence = sample.rdt_sequence;
+    ages_us.push_back((now - sample.timestamp) * 1e-3);
+  }
+};
+
+static void printCase(const char* name, double rate, double sent, Delivery& delivery)
+{
+  vector<double>& ages = delivery.ages_us;
+  if (ages.empty())
+  {
+    cout << "{\"case\":\"" << name << "\",\"delivered\":0}" << endl;
+    return;
+  }
+  sort(ages.begin(), ages.end());
+  double mean = 0;
+  for (size_t i = 0; i < ages.size(); ++i)
+    mean += ages[i];
+  mean /= ages.size();
+  cout << fixed << setprecision(1)
+       << "{\"case\":\"" << name << "\""
+       << ",\"rate_hz\":" << rate
+       << ",\"delivered\":" << ages.size()
+       << ",\"delivered_share\":" << setprecision(4) << ages.size() / sent << setprecision(1)
+       << ",\"age_mean_us\":" << mean
+       << ",\"age_p99_us\":" << percentile(ages, 0.99)
+       << ",\"age_max_us\":" << ages.back()
+       << "}" << endl;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --rate HZ          RDT rate of the simulator (default 7000)\n"
+       << "  --poll-rate HZ     rate of the polling loop (default 100)\n"
+       << "  --duration SEC     length of each case (default 3)\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int rate = 7000;
+  double poll_rate = 100;
+  double duration = 3;
+
+  static struct option options[] = {
+    {"rate", required_argument, 0, 'r'},
+    {"poll-rate", required_argument, 0, 'p'},
+    {"duration", required_argument, 0, 'd'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'r': rate = atoi(optarg); break;
+      case 'p': poll_rate = atof(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (poll_rate <= 0 || duration <= 0)
+  {
+    usage(argv[0]);
+    return -1;
+  }
+
+  ati::SimulatorConfig config;
+  config.rdt_port = RDT_PORT;
+  config.http_port = HTTP_PORT;
+  config.rdt_rate = rate;
+  const pid_t simulator = ati::startSimulatorProcess(config);
+  if (simulator < 0)
+    return -1;
+
+  int ret = 0;
+  for (int newest = 0; newest <= 1; ++newest)
+  {
+    // One sample at each tick of a fixed rate loop
+    ati::FTSensor sensor;
+    sensor.setPort(RDT_PORT);
+    sensor.setHTTPPort(HTTP_PORT);
+    if (!sensor.init("127.0.0.1") || !sensor.startReceiveThread(newest ? ati::FTSensor::READ_NEWEST : ati::FTSensor::READ_NEXT))
+    {
+      cerr << "Could not start the sensor" << endl;
+      ret = -1;
+      continue;
+    }
+    Delivery delivery;
+    const useconds_t period = static_cast<useconds_t>(1e6 / poll_rate);
+    const uint64_t end = realtimeNow() + static_cast<uint64_t>(duration * 1e9);
+    while (realtimeNow() < end)
+    {
+      ati::Sample sample;
+      bool read = false;
+      if (newest)
+      {
+        double ft[6];
+        uint32_t rdt_sequence;
+        sensor.getMeasurements(ft, rdt_sequence);
+        sample = sensor.getLastSample();
+        // Nothing received yet, or the same sample as the previous tick
+        read = sample.timestamp != 0 && (delivery.ages_us.empty() || sample.rdt_sequence != delivery.last_sequence);
+      }
+      else
+        read = sensor.readBatch(&sample, 1) == 1;
+      if (read)
+        delivery.add(sample, realtimeNow());
+      usleep(period);
+    }
+    printCase(newest ? "poll_newest" : "poll_next", poll_rate, duration * rate, delivery);
+  }
+  {
+    // Every sample, from the receive thread
+    ati::FTSensor sensor;
+    sensor.setPort(RDT_PORT);
+    sensor.setHTTPPort(HTTP_PORT);
+    Delivery delivery;
+    atomic<bool> recording(true);
+    delivery.ages_us.reserve(static_cast<size_t>(duration * rate * 2));
+    sensor.setSampleCallback([&](const ati::Sample* samples, size_t n)
+    {
+      if (!recording.load(memory_order_relaxed))
+        return;
+      const uint64_t now = realtimeNow();
+      for (size_t i = 0; i < n; ++i)
+        delivery.add(samples[i], now);
+    });
+    if (!sensor.init("127.0.0.1") || !sensor.startReceiveThread(ati::FTSensor::READ_NEWEST, 16))
+    {
+      cerr << "Could not start the sensor" << endl;
+      ret = -1;
+    }
+    else
+    {
+      usleep(static_cast<useconds_t>(duration * 1e6));
+      recording = false;
+      sensor.stopReceiveThread();
+      printCase("callback", sensor.getRDTRate(), duration * rate, delivery);
+      if (delivery.ages_us.empty())
+        ret = -1;
+    }
+  }
+  ati::stopSimulatorProcess(simulator);
+  return ret;
+}
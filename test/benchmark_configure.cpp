@@ -0,0 +1,154 @@
+// Time to reconfigure a fleet of sensors through their web servers : one
+// request per setting against FTSensor::configure(), with simulators that
+// close the connection after each response like the Net F/T, then with
+// simulators that keep it alive. Results are written as one JSON object
+// per case and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ft_simulator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+static const uint16_t BASE_RDT_PORT = 49400;
+static const uint16_t BASE_HTTP_PORT = 8400;
+
+enum configure_mode_t
+{
+  INDIVIDUAL,   // setGaugeBias() per gauge, then setRDTOutputRate()
+  CONFIGURE     // all of it and the calibration in one configure()
+};
+
+static const char* mode_names[] = {"individual", "configure"};
+
+static pid_t startSimulators(size_t count, bool keep_alive)
+{
+  vector<ati::SimulatorConfig> configs(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    configs[i].rdt_port = BASE_RDT_PORT + i;
+    configs[i].http_port = BASE_HTTP_PORT + i;
+    configs[i].http_keep_alive = keep_alive;
+  }
+  return ati::startSimulatorProcess(configs);
+}
+
+static bool run(configure_mode_t mode, bool keep_alive, vector<ati::FTSensor*>& sensors, unsigned int rounds)
+{
+  bool ok = true;
+  const double t0 = monotonicNow();
+  for (unsigned int r = 0; r < rounds; ++r)
+  {
+    for (size_t i = 0; i < sensors.size(); ++i)
+    {
+      ati::FTSensor& sensor = *sensors[i];
+      if (mode == INDIVIDUAL)
+      {
+        for (unsigned int g = 0; g < 6; ++g)
+          ok &= sensor.setGaugeBias(g, static_cast<int>(r * 10 + g));
+        ok &= sensor.setRDTOutputRate(1000 + r);
+      }
+      else
+      {
+        ati::SettingsUpdate update;
+        for (unsigned int g = 0; g < 6; ++g)
+          update.gauge_bias[g] = static_cast<int>(r * 10 + g);
+        update.rdt_rate = 1000 + r;
+        update.rdt_buffer_size = 10;
+        update.calibration_index = 0;
+        ok &= sensor.configure(update);
+      }
+    }
+  }
+  const double elapsed = monotonicNow() - t0;
+
+  // The web servers hold the last values
+  for (size_t i = 0; i < sensors.size(); ++i)
+  {
+    const vector<int> bias = sensors[i]->getGaugeBias();
+    ok &= (bias.size() == 6 && bias[5] == static_cast<int>((rounds - 1) * 10 + 5));
+    ok &= (sensors[i]->getRDTRate() == static_cast<int>(1000 + rounds - 1));
+  }
+
+  cout << fixed << setprecision(3)
+       << "{\"mode\":\"" << mode_names[mode] << "\""
+       << ",\"server\":\"" << (keep_alive ? "keep_alive" : "close") << "\""
+       << ",\"sensors\":" << sensors.size()
+       << ",\"rounds\":" << rounds
+       << ",\"ms_per_sensor\":" << elapsed * 1e3 / (rounds * sensors.size())
+       << ",\"fleet_ms\":" << elapsed * 1e3 / rounds
+       << ",\"correct\":" << (ok ? "true" : "false")
+       << "}" << endl;
+  return ok;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --sensors N        number of simulated sensors (default 16)\n"
+       << "  --rounds N         reconfigurations of the fleet per case (default 20)\n";
+}
+
+int main(int argc, char **argv)
+{
+  size_t count = 16;
+  unsigned int rounds = 20;
+
+  static struct option options[] = {
+    {"sensors", required_argument, 0, 'n'},
+    {"rounds", required_argument, 0, 'r'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'n': count = atoi(optarg); break;
+      case 'r': rounds = atoi(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (rounds == 0)
+    rounds = 1;
+
+  int ret = 0;
+  for (int keep_alive = 0; keep_alive <= 1; ++keep_alive)
+  {
+    const pid_t simulator = startSimulators(count, keep_alive);
+    if (simulator < 0)
+      return -1;
+    vector<ati::FTSensor*> sensors;
+    for (size_t i = 0; i < count; ++i)
+    {
+      ati::FTSensor* sensor = new ati::FTSensor();
+      sensor->setPort(BASE_RDT_PORT + i);
+      sensor->setHTTPPort(BASE_HTTP_PORT + i);
+      if (!sensor->init("127.0.0.1"))
+      {
+        cerr << "Could not init sensor " << i << endl;
+        delete sensor;
+        continue;
+      }
+      sensors.push_back(sensor);
+    }
+
+    for (int mode = INDIVIDUAL; mode <= CONFIGURE; ++mode)
+      if (!run(static_cast<configure_mode_t>(mode), keep_alive, sensors, rounds))
+        ret = -1;
+
+    for (size_t i = 0; i < sensors.size(); ++i)
+      delete sensors[i];
+    ati::stopSimulatorProcess(simulator);
+  }
+  return ret;
+}
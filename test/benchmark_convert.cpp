@@ -0,0 +1,110 @@
+// Micro-benchmark of the record conversion : the historical per-field
+// ntohl() + per-axis division path against the batch conversion kernels.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <time.h>
+#include <arpa/inet.h>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/ft_convert.h"
+
+using namespace std;
+
+typedef void (*convert_fn)(const unsigned char*, size_t, uint64_t, double, double, ati::Sample*);
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// What getResponse() + getMeasurements() used to do for every record
+static void convertLegacy(const unsigned char* records, size_t n, uint64_t timestamp,
+                          double cpf, double cpt, ati::Sample* samples)
+{
+  for (size_t r = 0; r < n; ++r)
+  {
+    const unsigned char* record = records + r * RDT_RECORD_SIZE;
+    ati::response_s resp;
+    resp.rdt_sequence = ntohl(*reinterpret_cast<const uint32_t*>(&record[0]));
+    resp.ft_sequence = ntohl(*reinterpret_cast<const uint32_t*>(&record[4]));
+    resp.status = ntohl(*reinterpret_cast<const uint32_t*>(&record[8]));
+    resp.Fx = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[12 + 0 * 4])));
+    resp.Fy = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[12 + 1 * 4])));
+    resp.Fz = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[12 + 2 * 4])));
+    resp.Tx = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[12 + 3 * 4])));
+    resp.Ty = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[12 + 4 * 4])));
+    resp.Tz = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[12 + 5 * 4])));
+    samples[r].timestamp = timestamp;
+    samples[r].rdt_sequence = resp.rdt_sequence;
+    samples[r].ft_sequence = resp.ft_sequence;
+    samples[r].status = resp.status;
+    samples[r].ft[0] = static_cast<double>(resp.Fx) / cpf;
+    samples[r].ft[1] = static_cast<double>(resp.Fy) / cpf;
+    samples[r].ft[2] = static_cast<double>(resp.Fz) / cpf;
+    samples[r].ft[3] = static_cast<double>(resp.Tx) / cpt;
+    samples[r].ft[4] = static_cast<double>(resp.Ty) / cpt;
+    samples[r].ft[5] = static_cast<double>(resp.Tz) / cpt;
+  }
+}
+
+static void legacyAdapter(const unsigned char* records, size_t n, uint64_t timestamp,
+                          double force_scale, double torque_scale, ati::Sample* samples)
+{
+  convertLegacy(records, n, timestamp, 1.0 / force_scale, 1.0 / torque_scale, samples);
+}
+
+int main(int argc, char **argv)
+{
+  size_t n = 4096;
+  double duration = 0.5;
+  if (argc > 1)
+    n = atoi(argv[1]);
+  if (argc > 2)
+    duration = atof(argv[2]);
+
+  const double cpf = 1000000, cpt = 1000000;
+  std::vector<unsigned char> records(n * RDT_RECORD_SIZE);
+  srand(42);
+  for (size_t i = 0; i < n * RDT_RECORD_SIZE / 4; ++i)
+    *reinterpret_cast<uint32_t*>(&records[i * 4]) = htonl(static_cast<uint32_t>(rand() - RAND_MAX / 2));
+
+  std::vector<ati::Sample> reference(n), samples(n);
+  convertLegacy(&records[0], n, 0, cpf, cpt, &reference[0]);
+
+  const char* names[] = {"legacy", "scalar", "sse2", "avx2", "dispatch"};
+  convert_fn fns[] = {&legacyAdapter, &ati::convertRecordsScalar, &ati::convertRecordsSSE2,
+                      &ati::convertRecordsAVX2, &ati::convertRecords};
+
+  cout << "Batches of " << n << " records, dispatch uses " << ati::convertRecordsImplementation() << endl;
+  cout << "     impl      Mrecords/s   max error" << endl;
+  for (int f = 0; f < 5; ++f)
+  {
+    size_t iterations = 0;
+    const double t0 = now();
+    double t = t0;
+    while (t - t0 < duration)
+    {
+      fns[f](&records[0], n, 0, 1.0 / cpf, 1.0 / cpt, &samples[0]);
+      ++iterations;
+      t = now();
+    }
+    double error = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+      if (samples[i].rdt_sequence != reference[i].rdt_sequence || samples[i].status != reference[i].status)
+        error = INFINITY;
+      for (int j = 0; j < 6; ++j)
+        error = fmax(error, fabs(samples[i].ft[j] - reference[i].ft[j]));
+    }
+    cout << setw(9) << names[f] << "  " << setw(12) << fixed << setprecision(2)
+         << iterations * n / (t - t0) * 1e-6 << "  " << setw(10) << scientific << setprecision(2) << error << endl;
+  }
+  return 0;
+}
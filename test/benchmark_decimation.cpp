@@ -0,0 +1,148 @@
+// Rate reduction of the RDT stream for slow consumers : keeping the sample
+// that happens to be the newest at each read (what a fixed rate polling loop
+// does) against FTDecimator. Measures the residue of a vibration that
+// aliases into the output band, the gain of an in-band tone, and the cost
+// per input sample. Results are written as one JSON object per case and per
+// line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/ft_decimator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+// Amplitude of frequency in the output, by correlation over whole seconds
+static double amplitude(const vector<double>& out, double rate, double frequency)
+{
+  double c = 0, s = 0;
+  const size_t skip = out.size() / 4;
+  for (size_t i = skip; i < out.size(); ++i)
+  {
+    c += out[i] * cos(2 * M_PI * frequency * i / rate);
+    s += out[i] * sin(2 * M_PI * frequency * i / rate);
+  }
+  return 2 * sqrt(c * c + s * s) / (out.size() - skip);
+}
+
+// Output (Fz) of a sine at frequency sampled at rdt_rate, one in factor kept
+static void decimate(bool filtered, unsigned int factor, unsigned int taps_per_phase, double rdt_rate,
+                     double frequency, double duration, vector<double>& out, double& elapsed)
+{
+  ati::FTDecimator decimator;
+  decimator.setFactor(filtered ? factor : 1, taps_per_phase);
+  const size_t n = static_cast<size_t>(duration * rdt_rate);
+  vector<ati::Sample> in(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (int j = 0; j < 6; ++j)
+      in[i].ft[j] = 0;
+    in[i].ft[2] = sin(2 * M_PI * frequency * i / rdt_rate);
+  }
+  vector<ati::Sample> decimated(n);
+
+  const double t0 = monotonicNow();
+  size_t count = 0;
+  if (filtered)
+  {
+    // By datagram sized batches, as on the receive thread
+    for (size_t i = 0; i < n; i += RDT_MAX_RECORDS)
+      count += decimator.process(&in[i], min<size_t>(RDT_MAX_RECORDS, n - i), &decimated[count]);
+  }
+  else
+  {
+    for (size_t i = factor - 1; i < n; i += factor)
+      decimated[count++] = in[i];
+  }
+  elapsed = (monotonicNow() - t0) / n;
+
+  out.resize(count);
+  for (size_t i = 0; i < count; ++i)
+    out[i] = decimated[i].ft[2];
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --rate HZ          RDT rate (default 7000)\n"
+       << "  --output-rate HZ   consumer rate, rounded to an integer fraction (default 100)\n"
+       << "  --taps N           taps per phase (default 16)\n"
+       << "  --duration SEC     stream length (default 20)\n";
+}
+
+int main(int argc, char **argv)
+{
+  double rate = 7000;
+  double output_rate = 100;
+  unsigned int taps_per_phase = 16;
+  double duration = 20;
+
+  static struct option options[] = {
+    {"rate", required_argument, 0, 'r'},
+    {"output-rate", required_argument, 0, 'o'},
+    {"taps", required_argument, 0, 't'},
+    {"duration", required_argument, 0, 'd'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'r': rate = atof(optarg); break;
+      case 'o': output_rate = atof(optarg); break;
+      case 't': taps_per_phase = atoi(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  const unsigned int factor = static_cast<unsigned int>(rate / output_rate + 0.5);
+  if (factor < 2 || duration <= 0)
+  {
+    cerr << "The output rate must be at most half the RDT rate" << endl;
+    return -1;
+  }
+  output_rate = rate / factor;
+
+  // In band, and one output rate above it, where it aliases back
+  const double tone = output_rate / 10;
+  const double vibration = output_rate + output_rate / 20;
+  const double alias = output_rate / 20;
+
+  bool ok = true;
+  for (int filtered = 0; filtered <= 1; ++filtered)
+  {
+    vector<double> out;
+    double tone_cost, vibration_cost;
+    decimate(filtered, factor, taps_per_phase, rate, tone, duration, out, tone_cost);
+    const double tone_gain = amplitude(out, output_rate, tone);
+    decimate(filtered, factor, taps_per_phase, rate, vibration, duration, out, vibration_cost);
+    const double alias_gain = amplitude(out, output_rate, alias);
+    if (filtered)
+      ok &= fabs(tone_gain - 1) < 0.01 && alias_gain < 1e-3;
+
+    ati::FTDecimator decimator;
+    decimator.setFactor(filtered ? factor : 1, taps_per_phase);
+    cout << fixed << setprecision(4)
+         << "{\"decimation\":\"" << (filtered ? "fir" : "newest_sample") << "\""
+         << ",\"rdt_rate_hz\":" << rate
+         << ",\"output_rate_hz\":" << output_rate
+         << ",\"taps\":" << decimator.taps()
+         << ",\"delay_ms\":" << decimator.delay() / rate * 1e3
+         << ",\"tone_hz\":" << tone
+         << ",\"tone_gain\":" << tone_gain
+         << ",\"vibration_hz\":" << vibration
+         << ",\"aliased_gain\":" << alias_gain
+         << ",\"ns_per_input_sample\":" << (tone_cost + vibration_cost) / 2 * 1e9
+         << "}" << endl;
+  }
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,208 @@
+// Cost and effect of FTFilter : time per sample of a few cascades on the six
+// axes, and what filtering at the RDT rate on the receive thread gives over
+// a consumer reading the newest sample at its own rate and filtering that :
+// delay of a force step and residue of a vibration above the consumer rate.
+// Results are written as one JSON object per case and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/ft_filter.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+static bool throughput(const char* name, ati::FTFilter filter, double rate, unsigned int iterations)
+{
+  filter.setSampleRate(rate);
+  // A datagram worth of noisy samples, filtered over and over
+  ati::Sample samples[RDT_MAX_RECORDS];
+  for (size_t i = 0; i < RDT_MAX_RECORDS; ++i)
+    for (int j = 0; j < 6; ++j)
+      samples[i].ft[j] = 10.0 * j + (rand() % 1000) * 1e-3;
+
+  const double t0 = monotonicNow();
+  for (unsigned int i = 0; i < iterations; ++i)
+  {
+    filter.process(samples, RDT_MAX_RECORDS);
+    // Keep the state from settling to constants
+    samples[i % RDT_MAX_RECORDS].ft[i % 6] += 1.0;
+  }
+  const double elapsed = monotonicNow() - t0;
+
+  // Passes a constant through, removes the cutoff band as designed
+  bool ok = fabs(filter.magnitude(0) - 1) < 1e-9 || filter.magnitude(0) < 1e-9;
+  for (int j = 0; j < 6; ++j)
+    ok &= isfinite(samples[0].ft[j]);
+
+  cout << fixed << setprecision(1)
+       << "{\"case\":\"throughput\""
+       << ",\"filter\":\"" << name << "\""
+       << ",\"sections\":" << filter.sections()
+       << ",\"ns_per_sample\":" << elapsed * 1e9 / (static_cast<double>(iterations) * RDT_MAX_RECORDS)
+       << ",\"max_rate_khz\":" << iterations * RDT_MAX_RECORDS / elapsed * 1e-3
+       << ",\"correct\":" << (ok ? "true" : "false")
+       << "}" << endl;
+  return ok;
+}
+
+// Time (s) where out crosses level between samples, times of samples in t
+static double crossing(const vector<double>& t, const vector<double>& out, double level)
+{
+  for (size_t i = 1; i < out.size(); ++i)
+    if (out[i - 1] < level && out[i] >= level)
+      return t[i - 1] + (t[i] - t[i - 1]) * (level - out[i - 1]) / (out[i] - out[i - 1]);
+  return NAN;
+}
+
+// Filters the signal either at the RDT rate, or after keeping the newest
+// sample at each consumer read. Returns the output at the consumer reads.
+template<typename Signal>
+static void run(const Signal& signal, bool on_receive_thread, double rdt_rate, double consumer_rate,
+                double cutoff, double phase, double duration, vector<double>& t, vector<double>& out)
+{
+  ati::FTFilter filter;
+  filter.addLowPass(cutoff, 2);
+  filter.setSampleRate(on_receive_thread ? rdt_rate : consumer_rate);
+
+  t.clear();
+  out.clear();
+  double ft[6] = {0, 0, 0, 0, 0, 0};
+  long k = 0;
+  for (double read = phase; read < duration; read += 1 / consumer_rate)
+  {
+    // Samples received up to this read
+    for (; k / rdt_rate <= read; ++k)
+    {
+      ft[2] = signal(k / rdt_rate);
+      if (on_receive_thread)
+        filter.process(ft);
+    }
+    double newest[6];
+    for (int j = 0; j < 6; ++j)
+      newest[j] = ft[j];
+    if (!on_receive_thread)
+      filter.process(newest);
+    t.push_back(read);
+    out.push_back(newest[2]);
+  }
+}
+
+struct Step
+{
+  double at;
+  double operator()(double t) const {return t >= at ? 1.0 : 0.0;}
+};
+
+struct Vibration
+{
+  double frequency;
+  double operator()(double t) const {return sin(2 * M_PI * frequency * t);}
+};
+
+static void compare(double rdt_rate, double consumer_rate, double cutoff, double vibration, unsigned int trials)
+{
+  for (int on_receive_thread = 1; on_receive_thread >= 0; --on_receive_thread)
+  {
+    // Step delay to half height, averaged over the position of the step
+    // between samples and reads
+    double delay = 0;
+    vector<double> t, out;
+    for (unsigned int i = 0; i < trials; ++i)
+    {
+      Step step = {0.1 + static_cast<double>(i) / trials / consumer_rate};
+      run(step, on_receive_thread, rdt_rate, consumer_rate, cutoff, 0, 0.3, t, out);
+      delay += crossing(t, out, 0.5) - step.at;
+    }
+    delay /= trials;
+
+    // A vibration the consumer rate aliases into the pass band
+    Vibration vib = {vibration};
+    run(vib, on_receive_thread, rdt_rate, consumer_rate, cutoff, 0, 2.0, t, out);
+    double rms = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < out.size(); ++i)
+      if (t[i] > 1.0)
+      {
+        rms += out[i] * out[i];
+        ++count;
+      }
+    rms = sqrt(rms / count);
+
+    cout << fixed << setprecision(3)
+         << "{\"case\":\"stream\""
+         << ",\"filtered_at\":\"" << (on_receive_thread ? "receive_thread" : "consumer") << "\""
+         << ",\"filter_rate_hz\":" << (on_receive_thread ? rdt_rate : consumer_rate)
+         << ",\"consumer_rate_hz\":" << consumer_rate
+         << ",\"cutoff_hz\":" << cutoff
+         << ",\"step_delay_ms\":" << delay * 1e3
+         << ",\"vibration_hz\":" << vibration
+         << ",\"vibration_rms\":" << rms
+         << "}" << endl;
+  }
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --iterations N     datagrams of 40 samples filtered per cascade (default 200000)\n"
+       << "  --rate HZ          RDT rate (default 7000)\n"
+       << "  --consumer-rate HZ rate at which the consumer reads (default 1000)\n"
+       << "  --cutoff HZ        low pass cutoff (default 50)\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int iterations = 200000;
+  double rate = 7000;
+  double consumer_rate = 1000;
+  double cutoff = 50;
+
+  static struct option options[] = {
+    {"iterations", required_argument, 0, 'n'},
+    {"rate", required_argument, 0, 'r'},
+    {"consumer-rate", required_argument, 0, 'c'},
+    {"cutoff", required_argument, 0, 'f'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'n': iterations = atoi(optarg); break;
+      case 'r': rate = atof(optarg); break;
+      case 'c': consumer_rate = atof(optarg); break;
+      case 'f': cutoff = atof(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (iterations == 0)
+    iterations = 1;
+  if (!(cutoff < consumer_rate / 2) || !(consumer_rate < rate))
+  {
+    cerr << "The cutoff must be below half the consumer rate, itself below the RDT rate" << endl;
+    return -1;
+  }
+
+  bool ok = true;
+  ati::FTFilter lp2, lp4, lp4_notch;
+  lp2.addLowPass(cutoff, 2);
+  lp4.addLowPass(cutoff, 4);
+  lp4_notch.addLowPass(cutoff, 4);
+  lp4_notch.addNotch(cutoff / 2, 5);
+  ok &= throughput("low_pass_2", lp2, rate, iterations);
+  ok &= throughput("low_pass_4", lp4, rate, iterations);
+  ok &= throughput("low_pass_4+notch", lp4_notch, rate, iterations);
+
+  // Aliased 20 Hz above the consumer rate
+  compare(rate, consumer_rate, cutoff, consumer_rate + 20, 100);
+  return ok ? 0 : -1;
+}
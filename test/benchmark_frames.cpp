@@ -0,0 +1,170 @@
+// Cost of expressing the samples in several frames attached to the sensor :
+// every consumer multiplying its own copy by a full 6x6 matrix, against one
+// WrenchFrames pass writing all the frames. Also checks the transforms
+// against the 6x6 adjoint and a lever arm computed by hand. Results are
+// written as one JSON object per case and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/wrench_transform.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+// What each controller did on its own copy
+static void perConsumer(const double m[36], const ati::Sample* in, size_t n, ati::Sample* out)
+{
+  for (size_t i = 0; i < n; ++i)
+  {
+    out[i] = in[i];
+    for (int r = 0; r < 6; ++r)
+    {
+      double v = 0;
+      for (int c = 0; c < 6; ++c)
+        v += m[r * 6 + c] * in[i].ft[c];
+      out[i].ft[r] = v;
+    }
+  }
+}
+
+// Tools at various poses
+static ati::WrenchTransform tool(unsigned int k)
+{
+  const double angle = 0.3 + 0.7 * k;
+  const double axis[3] = {1 / sqrt(3.0), 1 / sqrt(3.0), 1 / sqrt(3.0)};
+  return ati::WrenchTransform::fromQuaternion(axis[0] * sin(angle / 2), axis[1] * sin(angle / 2), axis[2] * sin(angle / 2),
+                                              cos(angle / 2), 0.01 * k, -0.02, 0.15 + 0.05 * k);
+}
+
+static bool checks()
+{
+  bool ok = true;
+  // A force along x, 10 cm under the tool origin : a torque about y
+  const double identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  const double below[3] = {0, 0, -0.1};
+  const ati::WrenchTransform lever(identity, below);
+  const double fx[6] = {1, 0, 0, 0, 0, 0};
+  double w[6];
+  lever.apply(fx, w);
+  ok &= fabs(w[0] - 1) < 1e-12 && fabs(w[4] + 0.1) < 1e-12;
+
+  // Against the full matrix, and back through the inverse
+  const ati::WrenchTransform t = tool(1);
+  double m[36];
+  t.matrix(m);
+  const double in[6] = {1.5, -2.0, 9.81, 0.3, -0.1, 0.05};
+  double out[6], back[6];
+  t.apply(in, out);
+  for (int r = 0; r < 6; ++r)
+  {
+    double v = 0;
+    for (int c = 0; c < 6; ++c)
+      v += m[r * 6 + c] * in[c];
+    ok &= fabs(v - out[r]) < 1e-12;
+  }
+  t.inverse().apply(out, back);
+  for (int j = 0; j < 6; ++j)
+    ok &= fabs(back[j] - in[j]) < 1e-12;
+
+  // Composition is applying one after the other
+  const ati::WrenchTransform u = tool(2);
+  double twice[6], composed[6];
+  u.apply(out, twice);
+  t.then(u).apply(in, composed);
+  for (int j = 0; j < 6; ++j)
+    ok &= fabs(twice[j] - composed[j]) < 1e-12;
+  return ok;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --iterations N     datagrams of 40 samples transformed per case (default 200000)\n"
+       << "  --frames N         largest number of output frames (default 4)\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int iterations = 200000;
+  unsigned int max_frames = 4;
+
+  static struct option options[] = {
+    {"iterations", required_argument, 0, 'n'},
+    {"frames", required_argument, 0, 'f'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'n': iterations = atoi(optarg); break;
+      case 'f': max_frames = atoi(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (iterations == 0)
+    iterations = 1;
+  if (max_frames == 0)
+    max_frames = 1;
+
+  const bool ok = checks();
+  cout << "{\"case\":\"checks\",\"correct\":" << (ok ? "true" : "false") << "}" << endl;
+
+  ati::Sample in[RDT_MAX_RECORDS];
+  for (size_t i = 0; i < RDT_MAX_RECORDS; ++i)
+    for (int j = 0; j < 6; ++j)
+      in[i].ft[j] = (rand() % 2000 - 1000) * 1e-2;
+
+  for (unsigned int frames = 1; frames <= max_frames; frames *= 2)
+  {
+    ati::WrenchFrames wrench_frames;
+    vector<vector<double> > matrices(frames, vector<double>(36));
+    vector<vector<ati::Sample> > consumer(frames, vector<ati::Sample>(RDT_MAX_RECORDS));
+    vector<vector<ati::Sample> > pass(frames, vector<ati::Sample>(RDT_MAX_RECORDS));
+    vector<ati::Sample*> outputs(frames);
+    for (unsigned int k = 0; k < frames; ++k)
+    {
+      wrench_frames.add(string("tool") + char('0' + k % 10), tool(k));
+      tool(k).matrix(&matrices[k][0]);
+      outputs[k] = &pass[k][0];
+    }
+
+    double t0 = monotonicNow();
+    for (unsigned int i = 0; i < iterations; ++i)
+      for (unsigned int k = 0; k < frames; ++k)
+        perConsumer(&matrices[k][0], in, RDT_MAX_RECORDS, &consumer[k][0]);
+    const double consumer_time = monotonicNow() - t0;
+
+    t0 = monotonicNow();
+    for (unsigned int i = 0; i < iterations; ++i)
+      wrench_frames.apply(in, RDT_MAX_RECORDS, &outputs[0]);
+    const double pass_time = monotonicNow() - t0;
+
+    double error = 0;
+    for (unsigned int k = 0; k < frames; ++k)
+      for (size_t i = 0; i < RDT_MAX_RECORDS; ++i)
+        for (int j = 0; j < 6; ++j)
+          error = max(error, fabs(consumer[k][i].ft[j] - pass[k][i].ft[j]));
+
+    const double samples = static_cast<double>(iterations) * RDT_MAX_RECORDS;
+    cout << fixed << setprecision(2)
+         << "{\"case\":\"frames\""
+         << ",\"frames\":" << frames
+         << ",\"per_consumer_ns_per_sample\":" << consumer_time * 1e9 / samples
+         << ",\"one_pass_ns_per_sample\":" << pass_time * 1e9 / samples
+         << ",\"speedup\":" << consumer_time / pass_time
+         << scientific << setprecision(1)
+         << ",\"max_difference\":" << error
+         << "}" << endl;
+  }
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,153 @@
+// CPU cost of receiving N sensors at full RDT rate : one receive thread per
+// sensor against a single SensorGroup epoll loop. The simulators run in a
+// child process so only the driver side is measured.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+// FTSensor and SensorGroup class definitions
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/sensor_group.h"
+#include "ft_simulator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+static const uint16_t BASE_RDT_PORT = 49300;
+static const uint16_t BASE_HTTP_PORT = 8300;
+
+enum group_mode_t
+{
+  THREAD_PER_SENSOR,
+  GROUP,
+  GROUP_BATCHED     // SensorGroup draining every millisecond
+};
+
+static const char* mode_names[] = {"thread_per_sensor", "group", "group_1ms"};
+
+static void run(group_mode_t mode, size_t count, unsigned int rate, double duration)
+{
+  vector<ati::FTSensor*> sensors;
+  for (size_t i = 0; i < count; ++i)
+  {
+    ati::FTSensor* sensor = new ati::FTSensor();
+    sensor->setPort(BASE_RDT_PORT + i);
+    sensor->setHTTPPort(BASE_HTTP_PORT + i);
+    if (!sensor->init("127.0.0.1", ati::current_calibration, ati::command_s::REALTIME, 0))
+    {
+      cerr << "Could not init sensor " << i << endl;
+      delete sensor;
+      continue;
+    }
+    sensors.push_back(sensor);
+  }
+
+  ati::SensorGroup group;
+  if (mode == THREAD_PER_SENSOR)
+  {
+    for (size_t i = 0; i < sensors.size(); ++i)
+      sensors[i]->startReceiveThread(ati::FTSensor::READ_NEXT, 4 * rate);
+  }
+  else
+  {
+    if (mode == GROUP_BATCHED)
+      group.setBatchPeriod(1000);
+    for (size_t i = 0; i < sensors.size(); ++i)
+      group.add(sensors[i]);
+    group.start(ati::FTSensor::READ_NEXT, 4 * rate);
+  }
+
+  // A 1 kHz consumer draining every ring
+  vector<ati::Sample> batch(4 * rate);
+  uint64_t samples = 0;
+  const double cpu0 = processCpuTime();
+  const double t0 = monotonicNow();
+  while (monotonicNow() - t0 < duration)
+  {
+    usleep(1000);
+    for (size_t i = 0; i < sensors.size(); ++i)
+      samples += sensors[i]->readBatch(&batch[0], batch.size());
+  }
+  const double wall = monotonicNow() - t0;
+  const double cpu = processCpuTime() - cpu0;
+
+  uint64_t lost = 0, dropped = 0;
+  for (size_t i = 0; i < sensors.size(); ++i)
+  {
+    lost += sensors[i]->getSequenceStats().lost;
+    dropped += sensors[i]->getDroppedSamples();
+  }
+
+  cout << fixed << setprecision(2)
+       << "{\"mode\":\"" << mode_names[mode] << "\""
+       << ",\"sensors\":" << sensors.size()
+       << ",\"rdt_rate\":" << rate
+       << ",\"samples_per_s\":" << samples / wall
+       << ",\"expected_per_s\":" << static_cast<double>(sensors.size()) * rate
+       << ",\"lost\":" << lost
+       << ",\"dropped\":" << dropped
+       << ",\"cpu_percent\":" << 100.0 * cpu / wall;
+  if (mode != THREAD_PER_SENSOR)
+    cout << ",\"wakeups_per_s\":" << group.wakeups() / wall;
+  cout << "}" << endl;
+
+  group.stop();
+  for (size_t i = 0; i < sensors.size(); ++i)
+    delete sensors[i];
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --max-sensors N    largest group size, doubling from 1 (default 32)\n"
+       << "  --rate HZ          RDT rate of every simulated sensor (default 7000)\n"
+       << "  --duration SEC     duration of each run (default 2)\n";
+}
+
+int main(int argc, char **argv)
+{
+  size_t max_sensors = 32;
+  unsigned int rate = 7000;
+  double duration = 2.0;
+
+  static struct option options[] = {
+    {"max-sensors", required_argument, 0, 'n'},
+    {"rate", required_argument, 0, 'r'},
+    {"duration", required_argument, 0, 'd'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'n': max_sensors = atoi(optarg); break;
+      case 'r': rate = atoi(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+
+  vector<ati::SimulatorConfig> configs(max_sensors);
+  for (size_t i = 0; i < max_sensors; ++i)
+  {
+    configs[i].rdt_port = BASE_RDT_PORT + i;
+    configs[i].http_port = BASE_HTTP_PORT + i;
+    configs[i].rdt_rate = rate;
+  }
+  const pid_t simulator = ati::startSimulatorProcess(configs);
+  if (simulator < 0)
+    return -1;
+
+  for (size_t count = 1; count <= max_sensors; count *= 2)
+    for (int mode = THREAD_PER_SENSOR; mode <= GROUP_BATCHED; ++mode)
+      run(static_cast<group_mode_t>(mode), count, rate, duration);
+
+  ati::stopSimulatorProcess(simulator);
+  return 0;
+}
@@ -0,0 +1,242 @@
+// Wake-up latency of a receiving thread with and without RealtimeConfig,
+// under CPU load from busy processes of normal priority :
+// - timer : a periodic thread, how late clock_nanosleep() returns (as
+//   cyclictest does)
+// - receive : the receive thread of a sensor streaming from a loopback
+//   Net F/T simulator, from the kernel arrival time of each datagram to
+//   the sample callback
+// Reports the latency distribution of each case as one JSON object per
+// line. SCHED_FIFO and mlockall() need root, CAP_SYS_NICE / CAP_IPC_LOCK
+// or suitable RLIMIT_RTPRIO / RLIMIT_MEMLOCK.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/realtime.h"
+#include "ft_simulator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+static const uint16_t RDT_PORT = 50000;
+static const uint16_t HTTP_PORT = 9000;
+static const double buckets_us[] = {10, 20, 50, 100, 200, 500, 1000, 5000};
+static const size_t bucket_count = sizeof(buckets_us) / sizeof(buckets_us[0]);
+
+static void printCase(const char* test, const char* config, vector<double>& latencies_us, const string& extra)
+{
+  sort(latencies_us.begin(), latencies_us.end());
+  const size_t n = latencies_us.size();
+  if (n == 0)
+  {
+    cout << "{\"test\":\"" << test << "\",\"config\":\"" << config << "\",\"samples\":0}" << endl;
+    return;
+  }
+  cout << fixed << setprecision(1)
+       << "{\"test\":\"" << test << "\",\"config\":\"" << config << "\""
+       << extra
+       << ",\"samples\":" << n
+       << ",\"p50_us\":" << percentile(latencies_us, 0.5)
+       << ",\"p99_us\":" << percentile(latencies_us, 0.99)
+       << ",\"p999_us\":" << percentile(latencies_us, 0.999)
+       << ",\"max_us\":" << latencies_us.back()
+       << ",\"histogram\":{";
+  // Samples below each bound, then above the last
+  size_t i = 0;
+  for (size_t b = 0; b <= bucket_count; ++b)
+  {
+    size_t count = 0;
+    while (i < n && (b == bucket_count || latencies_us[i] < buckets_us[b]))
+    {
+      ++count;
+      ++i;
+    }
+    if (b < bucket_count)
+      cout << "\"lt_" << static_cast<int>(buckets_us[b]) << "\":" << count << ",";
+    else
+      cout << "\"ge_" << static_cast<int>(buckets_us[bucket_count - 1]) << "\":" << count;
+  }
+  cout << "}}" << endl;
+}
+
+struct TimerTest
+{
+  long period_ns;
+  size_t iterations;
+  size_t prefault;
+  vector<double> latencies_us;
+};
+
+static void* timerLoop(void* arg)
+{
+  TimerTest* test = static_cast<TimerTest*>(arg);
+  ati::prefaultStack(test->prefault);
+  struct timespec next, now;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for (size_t i = 0; i < test->iterations; ++i)
+  {
+    next.tv_nsec += test->period_ns;
+    while (next.tv_nsec >= 1000000000L)
+    {
+      next.tv_nsec -= 1000000000L;
+      ++next.tv_sec;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    test->latencies_us.push_back(((now.tv_sec - next.tv_sec) * 1e9 + (now.tv_nsec - next.tv_nsec)) * 1e-3);
+  }
+  return NULL;
+}
+
+static bool timer(const char* name, const ati::RealtimeConfig& config, long period_us, double duration)
+{
+  TimerTest test;
+  test.period_ns = period_us * 1000;
+  test.iterations = static_cast<size_t>(duration * 1e6 / period_us);
+  test.prefault = config.prefault_stack;
+  test.latencies_us.reserve(test.iterations);
+  if (config.lock_memory && !ati::lockProcessMemory())
+  {
+    cerr << "Could not lock memory" << endl;
+    return false;
+  }
+  pthread_t thread;
+  const int err = ati::createRealtimeThread(thread, config, &timerLoop, &test);
+  if (err != 0)
+  {
+    cerr << "Could not create the " << name << " thread: " << strerror(err) << endl;
+    return false;
+  }
+  pthread_join(thread, NULL);
+  ostringstream extra;
+  extra << ",\"period_us\":" << period_us;
+  printCase("timer", name, test.latencies_us, extra.str());
+  return true;
+}
+
+static bool receive(const char* name, const ati::RealtimeConfig& config, double duration)
+{
+  ati::FTSensor sensor;
+  sensor.setPort(RDT_PORT);
+  sensor.setHTTPPort(HTTP_PORT);
+  vector<double> latencies_us;
+  latencies_us.reserve(static_cast<size_t>(duration * 20000));
+  // From the kernel arrival time, or the time the batch was read without it
+  sensor.setSampleCallback([&](const ati::Sample* samples, size_t n)
+  {
+    const uint64_t now = realtimeNow();
+    if (latencies_us.size() + n <= latencies_us.capacity())
+      for (size_t i = 0; i < n; ++i)
+        latencies_us.push_back((now - samples[i].timestamp) * 1e-3);
+  });
+  if (!sensor.init("127.0.0.1") || !sensor.setRealtimeConfig(config)
+      || !sensor.startReceiveThread(ati::FTSensor::READ_NEWEST, 16))
+  {
+    cerr << "Could not start the " << name << " receive thread" << endl;
+    return false;
+  }
+  usleep(static_cast<useconds_t>(duration * 1e6));
+  sensor.stopReceiveThread();
+  ostringstream extra;
+  extra << ",\"rdt_rate_hz\":" << sensor.getRDTRate()
+        << ",\"kernel_timestamps\":" << (sensor.hasKernelTimestamps() ? "true" : "false");
+  printCase("receive", name, latencies_us, extra.str());
+  return true;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --priority N       SCHED_FIFO priority of the real-time case (default 80)\n"
+       << "  --cpu N            core of the real-time case, -1 for any (default -1)\n"
+       << "  --period US        period of the timer test (default 1000)\n"
+       << "  --rate HZ          RDT rate of the simulator (default 7000)\n"
+       << "  --duration SEC     length of each case (default 5)\n"
+       << "  --load N           busy processes of normal priority (default 1)\n";
+}
+
+int main(int argc, char **argv)
+{
+  int priority = 80;
+  int cpu = -1;
+  long period_us = 1000;
+  unsigned int rate = 7000;
+  double duration = 5;
+  int load = 1;
+
+  static struct option options[] = {
+    {"priority", required_argument, 0, 'p'},
+    {"cpu", required_argument, 0, 'c'},
+    {"period", required_argument, 0, 't'},
+    {"rate", required_argument, 0, 'r'},
+    {"duration", required_argument, 0, 'd'},
+    {"load", required_argument, 0, 'l'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'p': priority = atoi(optarg); break;
+      case 'c': cpu = atoi(optarg); break;
+      case 't': period_us = atol(optarg); break;
+      case 'r': rate = atoi(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      case 'l': load = atoi(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (period_us <= 0 || duration <= 0)
+  {
+    usage(argv[0]);
+    return -1;
+  }
+
+  ati::SimulatorConfig config;
+  config.rdt_port = RDT_PORT;
+  config.http_port = HTTP_PORT;
+  config.rdt_rate = rate;
+  const pid_t simulator = ati::startSimulatorProcess(config);
+  if (simulator < 0)
+    return -1;
+  vector<pid_t> busy;
+  for (int i = 0; i < load; ++i)
+  {
+    const pid_t pid = fork();
+    if (pid == 0)
+      for (volatile unsigned long spin = 0;; ++spin)
+        ;
+    busy.push_back(pid);
+  }
+
+  // Normal scheduling first : memory locking can't be undone
+  const ati::RealtimeConfig normal;
+  const ati::RealtimeConfig fifo = ati::RealtimeConfig::fifo(priority, cpu);
+  int ret = 0;
+  if (!timer("default", normal, period_us, duration) || !receive("default", normal, duration))
+    ret = -1;
+  if (!timer("fifo", fifo, period_us, duration) || !receive("fifo", fifo, duration))
+    ret = -1;
+
+  for (size_t i = 0; i < busy.size(); ++i)
+  {
+    kill(busy[i], SIGKILL);
+    waitpid(busy[i], NULL, 0);
+  }
+  ati::stopSimulatorProcess(simulator);
+  return ret;
+}
@@ -0,0 +1,273 @@
+// Latency, throughput, CPU and jitter of every FTSensor read mode against
+// a loopback Net F/T simulator running in a child process.
+// Results are written as one JSON object per mode and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ft_simulator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+enum read_mode_t
+{
+  SYNC_REALTIME,      // one request per sample
+  SYNC_STREAM,        // infinite stream read in the caller thread
+  SYNC_BUFFERED,      // infinite buffered stream read with readBatch()
+  THREAD_NEWEST,      // receive thread, controller reads the newest sample
+  THREAD_NEXT,        // receive thread, controller drains every sample
+  THREAD_BATCHED      // receive thread draining the socket every millisecond
+};
+
+static const char* mode_names[] = {"sync_realtime", "sync_stream", "sync_buffered",
+                                   "thread_newest", "thread_next", "thread_batched"};
+
+struct Options
+{
+  string ip;
+  uint16_t port;
+  uint16_t http_port;
+  unsigned int rate;
+  unsigned int buffer_size;
+  double duration;
+  unsigned int period_us;
+  string output;
+};
+
+// Percentiles of a set of values in microseconds, as a JSON object
+static string distribution(vector<double>& values)
+{
+  stringstream ss;
+  ss << fixed << setprecision(2);
+  if (values.empty())
+  {
+    ss << "{\"count\":0}";
+    return ss.str();
+  }
+  sort(values.begin(), values.end());
+  const size_t n = values.size();
+  double sum = 0;
+  for (size_t i = 0; i < n; ++i)
+    sum += values[i];
+  ss << "{\"count\":" << n
+     << ",\"mean\":" << sum / n
+     << ",\"p50\":" << percentile(values, 0.5)
+     << ",\"p99\":" << percentile(values, 0.99)
+     << ",\"p99.9\":" << percentile(values, 0.999)
+     << ",\"max\":" << values[n - 1] << "}";
+  return ss.str();
+}
+
+static string runMode(read_mode_t mode, const Options& opt)
+{
+  ati::FTSensor sensor;
+  sensor.setPort(opt.port);
+  sensor.setHTTPPort(opt.http_port);
+  const bool buffered = (mode == SYNC_BUFFERED);
+  const int sample_count = (mode == SYNC_REALTIME) ? 1 : 0;
+  if (!sensor.init(opt.ip, ati::current_calibration,
+                   buffered ? ati::command_s::BUFFERED : ati::command_s::REALTIME, sample_count))
+    return string();
+
+  if (mode == THREAD_BATCHED)
+    sensor.setReceiveBatchPeriod(1000);
+  if (mode >= THREAD_NEWEST)
+    sensor.startReceiveThread(mode == THREAD_NEWEST ? ati::FTSensor::READ_NEWEST : ati::FTSensor::READ_NEXT,
+                              8 * opt.rate);
+
+  const size_t capacity = static_cast<size_t>(opt.duration * opt.rate * 1.2) + 1024;
+  vector<double> latency, call, interval;
+  latency.reserve(capacity);
+  call.reserve(capacity);
+  interval.reserve(capacity);
+  vector<ati::Sample> batch(RDT_MAX_RECORDS * 64);
+
+  uint64_t samples = 0, gaps = 0, last_timestamp = 0;
+  uint32_t last_rdt = 0;
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+
+  const double cpu0 = processCpuTime();
+  const double t0 = monotonicNow();
+  while (monotonicNow() - t0 < opt.duration)
+  {
+    if (mode >= THREAD_NEWEST)
+    {
+      // A controller running at a fixed period
+      next.tv_nsec += opt.period_us * 1000L;
+      while (next.tv_nsec >= 1000000000L) { next.tv_nsec -= 1000000000L; ++next.tv_sec; }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+
+    const double c0 = monotonicNow();
+    size_t n = 0;
+    if (mode == THREAD_NEWEST)
+    {
+      double measurements[6];
+      const uint32_t previous = sensor.getLastSample().rdt_sequence;
+      sensor.getMeasurements(measurements);
+      if (sensor.getLastSample().rdt_sequence != previous)
+      {
+        batch[0] = sensor.getLastSample();
+        n = 1;
+      }
+    }
+    else
+    {
+      n = sensor.readBatch(&batch[0], (mode == SYNC_REALTIME || mode == SYNC_STREAM) ? 1 : batch.size());
+    }
+    const uint64_t returned = realtimeNow();
+    call.push_back((monotonicNow() - c0) * 1e6);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+      const ati::Sample& s = batch[i];
+      latency.push_back((static_cast<int64_t>(returned - s.timestamp)) * 1e-3);
+      if (samples > 0)
+      {
+        if (mode != THREAD_NEWEST && s.rdt_sequence != last_rdt + 1 && mode != SYNC_REALTIME)
+          ++gaps;
+        // Only successive datagrams say something about jitter
+        if (s.timestamp != last_timestamp)
+          interval.push_back((static_cast<int64_t>(s.timestamp - last_timestamp)) * 1e-3);
+      }
+      last_rdt = s.rdt_sequence;
+      last_timestamp = s.timestamp;
+      ++samples;
+    }
+  }
+  const double wall = monotonicNow() - t0;
+  const double cpu = processCpuTime() - cpu0;
+
+  // Jitter : deviation of the intervals between datagrams from their mean
+  double mean_interval = 0, jitter = 0, max_jitter = 0;
+  for (size_t i = 0; i < interval.size(); ++i)
+    mean_interval += interval[i];
+  if (!interval.empty())
+    mean_interval /= interval.size();
+  for (size_t i = 0; i < interval.size(); ++i)
+  {
+    const double d = fabs(interval[i] - mean_interval);
+    jitter += d * d;
+    max_jitter = max(max_jitter, d);
+  }
+  if (!interval.empty())
+    jitter = sqrt(jitter / interval.size());
+
+  stringstream ss;
+  ss << fixed << setprecision(2)
+     << "{\"mode\":\"" << mode_names[mode] << "\""
+     << ",\"rdt_rate\":" << opt.rate
+     << ",\"kernel_timestamps\":" << (sensor.hasKernelTimestamps() ? "true" : "false")
+     << ",\"duration_s\":" << wall
+     << ",\"samples\":" << samples
+     << ",\"throughput_hz\":" << samples / wall
+     << ",\"sequence_gaps\":" << gaps
+     << ",\"dropped\":" << sensor.getDroppedSamples()
+     << ",\"cpu_percent\":" << 100.0 * cpu / wall
+     << ",\"latency_us\":" << distribution(latency)
+     << ",\"call_us\":" << distribution(call)
+     << ",\"jitter_us\":{\"mean_interval\":" << mean_interval << ",\"stddev\":" << jitter << ",\"max\":" << max_jitter << "}"
+     << "}";
+  return ss.str();
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --rate HZ          RDT rate of the simulator (default 7000)\n"
+       << "  --buffer N         records per datagram in buffered mode (default 10)\n"
+       << "  --duration SEC     duration of each mode (default 2)\n"
+       << "  --period US        controller period of the threaded modes (default 1000)\n"
+       << "  --port PORT        RDT port of the simulator (default 49152)\n"
+       << "  --http-port PORT   web port of the simulator (default 8080)\n"
+       << "  --mode NAME        only run this mode\n"
+       << "  --output FILE      write the JSON lines to FILE instead of stdout\n";
+}
+
+int main(int argc, char **argv)
+{
+  Options opt;
+  opt.ip = "127.0.0.1";
+  opt.port = ati::command_s::DEFAULT_PORT;
+  opt.http_port = 8080;
+  opt.rate = 7000;
+  opt.buffer_size = 10;
+  opt.duration = 2.0;
+  opt.period_us = 1000;
+  string only;
+
+  static struct option options[] = {
+    {"rate", required_argument, 0, 'r'},
+    {"buffer", required_argument, 0, 'b'},
+    {"duration", required_argument, 0, 'd'},
+    {"period", required_argument, 0, 'p'},
+    {"port", required_argument, 0, 'u'},
+    {"http-port", required_argument, 0, 'w'},
+    {"mode", required_argument, 0, 'm'},
+    {"output", required_argument, 0, 'o'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'r': opt.rate = atoi(optarg); break;
+      case 'b': opt.buffer_size = atoi(optarg); break;
+      case 'd': opt.duration = atof(optarg); break;
+      case 'p': opt.period_us = atoi(optarg); break;
+      case 'u': opt.port = atoi(optarg); break;
+      case 'w': opt.http_port = atoi(optarg); break;
+      case 'm': only = optarg; break;
+      case 'o': opt.output = optarg; break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+
+  ati::SimulatorConfig config;
+  config.ip = opt.ip;
+  config.rdt_port = opt.port;
+  config.http_port = opt.http_port;
+  config.rdt_rate = opt.rate;
+  config.buffer_size = opt.buffer_size;
+  const pid_t simulator = ati::startSimulatorProcess(config);
+  if (simulator < 0)
+    return -1;
+
+  ofstream file;
+  if (!opt.output.empty())
+    file.open(opt.output.c_str());
+  ostream& out = opt.output.empty() ? cout : file;
+
+  int ret = 0;
+  for (int mode = SYNC_REALTIME; mode <= THREAD_BATCHED; ++mode)
+  {
+    if (!only.empty() && only != mode_names[mode])
+      continue;
+    const string result = runMode(static_cast<read_mode_t>(mode), opt);
+    if (result.empty())
+    {
+      cerr << "Mode " << mode_names[mode] << " failed" << endl;
+      ret = -1;
+      continue;
+    }
+    out << result << endl;
+  }
+
+  ati::stopSimulatorProcess(simulator);
+  return ret;
+}
@@ -0,0 +1,168 @@
+// What a servo loop pays to get the newest wrench from a loopback Net F/T
+// simulator : getMeasurements() without the receive thread, which reads
+// the socket, against getLatestSample() with it. Halfway through, the
+// simulator is stopped for a while, as a lost link would : reports the
+// time per call and the age of what the loop got. Results are written as
+// one JSON object per case and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <thread>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ft_simulator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+static const uint16_t RDT_PORT = 49900;
+static const uint16_t HTTP_PORT = 8900;
+
+// Stops the simulator for stall seconds, after delay seconds
+static void stall(pid_t simulator, double delay, double stall)
+{
+  usleep(static_cast<useconds_t>(delay * 1e6));
+  kill(simulator, SIGSTOP);
+  usleep(static_cast<useconds_t>(stall * 1e6));
+  kill(simulator, SIGCONT);
+}
+
+static bool servo(const char* name, bool latest, pid_t simulator, double loop_rate, double duration, double stall_s)
+{
+  ati::FTSensor sensor;
+  sensor.setPort(RDT_PORT);
+  sensor.setHTTPPort(HTTP_PORT);
+  if (!sensor.init("127.0.0.1") || (latest && !sensor.startReceiveThread(ati::FTSensor::READ_NEWEST, 16)))
+  {
+    cerr << "Could not start the sensor" << endl;
+    return false;
+  }
+
+  const size_t iterations = static_cast<size_t>(duration * loop_rate);
+  vector<double> call_us, age_us;
+  call_us.reserve(iterations);
+  age_us.reserve(iterations);
+  size_t missed_periods = 0;
+  thread staller(stall, simulator, duration / 2, stall_s);
+
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  const long period = static_cast<long>(1e9 / loop_rate);
+  for (size_t i = 0; i < iterations; ++i)
+  {
+    next.tv_nsec += period;
+    while (next.tv_nsec >= 1000000000L)
+    {
+      next.tv_nsec -= 1000000000L;
+      ++next.tv_sec;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+    const double t0 = monotonicNow();
+    ati::Sample sample;
+    uint64_t age_ns = 0;
+    bool got;
+    if (latest)
+      got = sensor.getLatestSample(sample, age_ns);
+    else
+    {
+      double ft[6];
+      uint32_t rdt_sequence;
+      sensor.getMeasurements(ft, rdt_sequence);
+      sample = sensor.getLastSample();
+      got = sample.timestamp != 0;
+      age_ns = got ? realtimeNow() - sample.timestamp : 0;
+    }
+    const double elapsed = monotonicNow() - t0;
+    call_us.push_back(elapsed * 1e6);
+    if (got)
+      age_us.push_back(age_ns * 1e-3);
+    // The loop could not keep its rate
+    if (elapsed > 1 / loop_rate)
+      missed_periods += static_cast<size_t>(elapsed * loop_rate);
+  }
+  staller.join();
+
+  sort(call_us.begin(), call_us.end());
+  sort(age_us.begin(), age_us.end());
+  cout << fixed << setprecision(2)
+       << "{\"case\":\"" << name << "\""
+       << ",\"loop_rate_hz\":" << loop_rate
+       << ",\"stall_ms\":" << stall_s * 1e3
+       << ",\"call_p50_us\":" << percentile(call_us, 0.5)
+       << ",\"call_p99_us\":" << percentile(call_us, 0.99)
+       << ",\"call_max_us\":" << percentile(call_us, 1)
+       << ",\"missed_periods\":" << missed_periods
+       << ",\"age_p50_us\":" << percentile(age_us, 0.5)
+       << ",\"age_max_us\":" << percentile(age_us, 1)
+       << "}" << endl;
+  return true;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --rate HZ          RDT rate of the simulator (default 7000)\n"
+       << "  --loop-rate HZ     rate of the servo loop (default 1000)\n"
+       << "  --duration SEC     length of each case (default 2)\n"
+       << "  --stall MS         how long the simulator is stopped (default 100)\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int rate = 7000;
+  double loop_rate = 1000;
+  double duration = 2;
+  double stall_ms = 100;
+
+  static struct option options[] = {
+    {"rate", required_argument, 0, 'r'},
+    {"loop-rate", required_argument, 0, 'l'},
+    {"duration", required_argument, 0, 'd'},
+    {"stall", required_argument, 0, 's'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'r': rate = atoi(optarg); break;
+      case 'l': loop_rate = atof(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      case 's': stall_ms = atof(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (loop_rate <= 0 || duration <= 0 || stall_ms < 0 || stall_ms * 1e-3 >= duration / 2)
+  {
+    usage(argv[0]);
+    return -1;
+  }
+
+  ati::SimulatorConfig config;
+  config.rdt_port = RDT_PORT;
+  config.http_port = HTTP_PORT;
+  config.rdt_rate = rate;
+  const pid_t simulator = ati::startSimulatorProcess(config);
+  if (simulator < 0)
+    return -1;
+  usleep(300000);
+
+  int ret = 0;
+  if (!servo("getMeasurements", false, simulator, loop_rate, duration, stall_ms * 1e-3))
+    ret = -1;
+  if (!servo("getLatestSample", true, simulator, loop_rate, duration, stall_ms * 1e-3))
+    ret = -1;
+  ati::stopSimulatorProcess(simulator);
+  return ret;
+}
@@ -0,0 +1,182 @@
+// Compressed log : encoding rate, compression ratio, and decoding rate with
+// one thread per chunk range. Every decoded record is checked against the
+// input.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+// Log and replay class definitions
+#include "ati_sensor/ft_log.h"
+#include "ati_sensor/ft_replay.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+// Interleaved 7 kHz streams : slow signal plus a few counts of noise,
+// timestamps with jitter, rare losses
+static void synthesize(vector<ati::RecordEntry>& records, size_t count, unsigned int sensors)
+{
+  records.resize(count);
+  srand(42);
+  vector<uint32_t> rdt(sensors, 0);
+  const uint64_t start = 1500000000ULL * 1000000000ULL;
+  for (size_t i = 0; i < count; ++i)
+  {
+    ati::RecordEntry& e = records[i];
+    memset(&e, 0, sizeof(e));
+    const uint16_t s = i % sensors;
+    const size_t k = i / sensors;
+    rdt[s] += (rand() % 1000 == 0) ? 2 : 1;
+    e.sensor = s;
+    e.rdt_sequence = rdt[s];
+    e.ft_sequence = rdt[s];
+    e.timestamp = start + k * 142857ULL + rand() % 20000;
+    for (int j = 0; j < 6; ++j)
+      e.counts[j] = static_cast<int32_t>(2000000 * sin(2 * M_PI * 0.5 * k / 7000.0 + j + s)) + rand() % 64;
+    e.cpf = 1000000;
+    e.cpt = 1000000;
+  }
+}
+
+struct DecodeJob {
+  const ati::FTLogReader* reader;
+  size_t first_chunk;
+  size_t end_chunk;
+  uint64_t records;
+  bool ok;
+};
+
+static void* decodeRange(void* arg)
+{
+  DecodeJob* job = static_cast<DecodeJob*>(arg);
+  vector<ati::RecordEntry> out;
+  job->records = 0;
+  job->ok = true;
+  for (size_t i = job->first_chunk; i < job->end_chunk; ++i)
+  {
+    out.resize(job->reader->chunk(i).record_count);
+    job->ok &= job->reader->decodeChunk(i, &out[0]);
+    job->records += out.size();
+  }
+  return NULL;
+}
+
+int main(int argc, char **argv)
+{
+  string input;
+  string path = "/tmp/benchmark_log.ftlog";
+  size_t count = 7000 * 600;
+  unsigned int sensors = 4;
+  unsigned int threads = 4;
+
+  static struct option options[] = {
+    {"input", required_argument, 0, 'i'},
+    {"output", required_argument, 0, 'o'},
+    {"records", required_argument, 0, 'n'},
+    {"sensors", required_argument, 0, 's'},
+    {"threads", required_argument, 0, 't'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'i': input = optarg; break;
+      case 'o': path = optarg; break;
+      case 'n': count = strtoull(optarg, NULL, 10); break;
+      case 's': sensors = atoi(optarg); break;
+      case 't': threads = atoi(optarg); break;
+      default:
+        cout << "Usage: " << argv[0] << " [--input RAW_RECORDING] [--records N] [--sensors N] [--threads N]" << endl;
+        return c == 'h' ? 0 : -1;
+    }
+  }
+
+  // Records to encode, from a raw recording or synthetic
+  vector<ati::RecordEntry> records;
+  if (!input.empty())
+  {
+    ati::RecordReplay replay;
+    if (!replay.open(input))
+      return -1;
+    records.assign(replay.records(), replay.records() + replay.recordCount());
+  }
+  else
+    synthesize(records, count, sensors);
+
+  ati::FTLogWriter writer;
+  if (!writer.open(path))
+    return -1;
+  double t0 = monotonicNow();
+  for (size_t i = 0; i < records.size(); ++i)
+    writer.append(records[i]);
+  writer.close();
+  const double encode = monotonicNow() - t0;
+  struct stat st;
+  stat(path.c_str(), &st);
+
+  ati::FTLogReader reader;
+  if (!reader.open(path))
+    return -1;
+
+  // Decode in parallel, chunk ranges per thread
+  vector<DecodeJob> jobs(threads);
+  vector<pthread_t> ids(threads);
+  t0 = monotonicNow();
+  for (unsigned int k = 0; k < threads; ++k)
+  {
+    jobs[k].reader = &reader;
+    jobs[k].first_chunk = reader.chunkCount() * k / threads;
+    jobs[k].end_chunk = reader.chunkCount() * (k + 1) / threads;
+    pthread_create(&ids[k], NULL, decodeRange, &jobs[k]);
+  }
+  uint64_t decoded = 0;
+  bool ok = true;
+  for (unsigned int k = 0; k < threads; ++k)
+  {
+    pthread_join(ids[k], NULL);
+    decoded += jobs[k].records;
+    ok &= jobs[k].ok;
+  }
+  const double decode = monotonicNow() - t0;
+
+  // Round trip : chunks of each sensor, in order, give back its records
+  vector<size_t> position(RECORD_MAX_SENSORS, 0);
+  vector<vector<size_t> > by_sensor(RECORD_MAX_SENSORS);
+  for (size_t i = 0; i < records.size(); ++i)
+    by_sensor[records[i].sensor].push_back(i);
+  vector<ati::RecordEntry> out;
+  for (size_t i = 0; i < reader.chunkCount() && ok; ++i)
+  {
+    out.resize(reader.chunk(i).record_count);
+    reader.decodeChunk(i, &out[0]);
+    for (size_t r = 0; r < out.size() && ok; ++r)
+    {
+      const uint16_t s = out[r].sensor;
+      ok = position[s] < by_sensor[s].size()
+        && memcmp(&out[r], &records[by_sensor[s][position[s]++]], sizeof(ati::RecordEntry)) == 0;
+    }
+  }
+
+  cout << fixed << setprecision(2)
+       << "{\"records\":" << records.size()
+       << ",\"chunks\":" << reader.chunkCount()
+       << ",\"bytes_per_record\":" << double(st.st_size) / records.size()
+       << ",\"ratio_vs_rdt\":" << 36.0 * records.size() / st.st_size
+       << ",\"ratio_vs_raw_recording\":" << double(sizeof(ati::RecordEntry)) * records.size() / st.st_size
+       << ",\"encode_mrecords_per_s\":" << records.size() / encode / 1e6
+       << ",\"decode_threads\":" << threads
+       << ",\"decode_mrecords_per_s\":" << decoded / decode / 1e6
+       << ",\"round_trip\":" << (ok && decoded == records.size() ? "true" : "false") << "}" << endl;
+  remove(path.c_str());
+  return ok ? 0 : -1;
+}
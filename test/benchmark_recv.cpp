@@ -0,0 +1,162 @@
+// Compares the single recv() per datagram path with the batched receive
+// engine on a loopback UDP stream paced like a Net F/T RDT stream.
+// Reports syscalls per sample and CPU usage of the receiving thread.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+
+using namespace std;
+
+struct Sender
+{
+  int socket;
+  int rate;
+  double duration;
+};
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double threadCpuTime()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6
+       + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
+static void* senderLoop(void* arg)
+{
+  Sender* s = static_cast<Sender*>(arg);
+  unsigned char record[RDT_RECORD_SIZE] = {0};
+  const long period_ns = 1000000000L / s->rate;
+  const long n = static_cast<long>(s->duration * s->rate);
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  for(long i = 0; i < n; ++i)
+  {
+    *reinterpret_cast<uint32_t*>(&record[0]) = htonl(static_cast<uint32_t>(i));
+    send(s->socket, record, sizeof(record), 0);
+    next.tv_nsec += period_ns;
+    while(next.tv_nsec >= 1000000000L) { next.tv_nsec -= 1000000000L; ++next.tv_sec; }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+  }
+  return NULL;
+}
+
+static void decode(const unsigned char* record, ati::response_s& resp)
+{
+  resp.rdt_sequence = ntohl(*reinterpret_cast<const uint32_t*>(&record[0]));
+  resp.ft_sequence = ntohl(*reinterpret_cast<const uint32_t*>(&record[4]));
+  resp.status = ntohl(*reinterpret_cast<const uint32_t*>(&record[8]));
+  resp.Fx = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[12])));
+  resp.Fy = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[16])));
+  resp.Fz = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[20])));
+  resp.Tx = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[24])));
+  resp.Ty = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[28])));
+  resp.Tz = static_cast<int32_t>(ntohl(*reinterpret_cast<const uint32_t*>(&record[32])));
+}
+
+// mode 0 : one recv per datagram
+// mode 1 : batched receive, woken up by every datagram
+// mode 2 : batched receive, drained every millisecond
+static void run(int rate, int mode, double duration)
+{
+  int rx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  int tx = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = 0;
+  bind(rx, (struct sockaddr*) &addr, sizeof(addr));
+  socklen_t len = sizeof(addr);
+  getsockname(rx, (struct sockaddr*) &addr, &len);
+  connect(tx, (struct sockaddr*) &addr, sizeof(addr));
+  struct timeval tv = {0, 200000};
+  setsockopt(rx, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+  Sender sender = {tx, rate, duration};
+  pthread_t thread;
+  pthread_create(&thread, NULL, senderLoop, &sender);
+
+  ati::RDTReceiver receiver(RECEIVE_BATCH_SIZE, RDT_RECORD_SIZE);
+  ati::response_s resp;
+  unsigned char record[RDT_RECORD_SIZE];
+  uint64_t samples = 0, syscalls = 0;
+  const long expected = static_cast<long>(duration * rate);
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+
+  const double cpu0 = threadCpuTime();
+  const double t0 = now();
+  while(samples < static_cast<uint64_t>(expected) && now() - t0 < duration + 1.0)
+  {
+    if(mode == 0)
+    {
+      ++syscalls;
+      if(recv(rx, record, sizeof(record), 0) == RDT_RECORD_SIZE)
+      {
+        decode(record, resp);
+        ++samples;
+      }
+      continue;
+    }
+    bool wait = true;
+    if(mode == 2)
+    {
+      next.tv_nsec += 1000000L;
+      while(next.tv_nsec >= 1000000000L) { next.tv_nsec -= 1000000000L; ++next.tv_sec; }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+      wait = false;
+    }
+    const int n = receiver.receive(rx, wait);
+    for(int i = 0; i < n; ++i)
+      decode(receiver.data(i), resp);
+    samples += (n > 0) ? n : 0;
+  }
+  const double wall = now() - t0;
+  const double cpu = threadCpuTime() - cpu0;
+  if(mode != 0)
+    syscalls = receiver.syscalls();
+  pthread_join(thread, NULL);
+  close(rx);
+  close(tx);
+
+  static const char* names[] = {"recv", "recvmmsg", "recvmmsg/1ms"};
+  cout << setw(6) << rate << "  " << setw(14) << names[mode]
+       << "  " << setw(8) << samples
+       << "  " << setw(10) << fixed << setprecision(3) << (samples ? double(syscalls) / samples : 0.0)
+       << "  " << setw(7) << setprecision(2) << 100.0 * cpu / wall << endl;
+}
+
+int main(int argc, char **argv)
+{
+  double duration = 2.0;
+  if (argc > 1)
+    duration = atof(argv[1]);
+
+  cout << "  rate            mode   samples  syscall/s.     CPU%" << endl;
+  const int rates[] = {1000, 2000, 7000};
+  for(int r = 0; r < 3; ++r)
+    for(int mode = 0; mode < 3; ++mode)
+      run(rates[r], mode, duration);
+  return 0;
+}
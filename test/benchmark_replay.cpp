@@ -0,0 +1,142 @@
+// Replay throughput and pacing : writes a synthetic recording, then reads it
+// back through FTSensor as fast as possible and at several speeds.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <math.h>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+// FTSensor and replay class definitions
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/ft_recorder.h"
+#include "ati_sensor/ft_replay.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+// A 7 kHz sine recorded from one sensor
+static bool writeRecording(const string& path, uint64_t count, unsigned int rate)
+{
+  ofstream file(path.c_str(), ios::binary);
+  vector<char> header(RECORD_HEADER_SIZE, 0);
+  ati::RecordFileHeader* h = reinterpret_cast<ati::RecordFileHeader*>(&header[0]);
+  memcpy(h->magic, RECORD_MAGIC, sizeof(h->magic));
+  h->version = RECORD_VERSION;
+  h->byte_order = 0x01020304;
+  h->header_size = RECORD_HEADER_SIZE;
+  h->record_size = sizeof(ati::RecordEntry);
+  h->record_count = count;
+  h->sensor_count = 1;
+  strcpy(h->sensors[0].ip, "127.0.0.1");
+  h->sensors[0].port = ati::command_s::DEFAULT_PORT;
+  h->sensors[0].rdt_rate = rate;
+  h->sensors[0].command = ati::command_s::REALTIME;
+  file.write(&header[0], header.size());
+
+  const uint64_t start = 1500000000ULL * 1000000000ULL;
+  vector<ati::RecordEntry> chunk(65536);
+  for (uint64_t i = 0; i < count; )
+  {
+    size_t n = 0;
+    for (; n < chunk.size() && i < count; ++n, ++i)
+    {
+      ati::RecordEntry& e = chunk[n];
+      memset(&e, 0, sizeof(e));
+      e.timestamp = start + i * 1000000000ULL / rate;
+      e.rdt_sequence = i + 1;
+      e.ft_sequence = i + 1;
+      for (int j = 0; j < 6; ++j)
+        e.counts[j] = static_cast<int32_t>(1000000 * sin(2 * M_PI * i / rate + j));
+      e.cpf = 1000000;
+      e.cpt = 1000000;
+    }
+    file.write(reinterpret_cast<const char*>(&chunk[0]), n * sizeof(ati::RecordEntry));
+  }
+  return file.good();
+}
+
+int main(int argc, char **argv)
+{
+  string path = "/tmp/benchmark_replay.bin";
+  uint64_t count = 10000000;
+  unsigned int rate = 7000;
+
+  static struct option options[] = {
+    {"file", required_argument, 0, 'f'},
+    {"records", required_argument, 0, 'n'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'f': path = optarg; break;
+      case 'n': count = strtoull(optarg, NULL, 10); break;
+      default:
+        cout << "Usage: " << argv[0] << " [--file PATH] [--records N]" << endl;
+        return c == 'h' ? 0 : -1;
+    }
+  }
+  if (!writeRecording(path, count, rate))
+  {
+    cerr << "Could not write " << path << endl;
+    return -1;
+  }
+
+  // As fast as possible
+  {
+    ati::FTSensor sensor;
+    if (!sensor.initReplay(path, 0, 0))
+      return -1;
+    vector<ati::Sample> batch(4096);
+    uint64_t samples = 0;
+    double sum = 0;
+    const double t0 = monotonicNow();
+    size_t n;
+    while ((n = sensor.readBatch(&batch[0], batch.size())) > 0)
+    {
+      samples += n;
+      sum += batch[n - 1].ft[0];
+    }
+    const double dt = monotonicNow() - t0;
+    cout << fixed << setprecision(2)
+         << "{\"mode\":\"as_fast_as_possible\",\"samples\":" << samples
+         << ",\"seconds\":" << dt << ",\"msamples_per_s\":" << samples / dt / 1e6
+         << ",\"recorded_hours\":" << samples / double(rate) / 3600.0
+         << ",\"lost\":" << sensor.getSequenceStats().lost << ",\"checksum\":" << sum << "}" << endl;
+  }
+
+  // Paced : half a second of recording at several speeds, one sample per read
+  const double speeds[] = {1.0, 10.0, 100.0};
+  for (size_t k = 0; k < sizeof(speeds) / sizeof(speeds[0]); ++k)
+  {
+    ati::FTSensor sensor;
+    if (!sensor.initReplay(path, 0, speeds[k]))
+      return -1;
+    const uint64_t samples = rate / 2;
+    double measurements[6];
+    uint32_t rdt, ft;
+    uint64_t first = 0, last = 0;
+    const double t0 = monotonicNow();
+    for (uint64_t i = 0; i < samples; ++i)
+    {
+      sensor.getMeasurements(measurements, rdt, ft, last);
+      if (i == 0)
+        first = last;
+    }
+    const double dt = monotonicNow() - t0;
+    const double recorded = (last - first) * 1e-9;
+    cout << fixed << setprecision(4)
+         << "{\"mode\":\"paced\",\"speed\":" << speeds[k] << ",\"samples\":" << samples
+         << ",\"recorded_s\":" << recorded << ",\"replayed_s\":" << dt
+         << ",\"achieved_speed\":" << recorded / dt << ",\"last_rdt\":" << rdt << "}" << endl;
+  }
+  remove(path.c_str());
+  return 0;
+}
@@ -0,0 +1,172 @@
+// Time to extract the settings from a netftapi2.xml document : the
+// single-pass scanner against the libxml2 DOM walk and the substring
+// searches it replaces. Results are written as one JSON object per parser
+// and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include "ati_sensor/netft_settings.h"
+#include "netft_settings_sample.h"
+#include "benchmark_util.h"
+#ifdef HAVE_LIBXML2
+#include <libxml/parser.h>
+#include <libxml/tree.h>
+#endif
+
+using namespace std;
+
+// What every parser extracts, to check they agree
+struct Extracted
+{
+  uint32_t cpf;
+  uint32_t cpt;
+  int rdt_rate;
+  int gauge_bias[6];
+};
+
+static bool parseBias(const string& str, int bias[6])
+{
+  stringstream ss(str);
+  string token;
+  int i = 0;
+  while (i < 6 && getline(ss, token, ';'))
+    bias[i++] = atoi(token.c_str());
+  return i == 6;
+}
+
+static bool scanner(const string& document, Extracted& e)
+{
+  ati::NetFTSettings settings;
+  ati::parseNetFTSettings(document.data(), document.size(), settings);
+  e.cpf = settings.cpf;
+  e.cpt = settings.cpt;
+  e.rdt_rate = settings.rdt_rate;
+  memcpy(e.gauge_bias, settings.gauge_bias, sizeof(e.gauge_bias));
+  return settings.has(ati::NetFTSettings::CPF | ati::NetFTSettings::CPT
+                      | ati::NetFTSettings::GAUGE_BIAS | ati::NetFTSettings::RDT_RATE);
+}
+
+// The searches of the former Xenomai path, one over the document per field
+static string stringInXml(const string& xml, const string& tag)
+{
+  const size_t start = xml.find("<" + tag + ">");
+  const size_t end = xml.find("</" + tag + ">");
+  if (start == string::npos || end == string::npos)
+    return string();
+  return xml.substr(start + tag.size() + 2, end - start - tag.size() - 2);
+}
+
+static bool substring(const string& document, Extracted& e)
+{
+  e.cpf = static_cast<uint32_t>(atof(stringInXml(document, "cfgcpf").c_str()));
+  e.cpt = static_cast<uint32_t>(atof(stringInXml(document, "cfgcpt").c_str()));
+  e.rdt_rate = static_cast<int>(atof(stringInXml(document, "comrdtrate").c_str()));
+  return parseBias(stringInXml(document, "setbias"), e.gauge_bias);
+}
+
+#ifdef HAVE_LIBXML2
+// The DOM walk of the former libxml2 path, one over the tree per field
+static void findElement(xmlNode* node, const string& name, string& ret)
+{
+  for (; node; node = node->next)
+  {
+    if (node->type == XML_ELEMENT_NODE && name == reinterpret_cast<const char*>(node->name))
+    {
+      if (node->children && node->children->content)
+        ret = reinterpret_cast<const char*>(node->children->content);
+      continue;
+    }
+    findElement(node->children, name, ret);
+  }
+}
+
+static bool libxml2Dom(const string& document, Extracted& e)
+{
+  // libxml2 got the body without the HTTP headers
+  const size_t body = document.find("<?xml");
+  xmlDocPtr doc = xmlReadMemory(document.data() + body, document.size() - body, NULL, NULL, XML_PARSE_NOERROR | XML_PARSE_NOWARNING);
+  if (!doc)
+    return false;
+  xmlNode* root = xmlDocGetRootElement(doc);
+  string cpf, cpt, bias, rate;
+  findElement(root, "cfgcpf", cpf);
+  findElement(root, "cfgcpt", cpt);
+  findElement(root, "setbias", bias);
+  findElement(root, "comrdtrate", rate);
+  xmlFreeDoc(doc);
+  e.cpf = static_cast<uint32_t>(atoi(cpf.c_str()));
+  e.cpt = static_cast<uint32_t>(atoi(cpt.c_str()));
+  e.rdt_rate = atoi(rate.c_str());
+  return parseBias(bias, e.gauge_bias);
+}
+#endif
+
+typedef bool (*parser_t)(const string&, Extracted&);
+
+static string run(const char* name, parser_t parser, const string& document, unsigned int iterations,
+                  const Extracted& expected)
+{
+  Extracted e;
+  memset(&e, 0, sizeof(e));
+  bool ok = parser(document, e) && memcmp(&e, &expected, sizeof(e)) == 0;
+
+  const double t0 = monotonicNow();
+  for (unsigned int i = 0; i < iterations; ++i)
+    ok &= parser(document, e);
+  const double elapsed = monotonicNow() - t0;
+
+  stringstream ss;
+  ss << fixed << setprecision(1)
+     << "{\"parser\":\"" << name << "\""
+     << ",\"document_bytes\":" << document.size()
+     << ",\"iterations\":" << iterations
+     << ",\"ns_per_document\":" << elapsed * 1e9 / iterations
+     << ",\"mb_per_s\":" << document.size() * iterations / elapsed * 1e-6
+     << ",\"correct\":" << (ok ? "true" : "false")
+     << "}";
+  return ss.str();
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --iterations N     documents parsed by each parser (default 100000)\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int iterations = 100000;
+
+  static struct option options[] = {
+    {"iterations", required_argument, 0, 'n'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'n': iterations = atoi(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (iterations == 0)
+    iterations = 1;
+
+  const string document(netft_settings_sample, sizeof(netft_settings_sample) - 1);
+  const Extracted expected = {1000000, 1000000, 1000, {-2351, 1289, -77, 10244, -1931, 472}};
+
+  cout << run("scanner", &scanner, document, iterations, expected) << endl;
+  cout << run("substring", &substring, document, iterations, expected) << endl;
+#ifdef HAVE_LIBXML2
+  xmlInitParser();
+  cout << run("libxml2_dom", &libxml2Dom, document, iterations, expected) << endl;
+#endif
+  return 0;
+}
@@ -0,0 +1,288 @@
+// Fan-out of one sensor stream to several local processes : readers
+// attached to a shared memory stream (ShmPublisher / ShmReader) against the
+// owner sending every sample to each reader over a Unix datagram socket.
+// The owner publishes at the RDT rate; each reader process reports the age
+// of the samples when it gets them, what it missed and the cost of its
+// reads, the owner what publishing cost it. Results are written as one JSON
+// object per case and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/shm_stream.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+static const char* STREAM_NAME = "benchmark_shm";
+
+struct ReaderStats
+{
+  vector<double> ages_us;
+  uint64_t lost;
+  double read_s;
+  uint64_t reads;
+  double latest_ns;
+  ReaderStats() : lost(0), read_s(0), reads(0), latest_ns(-1) {}
+
+  void print(const char* transport, int reader, uint64_t sent)
+  {
+    sort(ages_us.begin(), ages_us.end());
+    double mean = 0;
+    for (size_t i = 0; i < ages_us.size(); ++i)
+      mean += ages_us[i];
+    mean /= max<size_t>(ages_us.size(), 1);
+    cout << fixed << setprecision(2)
+         << "{\"case\":\"reader\",\"transport\":\"" << transport << "\""
+         << ",\"reader\":" << reader
+         << ",\"sent\":" << sent
+         << ",\"delivered\":" << ages_us.size()
+         << ",\"lost\":" << lost
+         << ",\"age_mean_us\":" << mean
+         << ",\"age_p99_us\":" << percentile(ages_us, 0.99)
+         << ",\"age_max_us\":" << percentile(ages_us, 1)
+         << ",\"ns_per_read\":" << (reads ? read_s * 1e9 / reads : 0)
+         << ",\"ns_per_latest\":" << latest_ns
+         << "}" << endl;
+  }
+};
+
+// The owner : one sample per period, stamped when published
+template<typename Publish>
+static double publishStream(Publish publish, double rate, uint64_t count)
+{
+  struct timespec next;
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  const long period = static_cast<long>(1e9 / rate);
+  double busy = 0;
+  ati::Sample sample = ati::Sample();
+  for (uint64_t i = 0; i < count; ++i)
+  {
+    next.tv_nsec += period;
+    while (next.tv_nsec >= 1000000000L)
+    {
+      next.tv_nsec -= 1000000000L;
+      ++next.tv_sec;
+    }
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    sample.rdt_sequence = static_cast<uint32_t>(i);
+    sample.ft[2] = static_cast<double>(i);
+    const double t0 = monotonicNow();
+    sample.timestamp = realtimeNow();
+    publish(sample);
+    busy += monotonicNow() - t0;
+  }
+  return busy / count;
+}
+
+static void shmReader(int reader, uint64_t sent)
+{
+  ati::ShmReader shm;
+  if (!shm.attach(STREAM_NAME))
+    _exit(1);
+  ReaderStats stats;
+  stats.ages_us.reserve(sent);
+
+  // The newest sample, as a controller at its own rate would read it
+  ati::Sample sample;
+  const unsigned int latest_calls = 1000000;
+  double t0 = monotonicNow();
+  for (unsigned int i = 0; i < latest_calls; ++i)
+    shm.latest(sample);
+  stats.latest_ns = (monotonicNow() - t0) * 1e9 / latest_calls;
+
+  // Every sample, as a logger would. Started after the timing above : the
+  // samples published meanwhile are read late, not counted as ages
+  shm.skipToLatest();
+  const uint64_t skipped = shm.lost();
+  ati::Sample batch[64];
+  while (shm.isLive() || shm.pending() > 0)
+  {
+    t0 = monotonicNow();
+    const size_t n = shm.read(batch, 64);
+    const uint64_t now = realtimeNow();
+    if (n == 0)
+    {
+      // Leave the core to the owner and the other readers when they share it
+      sched_yield();
+      continue;
+    }
+    stats.read_s += monotonicNow() - t0;
+    ++stats.reads;
+    for (size_t i = 0; i < n; ++i)
+      stats.ages_us.push_back((now - batch[i].timestamp) * 1e-3);
+  }
+  stats.lost = shm.lost() - skipped;
+  stats.print("shm", reader, sent);
+  _exit(0);
+}
+
+static void socketReader(int reader, int fd, uint64_t sent)
+{
+  ReaderStats stats;
+  stats.ages_us.reserve(sent);
+  ati::Sample sample;
+  for (;;)
+  {
+    // Polled like the shared memory, so that the wait is not timed
+    const double t0 = monotonicNow();
+    const ssize_t length = recv(fd, &sample, sizeof(sample), MSG_DONTWAIT);
+    const uint64_t now = realtimeNow();
+    if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      sched_yield();
+      continue;
+    }
+    // An empty datagram ends the stream
+    if (length <= 0)
+      break;
+    stats.read_s += monotonicNow() - t0;
+    ++stats.reads;
+    stats.ages_us.push_back((now - sample.timestamp) * 1e-3);
+  }
+  stats.lost = sent - stats.ages_us.size();
+  stats.print("unix_socket", reader, sent);
+  _exit(0);
+}
+
+static bool waitReaders(const vector<pid_t>& readers)
+{
+  bool ok = true;
+  for (size_t i = 0; i < readers.size(); ++i)
+  {
+    int status = 0;
+    waitpid(readers[i], &status, 0);
+    ok &= WIFEXITED(status) && WEXITSTATUS(status) == 0;
+  }
+  return ok;
+}
+
+static void printOwner(const char* transport, int readers, double per_sample)
+{
+  cout << fixed << setprecision(1)
+       << "{\"case\":\"owner\",\"transport\":\"" << transport << "\""
+       << ",\"readers\":" << readers
+       << ",\"ns_per_sample\":" << per_sample * 1e9
+       << "}" << endl;
+}
+
+struct ShmPublish
+{
+  ati::ShmPublisher* publisher;
+  void operator()(const ati::Sample& sample) const {publisher->publish(&sample, 1);}
+};
+
+struct SocketPublish
+{
+  const vector<int>* fds;
+  void operator()(const ati::Sample& sample) const
+  {
+    for (size_t i = 0; i < fds->size(); ++i)
+      send((*fds)[i], &sample, sizeof(sample), MSG_DONTWAIT);
+  }
+};
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --readers N        reader processes (default 4)\n"
+       << "  --rate HZ          samples published per second (default 7000)\n"
+       << "  --duration SEC     length of each case (default 2)\n";
+}
+
+int main(int argc, char **argv)
+{
+  int readers = 4;
+  double rate = 7000;
+  double duration = 2;
+
+  static struct option options[] = {
+    {"readers", required_argument, 0, 'n'},
+    {"rate", required_argument, 0, 'r'},
+    {"duration", required_argument, 0, 'd'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'n': readers = atoi(optarg); break;
+      case 'r': rate = atof(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (readers < 1 || rate <= 0 || duration <= 0)
+  {
+    usage(argv[0]);
+    return -1;
+  }
+  const uint64_t count = static_cast<uint64_t>(rate * duration);
+  bool ok = true;
+
+  {
+    ati::ShmPublisher publisher;
+    if (!publisher.open(STREAM_NAME, 65536, static_cast<uint32_t>(rate)))
+      return -1;
+    vector<pid_t> pids;
+    for (int i = 0; i < readers; ++i)
+    {
+      const pid_t pid = fork();
+      if (pid == 0)
+        shmReader(i, count);
+      pids.push_back(pid);
+    }
+    // Let the readers attach and time latest()
+    usleep(500000);
+    ShmPublish publish = {&publisher};
+    const double per_sample = publishStream(publish, rate, count);
+    publisher.close();
+    ok &= waitReaders(pids);
+    printOwner("shm", readers, per_sample);
+  }
+
+  {
+    vector<int> fds;
+    vector<pid_t> pids;
+    for (int i = 0; i < readers; ++i)
+    {
+      int pair[2];
+      if (socketpair(AF_UNIX, SOCK_DGRAM, 0, pair) != 0)
+        return -1;
+      const pid_t pid = fork();
+      if (pid == 0)
+      {
+        close(pair[0]);
+        socketReader(i, pair[1], count);
+      }
+      close(pair[1]);
+      fds.push_back(pair[0]);
+      pids.push_back(pid);
+    }
+    usleep(200000);
+    SocketPublish publish = {&fds};
+    const double per_sample = publishStream(publish, rate, count);
+    for (size_t i = 0; i < fds.size(); ++i)
+    {
+      send(fds[i], NULL, 0, 0);
+      close(fds[i]);
+    }
+    ok &= waitReaders(pids);
+    printOwner("unix_socket", readers, per_sample);
+  }
+  return ok ? 0 : -1;
+}
@@ -0,0 +1,178 @@
+// Time from FTSensor::init() to the first sample, with and without the
+// calibration cache, against a loopback Net F/T simulator whose web server
+// answers slowly. Results are written as one JSON object per case and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ft_simulator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+enum startup_case_t
+{
+  NO_CACHE,      // the settings are downloaded before streaming
+  CACHE_MISS,    // same, and they are written to the cache
+  CACHE_HIT,     // streaming starts from the cache, checked in the background
+  CACHE_STALE    // the cache is wrong, the background check fixes it
+};
+
+static const char* case_names[] = {"no_cache", "cache_miss", "cache_hit", "cache_stale"};
+static const char* source_names[] = {"default", "cache", "sensor"};
+
+struct Options
+{
+  string ip;
+  uint16_t port;
+  uint16_t http_port;
+  uint32_t cpf;
+  string cache_dir;
+};
+
+// Key of the simulator in the cache, as the driver builds it
+static string httpHost(const Options& opt)
+{
+  stringstream ss;
+  ss << opt.ip << ":" << opt.http_port;
+  return ss.str();
+}
+
+static string runCase(startup_case_t c, const Options& opt)
+{
+  ati::CalibrationCache cache(opt.cache_dir);
+  const string host = httpHost(opt);
+  if (c == CACHE_MISS)
+    cache.remove(host, ati::current_calibration);
+  if (c == CACHE_STALE)
+  {
+    ati::CalibrationData stale;
+    if (!cache.load(host, ati::current_calibration, stale))
+      return string();
+    stale.cpf *= 2;
+    cache.store(host, ati::current_calibration, stale);
+  }
+
+  ati::FTSensor sensor;
+  sensor.setPort(opt.port);
+  sensor.setHTTPPort(opt.http_port);
+  sensor.setCalibrationCache(c != NO_CACHE, opt.cache_dir);
+
+  const double t0 = monotonicNow();
+  if (!sensor.init(opt.ip))
+    return string();
+  const double init_time = monotonicNow() - t0;
+  double measurements[6];
+  sensor.getMeasurements(measurements);
+  const double first_sample = monotonicNow() - t0;
+  const int source = sensor.getCalibrationSource();
+  const double cpf_at_start = sensor.getCountsperForce();
+  sensor.waitCalibrationRefresh();
+  const double refreshed = monotonicNow() - t0;
+
+  stringstream ss;
+  ss << fixed << setprecision(3)
+     << "{\"case\":\"" << case_names[c] << "\""
+     << ",\"init_ms\":" << init_time * 1e3
+     << ",\"first_sample_ms\":" << first_sample * 1e3
+     << ",\"calibrated_ms\":" << refreshed * 1e3
+     << ",\"source_at_start\":\"" << source_names[source] << "\""
+     << ",\"source\":\"" << source_names[sensor.getCalibrationSource()] << "\""
+     << setprecision(0)
+     << ",\"cpf_at_start\":" << cpf_at_start
+     << ",\"cpf\":" << sensor.getCountsperForce()
+     << ",\"cpf_expected\":" << opt.cpf
+     << "}";
+  return ss.str();
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --http-delay SEC   time the web server takes to answer (default 0.5)\n"
+       << "  --cpf N            counts per force of the simulator (default 1000000)\n"
+       << "  --cache-dir DIR    calibration cache directory (default: a temporary one)\n"
+       << "  --port PORT        RDT port of the simulator (default 49152)\n"
+       << "  --http-port PORT   web port of the simulator (default 8080)\n";
+}
+
+int main(int argc, char **argv)
+{
+  Options opt;
+  opt.ip = "127.0.0.1";
+  opt.port = ati::command_s::DEFAULT_PORT;
+  opt.http_port = 8080;
+  opt.cpf = 1000000;
+  double http_delay = 0.5;
+
+  static struct option options[] = {
+    {"http-delay", required_argument, 0, 'y'},
+    {"cpf", required_argument, 0, 'f'},
+    {"cache-dir", required_argument, 0, 'c'},
+    {"port", required_argument, 0, 'u'},
+    {"http-port", required_argument, 0, 'w'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'y': http_delay = atof(optarg); break;
+      case 'f': opt.cpf = atoi(optarg); break;
+      case 'c': opt.cache_dir = optarg; break;
+      case 'u': opt.port = atoi(optarg); break;
+      case 'w': opt.http_port = atoi(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+
+  bool temporary = false;
+  if (opt.cache_dir.empty())
+  {
+    char dir[] = "/tmp/ati_sensor_cacheXXXXXX";
+    if (!mkdtemp(dir))
+      return -1;
+    opt.cache_dir = dir;
+    temporary = true;
+  }
+
+  ati::SimulatorConfig config;
+  config.ip = opt.ip;
+  config.rdt_port = opt.port;
+  config.http_port = opt.http_port;
+  config.rdt_rate = 1000;
+  config.cpf = opt.cpf;
+  config.http_delay = http_delay;
+  const pid_t simulator = ati::startSimulatorProcess(config);
+  if (simulator < 0)
+    return -1;
+
+  int ret = 0;
+  for (int i = NO_CACHE; i <= CACHE_STALE; ++i)
+  {
+    const string result = runCase(static_cast<startup_case_t>(i), opt);
+    if (result.empty())
+    {
+      cerr << "Case " << case_names[i] << " failed" << endl;
+      ret = -1;
+      continue;
+    }
+    cout << result << endl;
+  }
+
+  ati::stopSimulatorProcess(simulator);
+  if (temporary)
+  {
+    ati::CalibrationCache(opt.cache_dir).remove(httpHost(opt), ati::current_calibration);
+    rmdir(opt.cache_dir.c_str());
+  }
+  return ret;
+}
@@ -0,0 +1,198 @@
+// Taring with the SET_SOFWARE_BIAS command of the sensor against the host
+// side bias (FTSensor::tare()) on a loopback Net F/T simulator under a
+// constant load : time and samples until the readings are zeroed. Also the
+// effect of outlier rejection on the offset, and the cost of subtracting
+// it. Results are written as one JSON object per case and per line.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <vector>
+// FTSensor class definition
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/host_bias.h"
+#include "ft_simulator.h"
+#include "benchmark_util.h"
+
+using namespace std;
+
+static const uint16_t RDT_PORT = 49600;
+static const uint16_t HTTP_PORT = 8600;
+// Readings below this are zeroed, far above the simulated noise
+static const double ZERO_THRESHOLD = 0.5;
+static const double load[6] = {3.0, -2.0, 10.0, 0.1, 0.2, -0.3};
+
+static bool zeroed(const ati::Sample& s)
+{
+  for (int j = 0; j < 6; ++j)
+    if (fabs(s.ft[j]) > ZERO_THRESHOLD)
+      return false;
+  return true;
+}
+
+// Samples read after t0 until one is zeroed, and the time it took
+static void untilZeroed(ati::FTSensor& sensor, unsigned int profile, double t0, long& samples, double& ms)
+{
+  samples = -1;
+  ms = -1;
+  long count = 0;
+  while (monotonicNow() - t0 < 2.0)
+  {
+    ati::Sample batch[64];
+    const size_t n = sensor.readTaredBatch(batch, 64, profile);
+    for (size_t i = 0; i < n; ++i, ++count)
+      if (zeroed(batch[i]))
+      {
+        samples = count;
+        ms = (monotonicNow() - t0) * 1e3;
+        return;
+      }
+    if (n == 0)
+      usleep(100);
+  }
+}
+
+static void printCase(const char* name, double call_us, long samples, double ms)
+{
+  cout << fixed << setprecision(3)
+       << "{\"case\":\"" << name << "\""
+       << ",\"call_us\":" << call_us
+       << ",\"samples_before_zeroed\":" << samples
+       << ",\"ms_until_zeroed\":" << ms
+       << "}" << endl;
+}
+
+// Offset error of a tare over a window with knocks on Fz, with and without rejection
+static void outliers(unsigned int n, double spike_rate)
+{
+  mt19937 rng(42);
+  normal_distribution<double> noise(0, 0.05);
+  uniform_real_distribution<double> uniform(0, 1);
+  vector<ati::Sample> samples(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    for (int j = 0; j < 6; ++j)
+      samples[i].ft[j] = load[j] + noise(rng);
+    if (uniform(rng) < spike_rate)
+      samples[i].ft[2] += 20.0;
+  }
+  ati::HostBias bias;
+  bias.record(&samples[0], n);
+  for (int reject = 0; reject <= 3; reject += 3)
+  {
+    bias.tare(0, n, reject);
+    double offset[6];
+    bias.offset(0, offset);
+    cout << fixed << setprecision(4)
+         << "{\"case\":\"outliers\""
+         << ",\"samples\":" << n
+         << ",\"spike_rate\":" << spike_rate
+         << ",\"reject_sigma\":" << reject
+         << ",\"fz_offset_error\":" << offset[2] - load[2]
+         << "}" << endl;
+  }
+
+  // Cost of subtracting the offset, per sample handed out
+  const unsigned int iterations = 1000000;
+  ati::Sample batch[RDT_MAX_RECORDS];
+  for (size_t i = 0; i < RDT_MAX_RECORDS; ++i)
+    batch[i] = samples[i % n];
+  const double t0 = monotonicNow();
+  for (unsigned int i = 0; i < iterations; ++i)
+    bias.apply(i % ati::HostBias::MAX_PROFILES, batch, RDT_MAX_RECORDS);
+  const double elapsed = monotonicNow() - t0;
+  cout << fixed << setprecision(3)
+       << "{\"case\":\"apply\""
+       << ",\"ns_per_sample\":" << elapsed * 1e9 / (static_cast<double>(iterations) * RDT_MAX_RECORDS)
+       << "}" << endl;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --rate HZ          RDT rate of the simulator (default 7000)\n"
+       << "  --samples N        samples averaged by tare() (default 100)\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned int rate = 7000;
+  unsigned int samples = 100;
+
+  static struct option options[] = {
+    {"rate", required_argument, 0, 'r'},
+    {"samples", required_argument, 0, 'n'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'r': rate = atoi(optarg); break;
+      case 'n': samples = atoi(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+
+  ati::SimulatorConfig config;
+  config.rdt_port = RDT_PORT;
+  config.http_port = HTTP_PORT;
+  config.rdt_rate = rate;
+  config.signal = ati::SimulatorConfig::CONSTANT;
+  for (int j = 0; j < 6; ++j)
+    config.offset[j] = load[j];
+  config.noise = 0.05;
+  const pid_t simulator = ati::startSimulatorProcess(config);
+  if (simulator < 0)
+    return -1;
+
+  int ret = 0;
+  {
+    ati::FTSensor sensor;
+    sensor.setPort(RDT_PORT);
+    sensor.setHTTPPort(HTTP_PORT);
+    if (!sensor.init("127.0.0.1") || !sensor.startReceiveThread(ati::FTSensor::READ_NEXT, 1 << 16))
+    {
+      cerr << "Could not start the sensor" << endl;
+      ret = -1;
+    }
+    else
+    {
+      long count;
+      double ms;
+      // Host side first, the sensor has no bias yet
+      usleep(100000);
+      double t0 = monotonicNow();
+      const bool tared = sensor.tare(0, samples, 3);
+      const double tare_us = (monotonicNow() - t0) * 1e6;
+      ati::Sample batch[64];
+      while (sensor.readBatch(batch, 64) == 64)
+        ;
+      untilZeroed(sensor, 0, monotonicNow(), count, ms);
+      printCase("host_tare", tare_us, tared ? count : -1, ms);
+      if (!tared || count != 0)
+        ret = -1;
+
+      // The command of the sensor, read without host offset. The simulator
+      // applies it as soon as it is received, a device takes longer
+      while (sensor.readBatch(batch, 64) > 0)
+        ;
+      t0 = monotonicNow();
+      sensor.setBias();
+      const double bias_us = (monotonicNow() - t0) * 1e6;
+      untilZeroed(sensor, 1, t0, count, ms);
+      printCase("sensor_bias", bias_us, count, ms);
+    }
+  }
+  ati::stopSimulatorProcess(simulator);
+
+  outliers(1000, 0.02);
+  return ret;
+}
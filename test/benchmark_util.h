@@ -0,0 +1,44 @@
+// Clocks and statistics shared by the benchmarks
+#ifndef ATI_SENSOR_BENCHMARK_UTIL_H
+#define ATI_SENSOR_BENCHMARK_UTIL_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <vector>
+
+// Seconds, for durations
+static inline double monotonicNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Nanoseconds since the epoch, same clock as Sample::timestamp
+static inline uint64_t realtimeNow()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+// User and system time of the process, in seconds
+static inline double processCpuTime()
+{
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6
+       + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+}
+
+// Value of rank p (0 to 1) among values sorted in increasing order, 0 if none
+static inline double percentile(const std::vector<double>& sorted, double p)
+{
+  if (sorted.empty())
+    return 0;
+  const size_t i = static_cast<size_t>(p * sorted.size());
+  return sorted[i < sorted.size() ? i : sorted.size() - 1];
+}
+
+#endif
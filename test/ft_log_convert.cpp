@@ -0,0 +1,450 @@
+// Converts recordings (raw FTRecorder files or compressed logs) to columnar
+// .npy arrays and/or CSV, one set of files per sensor, in SI units.
+// Chunks are decoded and formatted on all cores; output keeps the
+// recorded order.
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <getopt.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <atomic>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+// Log and replay class definitions
+#include "ati_sensor/ft_log.h"
+#include "ati_sensor/ft_replay.h"
+
+using namespace std;
+
+// Records of a raw recording converted per unit of work
+static const size_t RAW_UNIT_RECORDS = 65536;
+// Fixed size of the .npy headers, so the shape can be patched at the end
+static const size_t NPY_HEADER_SIZE = 128;
+// Units converted in parallel before being written out in order
+static const size_t UNITS_PER_THREAD = 4;
+
+static const char* column_names[] = {"timestamp", "rdt_sequence", "ft_sequence", "status",
+                                     "fx", "fy", "fz", "tx", "ty", "tz"};
+static const char* column_types[] = {"<u8", "<u4", "<u4", "<u4",
+                                     "<f8", "<f8", "<f8", "<f8", "<f8", "<f8"};
+static const size_t column_sizes[] = {8, 4, 4, 4, 8, 8, 8, 8, 8, 8};
+static const int COLUMNS = 10;
+
+// Converted records of one sensor in one unit
+struct Columns {
+  vector<uint64_t> timestamp;
+  vector<uint32_t> rdt_sequence;
+  vector<uint32_t> ft_sequence;
+  vector<uint32_t> status;
+  vector<double> ft[6];
+  string csv;
+
+  void clear()
+  {
+    timestamp.clear();
+    rdt_sequence.clear();
+    ft_sequence.clear();
+    status.clear();
+    for (int j = 0; j < 6; ++j)
+      ft[j].clear();
+    csv.clear();
+  }
+  const void* data(int column) const
+  {
+    switch (column)
+    {
+      case 0: return timestamp.empty() ? NULL : &timestamp[0];
+      case 1: return rdt_sequence.empty() ? NULL : &rdt_sequence[0];
+      case 2: return ft_sequence.empty() ? NULL : &ft_sequence[0];
+      case 3: return status.empty() ? NULL : &status[0];
+      default: return ft[column - 4].empty() ? NULL : &ft[column - 4][0];
+    }
+  }
+};
+
+struct Unit {
+  size_t chunk;             // compressed log chunk, or first raw record
+  size_t count;             // raw records
+  vector<ati::RecordEntry> decoded;
+  vector<Columns> sensors;  // indexed by sensor
+  size_t uncalibrated;      // records without counts per unit, written as NaN
+  size_t undescribed;       // records of a sensor missing from the sensor table
+  bool ok;
+};
+
+struct Converter {
+  const ati::FTLogReader* log;
+  const ati::RecordEntry* raw;
+  int sensor;               // -1 for every sensor
+  bool csv;
+  bool npy;
+  vector<Unit> units;
+  size_t batch_begin;
+  size_t batch_end;
+  std::atomic<size_t> next;
+};
+
+struct OutputFiles {
+  FILE* npy[COLUMNS];
+  FILE* csv;
+  uint64_t rows;
+  string base;
+};
+
+static void convertUnit(Converter& conv, Unit& unit, size_t sensor_count)
+{
+  unit.ok = true;
+  unit.uncalibrated = 0;
+  unit.undescribed = 0;
+  const ati::RecordEntry* records;
+  size_t n;
+  if (conv.log)
+  {
+    n = conv.log->chunk(unit.chunk).record_count;
+    unit.decoded.resize(n);
+    unit.ok = n == 0 || conv.log->decodeChunk(unit.chunk, &unit.decoded[0]);
+    records = n == 0 ? NULL : &unit.decoded[0];
+  }
+  else
+  {
+    n = unit.count;
+    records = conv.raw + unit.chunk;
+  }
+  unit.sensors.resize(sensor_count);
+  for (size_t s = 0; s < sensor_count; ++s)
+    unit.sensors[s].clear();
+
+  char line[256];
+  for (size_t i = 0; i < n && unit.ok; ++i)
+  {
+    const ati::RecordEntry& e = records[i];
+    if (e.sensor >= sensor_count)
+      ++unit.undescribed;
+    if (e.sensor >= sensor_count || (conv.sensor >= 0 && e.sensor != conv.sensor))
+      continue;
+    Columns& c = unit.sensors[e.sensor];
+    // No calibration was recorded for this sample, the counts can't be converted
+    if (e.cpf == 0 || e.cpt == 0)
+      ++unit.uncalibrated;
+    const double force_scale = e.cpf ? 1.0 / e.cpf : NAN;
+    const double torque_scale = e.cpt ? 1.0 / e.cpt : NAN;
+    double ft[6];
+    for (int j = 0; j < 6; ++j)
+      ft[j] = e.counts[j] * (j < 3 ? force_scale : torque_scale);
+    if (conv.npy)
+    {
+      c.timestamp.push_back(e.timestamp);
+      c.rdt_sequence.push_back(e.rdt_sequence);
+      c.ft_sequence.push_back(e.ft_sequence);
+      c.status.push_back(e.status);
+      for (int j = 0; j < 6; ++j)
+        c.ft[j].push_back(ft[j]);
+    }
+    if (conv.csv)
+    {
+      const int len = snprintf(line, sizeof(line), "%llu,%u,%u,%u,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+                               static_cast<unsigned long long>(e.timestamp), e.rdt_sequence, e.ft_sequence, e.status,
+                               ft[0], ft[1], ft[2], ft[3], ft[4], ft[5]);
+      c.csv.append(line, len);
+    }
+  }
+  // Keep memory for the next batch, but not the decoded records
+  vector<ati::RecordEntry>().swap(unit.decoded);
+}
+
+struct Worker {
+  Converter* conv;
+  size_t sensor_count;
+};
+
+static void* workerEntry(void* arg)
+{
+  Worker* w = static_cast<Worker*>(arg);
+  Converter& conv = *w->conv;
+  size_t i;
+  while ((i = conv.next.fetch_add(1)) < conv.batch_end)
+    convertUnit(conv, conv.units[i], w->sensor_count);
+  return NULL;
+}
+
+static bool writeNpyHeader(FILE* file, const char* type, uint64_t rows)
+{
+  // Version 1.0 : magic, version, header length, dict padded to the size
+  stringstream dict;
+  dict << "{'descr': '" << type << "', 'fortran_order': False, 'shape': (" << rows << ",), }";
+  string header = dict.str();
+  header.resize(NPY_HEADER_SIZE - 10 - 1, ' ');
+  header += '\n';
+  const unsigned char preamble[10] = {0x93, 'N', 'U', 'M', 'P', 'Y', 1, 0,
+                                      static_cast<unsigned char>(header.size() & 0xff),
+                                      static_cast<unsigned char>(header.size() >> 8)};
+  return fseek(file, 0, SEEK_SET) == 0
+      && fwrite(preamble, 1, sizeof(preamble), file) == sizeof(preamble)
+      && fwrite(header.data(), 1, header.size(), file) == header.size()
+      && fseek(file, 0, SEEK_END) == 0;
+}
+
+static void writeError(const string& path)
+{
+  cerr << "Could not write " << path << ": " << strerror(errno) << endl;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options] recording\n"
+       << "  --output PREFIX    output file prefix (default: the input name)\n"
+       << "  --format FMT       npy, csv or both (default both)\n"
+       << "  --sensor N         only convert this sensor\n"
+       << "  --threads N        worker threads (default: all cores)\n"
+       << "Writes PREFIX_sN_COLUMN.npy (timestamp, rdt_sequence, ft_sequence, status,\n"
+       << "fx, fy, fz in N, tx, ty, tz in Nm) and PREFIX_sN.csv for every sensor N.\n";
+}
+
+int main(int argc, char **argv)
+{
+  string prefix;
+  string format = "both";
+  int sensor = -1;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+  static struct option options[] = {
+    {"output", required_argument, 0, 'o'},
+    {"format", required_argument, 0, 'f'},
+    {"sensor", required_argument, 0, 's'},
+    {"threads", required_argument, 0, 't'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'o': prefix = optarg; break;
+      case 'f': format = optarg; break;
+      case 's': sensor = atoi(optarg); break;
+      case 't': threads = atol(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (optind >= argc || (format != "npy" && format != "csv" && format != "both"))
+  {
+    usage(argv[0]);
+    return -1;
+  }
+  const string input = argv[optind];
+  if (prefix.empty())
+    prefix = input.substr(0, input.rfind('.'));
+  if (threads < 1)
+    threads = 1;
+
+  // Compressed log or raw recording, by magic
+  char magic[8] = {0};
+  FILE* probe = fopen(input.c_str(), "rb");
+  if (!probe || fread(magic, 1, sizeof(magic), probe) != sizeof(magic))
+  {
+    cerr << "Could not read " << input << endl;
+    return -1;
+  }
+  fclose(probe);
+
+  ati::FTLogReader log;
+  ati::RecordReplay raw;
+  Converter conv;
+  conv.log = NULL;
+  conv.raw = NULL;
+  conv.sensor = sensor;
+  conv.csv = (format != "npy");
+  conv.npy = (format != "csv");
+  size_t sensor_count;
+  const ati::RecordSensorInfo* infos;
+  if (memcmp(magic, LOG_MAGIC, sizeof(magic)) == 0)
+  {
+    if (!log.open(input))
+      return -1;
+    conv.log = &log;
+    sensor_count = log.header().sensor_count;
+    infos = log.header().sensors;
+    for (size_t i = 0; i < log.chunkCount(); ++i)
+      if (sensor < 0 || log.chunk(i).sensor == sensor)
+      {
+        conv.units.push_back(Unit());
+        conv.units.back().chunk = i;
+        conv.units.back().count = 0;
+      }
+  }
+  else
+  {
+    if (!raw.open(input))
+      return -1;
+    conv.raw = raw.records();
+    sensor_count = raw.header().sensor_count;
+    infos = raw.header().sensors;
+    for (size_t i = 0; i < raw.recordCount(); i += RAW_UNIT_RECORDS)
+    {
+      conv.units.push_back(Unit());
+      conv.units.back().chunk = i;
+      conv.units.back().count = (raw.recordCount() - i < RAW_UNIT_RECORDS) ? raw.recordCount() - i : RAW_UNIT_RECORDS;
+    }
+  }
+  if (sensor_count > RECORD_MAX_SENSORS)
+  {
+    cerr << input << " has a corrupt sensor table" << endl;
+    return -1;
+  }
+  if (sensor >= static_cast<int>(sensor_count))
+  {
+    cerr << input << " has " << sensor_count << " sensor(s), no sensor " << sensor << endl;
+    return -1;
+  }
+
+  // One set of files per sensor
+  vector<OutputFiles> outputs(sensor_count);
+  for (size_t s = 0; s < sensor_count; ++s)
+  {
+    OutputFiles& out = outputs[s];
+    for (int k = 0; k < COLUMNS; ++k)
+      out.npy[k] = NULL;
+    out.csv = NULL;
+    out.rows = 0;
+    if (sensor >= 0 && static_cast<int>(s) != sensor)
+      continue;
+    stringstream base;
+    base << prefix << "_s" << s;
+    out.base = base.str();
+    for (int k = 0; k < COLUMNS && conv.npy; ++k)
+    {
+      const string path = out.base + "_" + column_names[k] + ".npy";
+      out.npy[k] = fopen(path.c_str(), "wb");
+      if (!out.npy[k])
+      {
+        cerr << "Could not create " << path << endl;
+        return -1;
+      }
+      if (!writeNpyHeader(out.npy[k], column_types[k], 0))
+      {
+        writeError(path);
+        return -1;
+      }
+    }
+    if (conv.csv)
+    {
+      out.csv = fopen((out.base + ".csv").c_str(), "wb");
+      if (!out.csv)
+      {
+        cerr << "Could not create " << out.base << ".csv" << endl;
+        return -1;
+      }
+      if (fprintf(out.csv, "# sensor %s:%u, rdt rate %u Hz\n", infos[s].ip, infos[s].port, infos[s].rdt_rate) < 0
+          || fprintf(out.csv, "timestamp,rdt_sequence,ft_sequence,status,fx,fy,fz,tx,ty,tz\n") < 0)
+      {
+        writeError(out.base + ".csv");
+        return -1;
+      }
+    }
+  }
+
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  const size_t batch = threads * UNITS_PER_THREAD;
+  bool ok = true;
+  bool written = true;
+  uint64_t uncalibrated = 0;
+  uint64_t undescribed = 0;
+  vector<pthread_t> ids(threads);
+  vector<Worker> workers(threads);
+  for (size_t begin = 0; begin < conv.units.size() && ok && written; begin += batch)
+  {
+    // Convert a batch in parallel...
+    conv.batch_begin = begin;
+    conv.batch_end = (begin + batch < conv.units.size()) ? begin + batch : conv.units.size();
+    conv.next = begin;
+    for (long k = 0; k < threads; ++k)
+    {
+      workers[k].conv = &conv;
+      workers[k].sensor_count = sensor_count;
+      pthread_create(&ids[k], NULL, workerEntry, &workers[k]);
+    }
+    for (long k = 0; k < threads; ++k)
+      pthread_join(ids[k], NULL);
+
+    // ...then write it out in order
+    for (size_t u = conv.batch_begin; u < conv.batch_end && written; ++u)
+    {
+      Unit& unit = conv.units[u];
+      ok &= unit.ok;
+      uncalibrated += unit.uncalibrated;
+      undescribed += unit.undescribed;
+      for (size_t s = 0; s < sensor_count && written; ++s)
+      {
+        Columns& col = unit.sensors[s];
+        OutputFiles& out = outputs[s];
+        if (conv.npy && !col.timestamp.empty())
+        {
+          for (int k = 0; k < COLUMNS && written; ++k)
+            if (fwrite(col.data(k), column_sizes[k], col.timestamp.size(), out.npy[k]) != col.timestamp.size())
+            {
+              writeError(out.base + "_" + column_names[k] + ".npy");
+              written = false;
+            }
+          out.rows += col.timestamp.size();
+        }
+        if (conv.csv && !col.csv.empty() && written)
+        {
+          if (fwrite(col.csv.data(), 1, col.csv.size(), out.csv) != col.csv.size())
+          {
+            writeError(out.base + ".csv");
+            written = false;
+          }
+          if (!conv.npy)
+            out.rows += count(col.csv.begin(), col.csv.end(), '\n');
+        }
+      }
+      // Release the batch
+      vector<Columns>().swap(unit.sensors);
+    }
+  }
+  if (!ok)
+    cerr << input << " is corrupted, output is truncated" << endl;
+  if (uncalibrated > 0)
+    cerr << uncalibrated << " record(s) have no calibration, their force and torque are NaN" << endl;
+  // A log whose writer crashed before describing its sensors
+  if (undescribed > 0)
+    cerr << undescribed << " record(s) of sensors missing from the sensor table of " << input << " were not converted" << endl;
+
+  uint64_t rows = 0;
+  for (size_t s = 0; s < sensor_count; ++s)
+  {
+    OutputFiles& out = outputs[s];
+    // A full disk may only show when the buffers are flushed
+    for (int k = 0; k < COLUMNS; ++k)
+      if (out.npy[k])
+      {
+        const bool closed = writeNpyHeader(out.npy[k], column_types[k], out.rows);
+        if ((fclose(out.npy[k]) != 0 || !closed) && written)
+        {
+          writeError(out.base + "_" + column_names[k] + ".npy");
+          written = false;
+        }
+      }
+    if (out.csv && fclose(out.csv) != 0 && written)
+    {
+      writeError(out.base + ".csv");
+      written = false;
+    }
+    rows += out.rows;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  const double dt = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+  cout << fixed << setprecision(2) << "Converted " << rows << " records of " << (sensor < 0 ? sensor_count : 1)
+       << " sensor(s) in " << dt << " s with " << threads << " thread(s) (" << rows / dt / 1e6 << " M records/s)" << endl;
+  return (ok && written && undescribed == 0) ? 0 : -1;
+}
@@ -0,0 +1,131 @@
+// Records the RDT stream of one or more sensors to a binary file
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+// FTSensor, SensorGroup and FTRecorder class definitions
+#include "ati_sensor/ft_sensor.h"
+#include "ati_sensor/sensor_group.h"
+#include "ati_sensor/ft_recorder.h"
+
+using namespace std;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int)
+{
+  interrupted = 1;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options] ip[:port[:http_port]]...\n"
+       << "  --output FILE      recording file (default ft_record.bin)\n"
+       << "  --duration SEC     stop after this time (default: run until Ctrl-C)\n"
+       << "  --buffered         use buffered RDT streaming\n"
+       << "  --compress         write a compressed log instead of raw records\n";
+}
+
+int main(int argc, char **argv)
+{
+  string output = "ft_record.bin";
+  double duration = 0;
+  uint16_t command = ati::command_s::REALTIME;
+  bool compress = false;
+
+  static struct option options[] = {
+    {"output", required_argument, 0, 'o'},
+    {"duration", required_argument, 0, 'd'},
+    {"buffered", no_argument, 0, 'b'},
+    {"compress", no_argument, 0, 'c'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'o': output = optarg; break;
+      case 'd': duration = atof(optarg); break;
+      case 'b': command = ati::command_s::BUFFERED; break;
+      case 'c': compress = true; break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+  if (optind >= argc)
+  {
+    usage(argv[0]);
+    return -1;
+  }
+
+  vector<ati::FTSensor*> sensors;
+  for (int i = optind; i < argc; ++i)
+  {
+    // ip[:port[:http_port]]
+    string arg = argv[i];
+    ati::FTSensor* sensor = new ati::FTSensor();
+    size_t colon = arg.find(':');
+    const string ip = arg.substr(0, colon);
+    if (colon != string::npos)
+    {
+      sensor->setPort(atoi(arg.c_str() + colon + 1));
+      colon = arg.find(':', colon + 1);
+      if (colon != string::npos)
+        sensor->setHTTPPort(atoi(arg.c_str() + colon + 1));
+    }
+    if (!sensor->init(ip, ati::current_calibration, command, 0))
+    {
+      cerr << "Could not initialize " << arg << endl;
+      return -1;
+    }
+    sensors.push_back(sensor);
+  }
+
+  ati::FTRecorder recorder;
+  if (!(compress ? recorder.openCompressed(output) : recorder.open(output)))
+    return -1;
+  ati::SensorGroup group;
+  for (size_t i = 0; i < sensors.size(); ++i)
+  {
+    recorder.attach(sensors[i]);
+    group.add(sensors[i]);
+  }
+  // Nobody reads the samples, keep only the newest one
+  if (!group.start(ati::FTSensor::READ_NEWEST, 16))
+    return -1;
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+  cout << "Recording " << sensors.size() << " sensor(s) to " << output << endl;
+
+  struct timespec t0, t;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  double elapsed = 0;
+  while (!interrupted && (duration <= 0 || elapsed < duration))
+  {
+    usleep(100000);
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    elapsed = (t.tv_sec - t0.tv_sec) + (t.tv_nsec - t0.tv_nsec) * 1e-9;
+  }
+  group.stop();
+  recorder.close();
+
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  const double cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec * 1e-6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec * 1e-6;
+  cout << fixed << setprecision(2) << recorder.recordsWritten() << " records written, "
+       << recorder.recordsDropped() << " dropped, in " << elapsed << " s, "
+       << 100.0 * cpu / elapsed << "% CPU" << endl;
+
+  for (size_t i = 0; i < sensors.size(); ++i)
+    delete sensors[i];
+  return 0;
+}
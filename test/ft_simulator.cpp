@@ -0,0 +1,577 @@
+#include "ft_simulator.h"
+#include "ati_sensor/ft_sensor.h"
+#include <math.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <random>
+#include <vector>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/wait.h>
+
+// The Net F/T samples its gauges at 7 kHz whatever the RDT rate,
+// ft_sequence counts these internal samples (or records above 7 kHz)
+#define INTERNAL_RATE 7000.0
+
+using namespace ati;
+
+static double now()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sleepUntil(double t)
+{
+  struct timespec ts;
+  ts.tv_sec = static_cast<time_t>(t);
+  ts.tv_nsec = static_cast<long>((t - ts.tv_sec) * 1e9);
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+// Value of a query string parameter, empty if absent
+static std::string queryParameter(const std::string& query, const std::string& name)
+{
+  size_t start = 0;
+  while (start < query.size())
+  {
+    size_t end = query.find('&', start);
+    if (end == std::string::npos)
+      end = query.size();
+    const std::string token = query.substr(start, end - start);
+    const size_t eq = token.find('=');
+    if (eq != std::string::npos && token.substr(0, eq) == name)
+      return token.substr(eq + 1);
+    start = end + 1;
+  }
+  return std::string();
+}
+
+static int openBoundSocket(const std::string& ip, uint16_t port, int type)
+{
+  int handle = socket(AF_INET, type, 0);
+  if (handle < 0)
+    return -1;
+  int yes = 1;
+  setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  if (inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) != 1
+      || bind(handle, (struct sockaddr*) &addr, sizeof(addr)) < 0
+      || (type == SOCK_STREAM && listen(handle, 16) < 0))
+  {
+    close(handle);
+    return -1;
+  }
+  return handle;
+}
+
+SimulatorConfig::SimulatorConfig()
+: ip("127.0.0.1")
+, rdt_port(command_s::DEFAULT_PORT)
+, http_port(8080)
+, rdt_rate(1000)
+, buffer_size(1)
+, cpf(1000000)
+, cpt(1000000)
+, signal(SINE)
+, amplitude(1.0)
+, frequency(1.0)
+, noise(0.0)
+, loss(0.0)
+, reorder(0.0)
+, duplicate(0.0)
+, http_delay(0.0)
+, http_keep_alive(false)
+, seed(42)
+{
+  for (int i = 0; i < 6; ++i)
+    offset[i] = 0.0;
+}
+
+FTSimulator::FTSimulator(const SimulatorConfig& config)
+: config_(config)
+, rdt_socket_(-1)
+, http_socket_(-1)
+, running_(false)
+, stop_(false)
+, rdt_rate_(config.rdt_rate)
+, buffer_size_(config.buffer_size)
+, calibration_index_(0)
+, records_generated_(0)
+, datagrams_sent_(0)
+, datagrams_lost_(0)
+, commands_received_(0)
+, http_requests_(0)
+{
+  for (int i = 0; i < 6; ++i)
+    gauge_bias_[i] = 0;
+}
+
+FTSimulator::~FTSimulator()
+{
+  stop();
+}
+
+bool FTSimulator::start()
+{
+  if (running_)
+    return true;
+  rdt_socket_ = openBoundSocket(config_.ip, config_.rdt_port, SOCK_DGRAM);
+  http_socket_ = openBoundSocket(config_.ip, config_.http_port, SOCK_STREAM);
+  if (rdt_socket_ < 0 || http_socket_ < 0)
+  {
+    std::cerr << "[ft_simulator] Could not bind " << config_.ip << ":" << config_.rdt_port
+              << " (udp) and " << config_.ip << ":" << config_.http_port << " (tcp): " << strerror(errno) << std::endl;
+    if (rdt_socket_ >= 0)
+      close(rdt_socket_);
+    if (http_socket_ >= 0)
+      close(http_socket_);
+    rdt_socket_ = http_socket_ = -1;
+    return false;
+  }
+  stop_ = false;
+  pthread_create(&rdt_thread_, NULL, &FTSimulator::rdtEntry, this);
+  pthread_create(&http_thread_, NULL, &FTSimulator::httpEntry, this);
+  running_ = true;
+  return true;
+}
+
+void FTSimulator::stop()
+{
+  if (!running_)
+    return;
+  stop_ = true;
+  pthread_join(rdt_thread_, NULL);
+  pthread_join(http_thread_, NULL);
+  close(rdt_socket_);
+  close(http_socket_);
+  rdt_socket_ = http_socket_ = -1;
+  running_ = false;
+}
+
+void* FTSimulator::rdtEntry(void* arg)
+{
+  static_cast<FTSimulator*>(arg)->rdtLoop();
+  return NULL;
+}
+
+void* FTSimulator::httpEntry(void* arg)
+{
+  static_cast<FTSimulator*>(arg)->httpLoop();
+  return NULL;
+}
+
+void FTSimulator::signalAt(double t, double ft[6])
+{
+  for (int i = 0; i < 6; ++i)
+  {
+    ft[i] = config_.offset[i];
+    const double phase = 2.0 * M_PI * config_.frequency * t;
+    switch (config_.signal)
+    {
+      case SimulatorConfig::SINE:
+        ft[i] += config_.amplitude * sin(phase + i * M_PI / 3.0);
+        break;
+      case SimulatorConfig::RAMP:
+        ft[i] += config_.amplitude * (2.0 * (phase / (2.0 * M_PI) - floor(phase / (2.0 * M_PI))) - 1.0);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void FTSimulator::rdtLoop()
+{
+  std::mt19937 rng(config_.seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::normal_distribution<double> gaussian(0.0, 1.0);
+
+  bool streaming = false;
+  bool infinite = false;
+  uint16_t mode = command_s::STOP;
+  uint32_t remaining = 0;
+  uint32_t rdt_sequence = 0;
+  uint32_t ft_sequence = 0;
+  uint32_t status = 0;
+  int32_t bias[6] = {0, 0, 0, 0, 0, 0};
+  struct sockaddr_in peer;
+  memset(&peer, 0, sizeof(peer));
+
+  // Records are due at base_time + index / rate
+  unsigned int rate = rdt_rate_;
+  double base_time = now();
+  uint64_t stream_count = 0;
+  const double origin = base_time;
+
+  unsigned char datagram[RDT_MAX_DATAGRAM_SIZE];
+  unsigned char held[RDT_MAX_DATAGRAM_SIZE];
+  size_t held_length = 0;
+
+  while (!stop_)
+  {
+    // Commands
+    unsigned char request[8];
+    struct sockaddr_in from;
+    socklen_t from_length = sizeof(from);
+    ssize_t length;
+    while ((length = recvfrom(rdt_socket_, request, sizeof(request), MSG_DONTWAIT, (struct sockaddr*) &from, &from_length)) >= 0)
+    {
+      from_length = sizeof(from);
+      if (length != sizeof(request) || ntohs(*reinterpret_cast<uint16_t*>(&request[0])) != command_s::command_header)
+        continue;
+      ++commands_received_;
+      const uint16_t command = ntohs(*reinterpret_cast<uint16_t*>(&request[2]));
+      const uint32_t sample_count = ntohl(*reinterpret_cast<uint32_t*>(&request[4]));
+      switch (command)
+      {
+        case command_s::STOP:
+          streaming = false;
+          break;
+        case command_s::REALTIME:
+        case command_s::BUFFERED:
+        case command_s::MULTIUNIT:
+          peer = from;
+          mode = command;
+          streaming = true;
+          infinite = (sample_count == 0);
+          remaining = sample_count;
+          rdt_sequence = 0;
+          rate = rdt_rate_;
+          base_time = now();
+          stream_count = 0;
+          break;
+        case command_s::SET_SOFWARE_BIAS:
+        {
+          // The next records read zero for the current load
+          double ft[6];
+          signalAt(now() - origin, ft);
+          for (int i = 0; i < 6; ++i)
+            bias[i] = static_cast<int32_t>(llround(ft[i] * (i < 3 ? config_.cpf : config_.cpt)));
+          break;
+        }
+        case command_s::RESET_THRESHOLD_LATCH:
+          status = 0;
+          break;
+        default:
+          break;
+      }
+    }
+
+    if (!streaming)
+    {
+      struct pollfd pfd = {rdt_socket_, POLLIN, 0};
+      poll(&pfd, 1, 10);
+      continue;
+    }
+
+    // Rate changed through the web server
+    if (rate != rdt_rate_)
+    {
+      rate = rdt_rate_;
+      base_time = now();
+      stream_count = 0;
+    }
+
+    size_t per_datagram = 1;
+    if (mode == command_s::BUFFERED)
+    {
+      per_datagram = buffer_size_;
+      per_datagram = per_datagram < 1 ? 1 : (per_datagram > RDT_MAX_RECORDS ? RDT_MAX_RECORDS : per_datagram);
+    }
+
+    const uint64_t due = static_cast<uint64_t>((now() - base_time) * rate) + 1;
+    for (;;)
+    {
+      size_t k = per_datagram;
+      if (!infinite && remaining < k)
+        k = remaining;
+      if (!streaming || stream_count + k > due)
+        break;
+      for (size_t r = 0; r < k; ++r)
+      {
+        const double t = base_time - origin + static_cast<double>(stream_count) / rate;
+        ++rdt_sequence;
+        ++stream_count;
+        double ft[6];
+        signalAt(t, ft);
+        unsigned char* record = &datagram[r * RDT_RECORD_SIZE];
+        *reinterpret_cast<uint32_t*>(&record[0]) = htonl(rdt_sequence);
+        // Every record is a new internal sample
+        const double internal_rate = (rate > INTERNAL_RATE) ? rate : INTERNAL_RATE;
+        const uint32_t internal_sequence = static_cast<uint32_t>(llround(t * internal_rate));
+        ft_sequence = (internal_sequence > ft_sequence) ? internal_sequence : ft_sequence + 1;
+        *reinterpret_cast<uint32_t*>(&record[4]) = htonl(ft_sequence);
+        *reinterpret_cast<uint32_t*>(&record[8]) = htonl(status);
+        for (int i = 0; i < 6; ++i)
+        {
+          double value = ft[i];
+          if (config_.signal == SimulatorConfig::NOISE)
+            value += config_.amplitude * gaussian(rng);
+          if (config_.noise > 0)
+            value += config_.noise * gaussian(rng);
+          const int32_t counts = static_cast<int32_t>(llround(value * (i < 3 ? config_.cpf : config_.cpt))) - bias[i];
+          *reinterpret_cast<uint32_t*>(&record[12 + i * 4]) = htonl(static_cast<uint32_t>(counts));
+        }
+      }
+      records_generated_ += k;
+      const size_t datagram_length = k * RDT_RECORD_SIZE;
+
+      // Network faults
+      if (uniform(rng) < config_.loss)
+      {
+        ++datagrams_lost_;
+      }
+      else if (held_length == 0 && uniform(rng) < config_.reorder)
+      {
+        memcpy(held, datagram, datagram_length);
+        held_length = datagram_length;
+      }
+      else
+      {
+        sendto(rdt_socket_, datagram, datagram_length, 0, (struct sockaddr*) &peer, sizeof(peer));
+        ++datagrams_sent_;
+        if (uniform(rng) < config_.duplicate)
+        {
+          sendto(rdt_socket_, datagram, datagram_length, 0, (struct sockaddr*) &peer, sizeof(peer));
+          ++datagrams_sent_;
+        }
+        if (held_length > 0)
+        {
+          sendto(rdt_socket_, held, held_length, 0, (struct sockaddr*) &peer, sizeof(peer));
+          ++datagrams_sent_;
+          held_length = 0;
+        }
+      }
+
+      if (!infinite)
+      {
+        remaining -= k;
+        if (remaining == 0)
+          streaming = false;
+      }
+    }
+
+    // Sleep until the next datagram is due, but look at commands every millisecond
+    if (streaming)
+    {
+      const double next = base_time + static_cast<double>(stream_count + per_datagram - 1) / rate;
+      const double poll_time = now() + 0.001;
+      sleepUntil(next < poll_time ? next : poll_time);
+    }
+  }
+}
+
+std::string FTSimulator::settingsXml()
+{
+  std::stringstream ss;
+  ss << "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\r\n"
+     << "<netft>\r\n"
+     << "<setserial>FT-SIM-" << config_.rdt_port << "</setserial>\r\n"
+     << "<setfwver>sim</setfwver>\r\n"
+     << "<setuserfilter>0</setuserfilter>\r\n"
+     << "<setbias>";
+  for (int i = 0; i < 6; ++i)
+    ss << gauge_bias_[i] << (i < 5 ? ";" : "");
+  ss << "</setbias>\r\n"
+     << "<comrdtrate>" << rdt_rate_ << "</comrdtrate>\r\n"
+     << "<comrdtbsiz>" << buffer_size_ << "</comrdtbsiz>\r\n"
+     << "<cfgcalsel>" << calibration_index_ << "</cfgcalsel>\r\n"
+     << "<cfgfu>2</cfgfu>\r\n"
+     << "<cfgtu>3</cfgtu>\r\n"
+     << "<cfgcpf>" << config_.cpf << "</cfgcpf>\r\n"
+     << "<cfgcpt>" << config_.cpt << "</cfgcpt>\r\n"
+     << "<scfgfu>N</scfgfu>\r\n"
+     << "<scfgtu>Nm</scfgtu>\r\n"
+     << "<calsn>FT-SIM</calsn>\r\n"
+     << "<calpartnum>SI-SIM</calpartnum>\r\n"
+     << "<calcaldt>1/1/2000</calcaldt>\r\n"
+     << "</netft>\r\n";
+  return ss.str();
+}
+
+std::string FTSimulator::handleHttpRequest(const std::string& target)
+{
+  ++http_requests_;
+  const size_t question = target.find('?');
+  const std::string path = target.substr(0, question);
+  const std::string query = (question == std::string::npos) ? std::string() : target.substr(question + 1);
+  std::stringstream response;
+
+  if (path == "/netftapi2.xml")
+  {
+    const std::string body = settingsXml();
+    response << "HTTP/1.0 200 OK\r\nContent-Type: text/xml\r\nContent-Length: " << body.size() << "\r\n\r\n" << body;
+    return response.str();
+  }
+
+  bool known = true;
+  if (path == "/comm.cgi")
+  {
+    const std::string rate = queryParameter(query, "comrdtrate");
+    if (!rate.empty() && atoi(rate.c_str()) > 0)
+      rdt_rate_ = atoi(rate.c_str());
+    const std::string buffer_size = queryParameter(query, "comrdtbsiz");
+    if (!buffer_size.empty() && atoi(buffer_size.c_str()) > 0)
+      buffer_size_ = atoi(buffer_size.c_str());
+  }
+  else if (path == "/setting.cgi")
+  {
+    for (int i = 0; i < 6; ++i)
+    {
+      std::stringstream name;
+      name << "setbias" << i;
+      const std::string value = queryParameter(query, name.str());
+      if (!value.empty())
+        gauge_bias_[i] = atoi(value.c_str());
+    }
+  }
+  else if (path == "/config.cgi")
+  {
+    const std::string calibration = queryParameter(query, "cfgcalsel");
+    if (!calibration.empty())
+      calibration_index_ = atoi(calibration.c_str());
+  }
+  else
+  {
+    known = false;
+  }
+
+  if (known)
+    response << "HTTP/1.0 302 Found\r\nLocation: /\r\nContent-Length: 0\r\n\r\n";
+  else
+    response << "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+  return response.str();
+}
+
+void FTSimulator::httpLoop()
+{
+  // The driver keeps a connection open while idle, so clients are
+  // multiplexed rather than served one after the other
+  std::vector<struct pollfd> fds;
+  std::vector<std::string> pending;
+  struct pollfd listener = {http_socket_, POLLIN, 0};
+  fds.push_back(listener);
+  pending.push_back(std::string());
+
+  while (!stop_)
+  {
+    if (poll(&fds[0], fds.size(), 100) <= 0)
+      continue;
+
+    for (size_t i = fds.size(); i-- > 1;)
+    {
+      if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      char buffer[4096];
+      const ssize_t length = recv(fds[i].fd, buffer, sizeof(buffer), 0);
+      bool close_connection = (length <= 0);
+      if (length > 0)
+        pending[i].append(buffer, length);
+
+      size_t end;
+      while (!close_connection && (end = pending[i].find("\r\n\r\n")) != std::string::npos)
+      {
+        const std::string header = pending[i].substr(0, end);
+        pending[i].erase(0, end + 4);
+        // Request line : GET <target> HTTP/1.x
+        const size_t first_space = header.find(' ');
+        const size_t second_space = header.find(' ', first_space + 1);
+        std::string response;
+        if (first_space == std::string::npos || second_space == std::string::npos)
+          response = "HTTP/1.0 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+        else
+          response = handleHttpRequest(header.substr(first_space + 1, second_space - first_space - 1));
+        if (config_.http_delay > 0)
+          sleepUntil(now() + config_.http_delay);
+        // Like the device, one request per connection unless keep-alive is
+        // enabled and the client speaks HTTP/1.1 without asking to close
+        const bool keep_alive = config_.http_keep_alive
+            && header.compare(second_space + 1, 8, "HTTP/1.1") == 0
+            && header.find("Connection: close") == std::string::npos;
+        if (keep_alive)
+          response.replace(0, 8, "HTTP/1.1");
+        send(fds[i].fd, response.c_str(), response.size(), MSG_NOSIGNAL);
+        close_connection = !keep_alive;
+      }
+
+      if (close_connection)
+      {
+        close(fds[i].fd);
+        fds.erase(fds.begin() + i);
+        pending.erase(pending.begin() + i);
+      }
+    }
+
+    if (fds[0].revents & POLLIN)
+    {
+      const int client = accept(http_socket_, NULL, NULL);
+      if (client >= 0)
+      {
+        int yes = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        struct pollfd pfd = {client, POLLIN, 0};
+        fds.push_back(pfd);
+        pending.push_back(std::string());
+      }
+    }
+  }
+
+  for (size_t i = 1; i < fds.size(); ++i)
+    close(fds[i].fd);
+}
+
+pid_t ati::startSimulatorProcess(const std::vector<SimulatorConfig>& configs)
+{
+  int ready[2];
+  if (pipe(ready) != 0)
+    return -1;
+  const pid_t pid = fork();
+  if (pid == 0)
+  {
+    close(ready[0]);
+    std::vector<FTSimulator*> simulators;
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+      simulators.push_back(new FTSimulator(configs[i]));
+      if (!simulators.back()->start())
+        _exit(1);
+    }
+    // Their sockets are bound, requests are queued from now on
+    const char byte = 1;
+    if (write(ready[1], &byte, 1) != 1)
+      _exit(1);
+    close(ready[1]);
+    pause();
+    _exit(0);
+  }
+  close(ready[1]);
+  char byte;
+  const bool started = pid > 0 && read(ready[0], &byte, 1) == 1;
+  close(ready[0]);
+  if (started)
+    return pid;
+  if (pid > 0)
+    waitpid(pid, NULL, 0);
+  std::cerr << "[ft_simulator] Could not start the simulators" << std::endl;
+  return -1;
+}
+
+pid_t ati::startSimulatorProcess(const SimulatorConfig& config)
+{
+  return startSimulatorProcess(std::vector<SimulatorConfig>(1, config));
+}
+
+void ati::stopSimulatorProcess(pid_t pid)
+{
+  if (pid <= 0)
+    return;
+  kill(pid, SIGTERM);
+  waitpid(pid, NULL, 0);
+}
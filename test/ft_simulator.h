@@ -0,0 +1,109 @@
+// Net F/T device simulator : speaks the RDT protocol over UDP and serves
+// the configuration pages of the web server over TCP, so the driver can
+// be tested and benchmarked without a physical sensor.
+#ifndef ATI_SENSOR_FT_SIMULATOR_H
+#define ATI_SENSOR_FT_SIMULATOR_H
+
+#include <string>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+#include <pthread.h>
+#include <sys/types.h>
+
+namespace ati{
+
+struct SimulatorConfig
+{
+  enum signal_t
+  {
+    CONSTANT,
+    SINE,
+    RAMP,
+    NOISE
+  };
+
+  SimulatorConfig();
+
+  std::string ip;             // address to bind, use 127.0.0.x to run many instances
+  uint16_t rdt_port;          // UDP port of the RDT protocol
+  uint16_t http_port;         // TCP port of the web server
+  unsigned int rdt_rate;      // records per second
+  unsigned int buffer_size;   // records per datagram in buffered mode
+  uint32_t cpf;               // counts per force
+  uint32_t cpt;               // counts per torque
+  signal_t signal;
+  double offset[6];           // Fx, Fy, Fz in N and Tx, Ty, Tz in Nm
+  double amplitude;           // in N (or Nm) for SINE and RAMP
+  double frequency;           // in Hz for SINE and RAMP
+  double noise;               // standard deviation added to every axis
+  double loss;                // probability of dropping a datagram
+  double reorder;             // probability of delaying a datagram after the next one
+  double duplicate;           // probability of sending a datagram twice
+  double http_delay;          // seconds the web server takes to answer, like a busy device
+  bool http_keep_alive;       // serve several requests per connection, the device closes after one
+  unsigned int seed;
+};
+
+class FTSimulator{
+public:
+  explicit FTSimulator(const SimulatorConfig& config = SimulatorConfig());
+  ~FTSimulator();
+
+  bool start();
+  void stop();
+  bool isRunning() const {return running_;}
+
+  const SimulatorConfig& config() const {return config_;}
+  unsigned int rdtRate() const {return rdt_rate_;}
+
+  // Statistics
+  uint64_t recordsGenerated() const {return records_generated_;}
+  uint64_t datagramsSent() const {return datagrams_sent_;}
+  uint64_t datagramsLost() const {return datagrams_lost_;}
+  uint64_t commandsReceived() const {return commands_received_;}
+  uint64_t httpRequests() const {return http_requests_;}
+
+private:
+  FTSimulator(const FTSimulator&);
+  FTSimulator& operator=(const FTSimulator&);
+
+  static void* rdtEntry(void* arg);
+  static void* httpEntry(void* arg);
+  void rdtLoop();
+  void httpLoop();
+  std::string handleHttpRequest(const std::string& path);
+  std::string settingsXml();
+  void signalAt(double t, double ft[6]);
+
+  SimulatorConfig config_;
+  int rdt_socket_;
+  int http_socket_;
+  pthread_t rdt_thread_;
+  pthread_t http_thread_;
+  bool running_;
+  std::atomic<bool> stop_;
+
+  // Settings changed through the web server
+  std::atomic<unsigned int> rdt_rate_;
+  std::atomic<unsigned int> buffer_size_;
+  std::atomic<int> gauge_bias_[6];
+  std::atomic<int> calibration_index_;
+
+  std::atomic<uint64_t> records_generated_;
+  std::atomic<uint64_t> datagrams_sent_;
+  std::atomic<uint64_t> datagrams_lost_;
+  std::atomic<uint64_t> commands_received_;
+  std::atomic<uint64_t> http_requests_;
+};
+
+// Runs simulators in a child process, so that they do not count in the CPU
+// usage of the caller. Returns its pid once all of them are serving, -1 if
+// one could not start.
+pid_t startSimulatorProcess(const std::vector<SimulatorConfig>& configs);
+pid_t startSimulatorProcess(const SimulatorConfig& config);
+void stopSimulatorProcess(pid_t pid);
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+#include <string>
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <iostream>
+// Simulator class definition
+#include "ft_simulator.h"
+
+using namespace std;
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void onSignal(int)
+{
+  interrupted = 1;
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --ip ADDR          address to bind (default 127.0.0.1)\n"
+       << "  --port PORT        RDT UDP port (default 49152)\n"
+       << "  --http-port PORT   web server TCP port (default 8080)\n"
+       << "  --rate HZ          RDT output rate (default 1000)\n"
+       << "  --buffer N         records per datagram in buffered mode (default 1)\n"
+       << "  --cpf N --cpt N    counts per force / torque (default 1000000)\n"
+       << "  --signal TYPE      constant, sine, ramp or noise (default sine)\n"
+       << "  --offset F         offset on every axis in N / Nm (default 0)\n"
+       << "  --amplitude A      signal amplitude in N / Nm (default 1)\n"
+       << "  --frequency HZ     signal frequency (default 1)\n"
+       << "  --noise SIGMA      gaussian noise added to every axis (default 0)\n"
+       << "  --loss P           probability of dropping a datagram (default 0)\n"
+       << "  --reorder P        probability of delaying a datagram (default 0)\n"
+       << "  --duplicate P      probability of duplicating a datagram (default 0)\n"
+       << "  --http-delay SEC   time the web server takes to answer (default 0)\n"
+       << "  --keep-alive       serve several HTTP/1.1 requests per connection\n"
+       << "  --seed N           random seed (default 42)\n"
+       << "  --duration SEC     exit after this time (default: run until Ctrl-C)\n";
+}
+
+int main(int argc, char **argv)
+{
+  ati::SimulatorConfig config;
+  double duration = 0;
+
+  static struct option options[] = {
+    {"ip", required_argument, 0, 'i'},
+    {"port", required_argument, 0, 'p'},
+    {"http-port", required_argument, 0, 'w'},
+    {"rate", required_argument, 0, 'r'},
+    {"buffer", required_argument, 0, 'b'},
+    {"cpf", required_argument, 0, 'f'},
+    {"cpt", required_argument, 0, 't'},
+    {"signal", required_argument, 0, 's'},
+    {"offset", required_argument, 0, 'o'},
+    {"amplitude", required_argument, 0, 'a'},
+    {"frequency", required_argument, 0, 'q'},
+    {"noise", required_argument, 0, 'n'},
+    {"loss", required_argument, 0, 'l'},
+    {"reorder", required_argument, 0, 'x'},
+    {"duplicate", required_argument, 0, 'u'},
+    {"http-delay", required_argument, 0, 'y'},
+    {"keep-alive", no_argument, 0, 'k'},
+    {"seed", required_argument, 0, 'e'},
+    {"duration", required_argument, 0, 'd'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'i': config.ip = optarg; break;
+      case 'p': config.rdt_port = atoi(optarg); break;
+      case 'w': config.http_port = atoi(optarg); break;
+      case 'r': config.rdt_rate = atoi(optarg); break;
+      case 'b': config.buffer_size = atoi(optarg); break;
+      case 'f': config.cpf = atoi(optarg); break;
+      case 't': config.cpt = atoi(optarg); break;
+      case 's':
+      {
+        const string signal = optarg;
+        if (signal == "constant") config.signal = ati::SimulatorConfig::CONSTANT;
+        else if (signal == "sine") config.signal = ati::SimulatorConfig::SINE;
+        else if (signal == "ramp") config.signal = ati::SimulatorConfig::RAMP;
+        else if (signal == "noise") config.signal = ati::SimulatorConfig::NOISE;
+        else { usage(argv[0]); return -1; }
+        break;
+      }
+      case 'o': for (int i = 0; i < 6; ++i) config.offset[i] = atof(optarg); break;
+      case 'a': config.amplitude = atof(optarg); break;
+      case 'q': config.frequency = atof(optarg); break;
+      case 'n': config.noise = atof(optarg); break;
+      case 'l': config.loss = atof(optarg); break;
+      case 'x': config.reorder = atof(optarg); break;
+      case 'u': config.duplicate = atof(optarg); break;
+      case 'y': config.http_delay = atof(optarg); break;
+      case 'k': config.http_keep_alive = true; break;
+      case 'e': config.seed = atoi(optarg); break;
+      case 'd': duration = atof(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+
+  signal(SIGINT, onSignal);
+  signal(SIGTERM, onSignal);
+
+  ati::FTSimulator simulator(config);
+  if (!simulator.start())
+    return -1;
+  cout << "[ft_simulator] RDT on udp://" << config.ip << ":" << config.rdt_port
+       << ", web server on http://" << config.ip << ":" << config.http_port
+       << ", " << config.rdt_rate << " Hz" << endl;
+
+  double elapsed = 0;
+  while (!interrupted && (duration <= 0 || elapsed < duration))
+  {
+    usleep(100000);
+    elapsed += 0.1;
+  }
+  simulator.stop();
+
+  cout << "[ft_simulator] " << simulator.recordsGenerated() << " records generated, "
+       << simulator.datagramsSent() << " datagrams sent, "
+       << simulator.datagramsLost() << " dropped, "
+       << simulator.commandsReceived() << " commands, "
+       << simulator.httpRequests() << " http requests" << endl;
+  return 0;
+}
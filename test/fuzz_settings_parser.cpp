@@ -0,0 +1,158 @@
+// Fuzz harness of parseNetFTSettings(). Configured with
+// -DATI_SENSOR_LIBFUZZER=ON and clang, it is a libFuzzer target with
+// AddressSanitizer. Otherwise it mutates the sample document itself for a
+// number of iterations, and is best run under valgrind.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <getopt.h>
+#include <iostream>
+#include <random>
+#include <string>
+#include "ati_sensor/netft_settings.h"
+#include "netft_settings_sample.h"
+
+using namespace std;
+
+static const uint32_t all_fields = (ati::NetFTSettings::CALIBRATION_DATE << 1) - 1;
+
+template<size_t N>
+static void checkString(const char (&s)[N], const char* name)
+{
+  if (!memchr(s, '\0', N))
+  {
+    cerr << name << " is not null-terminated" << endl;
+    abort();
+  }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+  // A copy of the exact size, so that reading past the end is caught
+  char* xml = static_cast<char*>(malloc(size ? size : 1));
+  if (size)
+    memcpy(xml, data, size);
+
+  ati::NetFTSettings settings;
+  const unsigned int count = ati::parseNetFTSettings(xml, size, settings);
+  unsigned int bits = 0;
+  for (uint32_t f = settings.found; f; f &= f - 1)
+    ++bits;
+  if ((settings.found & ~all_fields) || count != bits)
+  {
+    cerr << "found " << settings.found << " does not match " << count << " fields" << endl;
+    abort();
+  }
+  checkString(settings.force_units, "force_units");
+  checkString(settings.torque_units, "torque_units");
+  checkString(settings.serial, "serial");
+  checkString(settings.firmware, "firmware");
+  checkString(settings.calibration_serial, "calibration_serial");
+  checkString(settings.calibration_part, "calibration_part");
+  checkString(settings.calibration_date, "calibration_date");
+
+  // The same input gives the same result
+  ati::NetFTSettings again;
+  ati::parseNetFTSettings(xml, size, again);
+  if (memcmp(&settings, &again, sizeof(settings)) != 0)
+  {
+    cerr << "parsing is not deterministic" << endl;
+    abort();
+  }
+  free(xml);
+  return 0;
+}
+
+#ifndef ATI_SENSOR_LIBFUZZER
+// Bytes that matter to the scanner are picked more often
+static const char interesting[] = "<>/!?-;.:= \r\n0123456789+-cfgpt";
+
+static void mutate(string& input, mt19937& rng)
+{
+  const size_t size = input.size();
+  uniform_int_distribution<size_t> position(0, size ? size - 1 : 0);
+  switch (rng() % 8)
+  {
+    case 0: // flip a bit
+    case 1:
+      if (size)
+        input[position(rng)] ^= static_cast<char>(1 << (rng() % 8));
+      break;
+    case 2: // insert a byte
+      input.insert(input.begin() + (size ? position(rng) : 0),
+                   (rng() % 2) ? interesting[rng() % (sizeof(interesting) - 1)] : static_cast<char>(rng()));
+      break;
+    case 3: // erase a range
+      if (size)
+      {
+        const size_t at = position(rng);
+        input.erase(at, 1 + rng() % 16);
+      }
+      break;
+    case 4: // duplicate a range
+      if (size)
+      {
+        const size_t at = position(rng);
+        input.insert(at, input.substr(at, 1 + rng() % 64));
+      }
+      break;
+    case 5: // truncate, rarely as the input would soon be empty
+      if (size && rng() % 8 == 0)
+        input.resize(position(rng));
+      break;
+    default: // overwrite with an interesting byte
+      if (size)
+        input[position(rng)] = interesting[rng() % (sizeof(interesting) - 1)];
+      break;
+  }
+}
+
+static void usage(const char* name)
+{
+  cout << "Usage: " << name << " [options]\n"
+       << "  --iterations N     inputs to try (default 200000)\n"
+       << "  --seed N           random seed (default 42)\n";
+}
+
+int main(int argc, char **argv)
+{
+  unsigned long iterations = 200000;
+  unsigned int seed = 42;
+
+  static struct option options[] = {
+    {"iterations", required_argument, 0, 'n'},
+    {"seed", required_argument, 0, 'e'},
+    {"help", no_argument, 0, 'h'},
+    {0, 0, 0, 0}
+  };
+  int c;
+  while ((c = getopt_long(argc, argv, "h", options, NULL)) != -1)
+  {
+    switch (c)
+    {
+      case 'n': iterations = strtoul(optarg, NULL, 10); break;
+      case 'e': seed = atoi(optarg); break;
+      default: usage(argv[0]); return c == 'h' ? 0 : -1;
+    }
+  }
+
+  mt19937 rng(seed);
+  const string sample(netft_settings_sample, sizeof(netft_settings_sample) - 1);
+  string input = sample;
+  for (unsigned long i = 0; i < iterations; ++i)
+  {
+    // Mostly small changes piling up, sometimes back to the sample
+    if (rng() % 16 == 0)
+      input = sample;
+    const unsigned int mutations = 1 + rng() % 8;
+    for (unsigned int m = 0; m < mutations; ++m)
+      mutate(input, rng);
+    if (input.size() > 4 * sample.size())
+      input = sample;
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()), input.size());
+  }
+  cout << iterations << " inputs parsed without error" << endl;
+  return 0;
+}
+#endif
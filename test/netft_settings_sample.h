@@ -0,0 +1,74 @@
+// A netftapi2.xml as served by a Net F/T, with the HTTP response headers,
+// for the parser benchmark and fuzz harness
+#ifndef ATI_SENSOR_NETFT_SETTINGS_SAMPLE_H
+#define ATI_SENSOR_NETFT_SETTINGS_SAMPLE_H
+
+static const char netft_settings_sample[] =
+  "HTTP/1.0 200 OK\r\n"
+  "Content-Type: text/xml\r\n"
+  "Cache-Control: no-cache\r\n"
+  "\r\n"
+  "<?xml version=\"1.0\" encoding=\"ISO-8859-1\"?>\r\n"
+  "<?xml-stylesheet type=\"text/xsl\" href=\"netftapi2.xsl\"?>\r\n"
+  "<!-- Net F/T configuration, see the Net F/T manual -->\r\n"
+  "<netft>\r\n"
+  "<setserial>FT12345</setserial>\r\n"
+  "<setfwver>2.0.0.7</setfwver>\r\n"
+  "<setmacaddr>00-16-BD-00-1A-2B</setmacaddr>\r\n"
+  "<setuserfilter>0</setuserfilter>\r\n"
+  "<setbias>-2351;1289;-77;10244;-1931;472</setbias>\r\n"
+  "<setpwrsrc>0</setpwrsrc>\r\n"
+  "<setcfgsel>0</setcfgsel>\r\n"
+  "<comrdte>1</comrdte>\r\n"
+  "<comrdtrate>1000</comrdtrate>\r\n"
+  "<comrdtbsiz>10</comrdtbsiz>\r\n"
+  "<comrdtmsyn>0</comrdtmsyn>\r\n"
+  "<comrdtport>49152</comrdtport>\r\n"
+  "<comtcpe>1</comtcpe>\r\n"
+  "<comtcpport>49151</comtcpport>\r\n"
+  "<comeipe>0</comeipe>\r\n"
+  "<comcane>0</comcane>\r\n"
+  "<comcanrate>500</comcanrate>\r\n"
+  "<comcanbase>1776</comcanbase>\r\n"
+  "<netip>192.168.1.1</netip>\r\n"
+  "<netmask>255.255.255.0</netmask>\r\n"
+  "<netgw>0.0.0.0</netgw>\r\n"
+  "<netdhcp>0</netdhcp>\r\n"
+  "<cfgcalsel>0</cfgcalsel>\r\n"
+  "<cfgnam>Config 1</cfgnam>\r\n"
+  "<cfgfu>2</cfgfu>\r\n"
+  "<cfgtu>3</cfgtu>\r\n"
+  "<cfgcpf>1000000</cfgcpf>\r\n"
+  "<cfgcpt>1000000</cfgcpt>\r\n"
+  "<cfgmr>660;660;1980;60;60;60</cfgmr>\r\n"
+  "<cfgtfx>0;0;0;0;0;0</cfgtfx>\r\n"
+  "<cfgtdu>5</cfgtdu>\r\n"
+  "<cfgtau>1</cfgtau>\r\n"
+  "<cfgagcpf>1000000</cfgagcpf>\r\n"
+  "<cfgagcpt>1000000</cfgagcpt>\r\n"
+  "<setmce>0</setmce>\r\n"
+  "<setmcept>0;0;0;0;0;0;0;0</setmcept>\r\n"
+  "<setmcecmp>0;0;0;0;0;0;0;0</setmcecmp>\r\n"
+  "<setmceval>0;0;0;0;0;0;0;0</setmceval>\r\n"
+  "<setmceout>0;0;0;0;0;0;0;0</setmceout>\r\n"
+  "<scfgfu>N</scfgfu>\r\n"
+  "<scfgtu>Nm</scfgtu>\r\n"
+  "<scfgmr>660.000;660.000;1980.000;60.000;60.000;60.000</scfgmr>\r\n"
+  "<calsn>FT12345</calsn>\r\n"
+  "<calpartnum>SI-660-60</calpartnum>\r\n"
+  "<calfamily>Delta</calfamily>\r\n"
+  "<calcaldt>3/14/2015</calcaldt>\r\n"
+  "<calfu>2</calfu>\r\n"
+  "<caltu>3</caltu>\r\n"
+  "<calmr>660;660;1980;60;60;60</calmr>\r\n"
+  "<calcpf>1000000</calcpf>\r\n"
+  "<calcpt>1000000</calcpt>\r\n"
+  "<runstat>0</runstat>\r\n"
+  "<runrdt>0</runrdt>\r\n"
+  "<runft>0;0;0;0;0;0</runft>\r\n"
+  "<runsg>0;0;0;0;0;0</runsg>\r\n"
+  "<runsupply>24.0</runsupply>\r\n"
+  "<runtemp>31.5</runtemp>\r\n"
+  "</netft>\r\n";
+
+#endif
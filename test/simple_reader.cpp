@@ -1,6 +1,6 @@
 #include <string>
 #include <stdio.h> 
-#include <ctime>
+#include <time.h>
 #include <iostream>
 #include <iomanip>
 // FTSensor class definition
@@ -13,13 +13,23 @@ int main(int argc, char **argv)
   float diff(1);
   uint32_t cnt(0),n(100);
   uint32_t rdt(0),ft(0),rdt_old(0),ft_old(0);
-  clock_t t(0);
+  struct timespec t0, t1;
+  string ip="192.168.100.103";
+  // Read ip and ports if given (e.g. to use ft_simulator)
+  if (argc >1)
+  {
+    ip = argv[1];
+  }
   // The sensor object
   cout << "Creating sensor" << endl;
   ati::FTSensor ftsensor;
+  if (argc >2)
+    ftsensor.setPort(atoi(argv[2]));
+  if (argc >3)
+    ftsensor.setHTTPPort(atoi(argv[3]));
   
   cout << "Initializing sensor" << endl;
-  ftsensor.init("192.168.100.103");
+  ftsensor.init(ip);
 
   cout << "Setting timeout to 1.0 sec" << endl;
   ftsensor.setTimeout(1.0);
@@ -31,23 +41,21 @@ int main(int argc, char **argv)
   double measurements[6];
   cout << "Getting sensor measurements" << endl;
 
-  t = clock();
+  // Wall-clock time : clock() counts CPU time, not time spent waiting for the sensor
+  clock_gettime(CLOCK_MONOTONIC, &t0);
   while(1)
   {
     
     ftsensor.getMeasurements(measurements,rdt,ft);
     
     if(ft == ft_old)
-    {
-      cout << "ERROR : same ft as previous" <<endl;
-      break;
-    }
+      cout << "WARNING : same ft as previous" <<endl;
     ft_old = ft;
     
     if(cnt >= n)
     {
-      t = clock() - t;
-      diff = ((float)t)/CLOCKS_PER_SEC;
+      clock_gettime(CLOCK_MONOTONIC, &t1);
+      diff = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec)*1e-9;
 	  cout <<"rdt: "<<rdt<<" ft: "<<ft<<endl;
           cout << setprecision(8)<< setw(8)<< "Fx: " <<   measurements[0] 
           << setprecision(8)<< setw(8)<< " Fy: " <<   measurements[1]  
@@ -56,8 +64,12 @@ int main(int argc, char **argv)
           << setprecision(8)<< setw(8)<< " Ty: " <<   measurements[4]  
           << setprecision(8)<< setw(8)<< " Tz: " <<   measurements[5] 
           << setprecision(8)<< setw(8)<< endl;
-      cout << cnt<< " It took "<< diff <<" ms to get "<<n<<" measurements => freq="<<n/diff<<"Hz"<<endl;
-      t = clock();
+      ati::SequenceStats stats = ftsensor.getSequenceStats();
+      cout << "received: " << stats.received << " lost: " << stats.lost
+           << " reordered: " << stats.reordered << " duplicates: " << stats.duplicates
+           << " recent loss: " << stats.recent_loss_rate*100.0 << "%" << endl;
+      cout << cnt<< " It took "<< diff*1000.0 <<" ms to get "<<n<<" measurements => freq="<<n/diff<<"Hz"<<endl;
+      t0 = t1;
       cnt=0;
     }
 
@@ -14,7 +14,7 @@ int main(int argc, char **argv)
   uint32_t rdt(0),ft(0),rdt_old(0),ft_old(0);
   clock_t t(0);
   string ip="192.168.100.103";
-  // Read ip if given
+  // Read ip and ports if given (e.g. to use ft_simulator)
   if (argc >1)
   {
     ip = argv[1];
@@ -23,6 +23,10 @@ int main(int argc, char **argv)
   // The sensor object
   cout << "Creating sensor" << endl;
   ati::FTSensor ftsensor;
+  if (argc >2)
+    ftsensor.setPort(atoi(argv[2]));
+  if (argc >3)
+    ftsensor.setHTTPPort(atoi(argv[3]));
   
   cout << "Initializing sensor" << endl;
   ftsensor.init(ip);